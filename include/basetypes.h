@@ -27,6 +27,7 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <limits>
 #include <list>
 #include <map>
 #include <unordered_map>
@@ -36,6 +37,7 @@
 #include "link.h"
 #include "log.h"
 #include "timer.h"
+#include "tracer.h"
 
 namespace Splash
 {
@@ -89,6 +91,9 @@ struct AttributeFunctor
                 _defaultSetAndGet = std::move(a._defaultSetAndGet);
                 _doUpdateDistant = std::move(a._doUpdateDistant);
                 _savable = std::move(a._savable);
+                _generation = a._generation.load();
+                _distantGeneration = std::move(a._distantGeneration);
+                _distantValues = std::move(a._distantValues);
             }
 
             return *this;
@@ -108,6 +113,7 @@ struct AttributeFunctor
                 for (const auto& a : args)
                     _valuesTypes.push_back(a.getTypeAsChar());
 
+                ++_generation;
                 return true;
             }
             else if (!_setFunc)
@@ -135,7 +141,10 @@ struct AttributeFunctor
                 }
             }
 
-            return _setFunc(std::forward<const Values&>(args));
+            bool result = _setFunc(std::forward<const Values&>(args));
+            if (result)
+                ++_generation;
+            return result;
         }
 
         Values operator()() const
@@ -162,6 +171,38 @@ struct AttributeFunctor
         bool doUpdateDistant() const {return _doUpdateDistant;}
         void doUpdateDistant(bool update) {_doUpdateDistant = update;}
 
+        // Generation of the attribute, incremented each time it is set
+        uint64_t getGeneration() const {return _generation;}
+
+        // Whether the values are held by the attribute itself, with the default set and get functions
+        // Only then do they change exclusively when the attribute is set: a get function may return anything
+        bool holdsValues() const {return _defaultSetAndGet && !_getFunc;}
+
+        // Check whether the attribute may have to be sent to the Scene object, without getting its values
+        bool isDistantDirty() const {return !holdsValues() || _generation != _distantGeneration;}
+
+        // Check whether the given values, got at the given generation, should be sent to the Scene object
+        // Values held by the attribute are sent once set, the others are compared to the last ones sent
+        bool updateDistantValues(uint64_t generation, const Values& values)
+        {
+            bool isSet = generation != _distantGeneration;
+            _distantGeneration = generation;
+            if (holdsValues())
+                return isSet;
+
+            if (!isSet && values == _distantValues)
+                return false;
+            _distantValues = values;
+            return true;
+        }
+
+        // Forget about the last values sent to the Scene object, so that they are sent again
+        void resetDistantValues()
+        {
+            _distantGeneration = std::numeric_limits<uint64_t>::max();
+            _distantValues.clear();
+        }
+
         // Get the types of the wanted arguments
         Values getArgsTypes() const
         {
@@ -211,6 +252,10 @@ struct AttributeFunctor
         bool _defaultSetAndGet {true};
         bool _doUpdateDistant {false}; // True if the World should send this attr values to Scenes
         bool _savable {true}; // True if this attribute should be saved
+
+        std::atomic<uint64_t> _generation {0}; // Incremented each time the attribute is set
+        uint64_t _distantGeneration {std::numeric_limits<uint64_t>::max()}; // Generation of the last values sent to the Scene object
+        Values _distantValues {}; // Last values sent to the Scene object
 };
 
 class BaseObject;
@@ -265,9 +310,15 @@ class BaseObject
         inline virtual std::string setName(const std::string& name)
         {
             _name = name;
+            _traceName = Tracer::get().intern(name);
             return _name;
         }
 
+        /**
+         * Get the name of the object as interned by the Tracer, to be used as a trace detail without any lock
+         */
+        inline const char* getTraceName() const {return _traceName;}
+
         /**
          * Set and get the remote type of the object
          * This implies that this object gets data streamed from a World object
@@ -425,6 +476,41 @@ class BaseObject
             return attribs;
         }
 
+        /**
+         * Get the map of the distant attributes which changed since the last call
+         * An attribute holding its values is included if it has been set since, without getting its values otherwise
+         * An attribute with a get function is included if it has been set, or if its values differ from the last ones returned
+         */
+        std::unordered_map<std::string, Values> getDirtyDistantAttributes()
+        {
+            std::unordered_map<std::string, Values> attribs;
+            for (auto& attr : _attribFunctions)
+            {
+                if (!attr.second.doUpdateDistant() || !attr.second.isDistantDirty())
+                    continue;
+
+                // The generation is read first, so that a concurrent set is caught by the next call
+                auto generation = attr.second.getGeneration();
+                Values values;
+                if (getAttribute(attr.first, values, false, true) == false || values.size() == 0)
+                    continue;
+
+                if (attr.second.updateDistantValues(generation, values))
+                    attribs[attr.first] = values;
+            }
+
+            return attribs;
+        }
+
+        /**
+         * Force all distant attributes to be returned by the next call to getDirtyDistantAttributes
+         */
+        void resetDistantAttributes()
+        {
+            for (auto& attr : _attribFunctions)
+                attr.second.resetDistantValues();
+        }
+
         /**
          * Get the savability for this object
          */
@@ -532,6 +618,7 @@ class BaseObject
         std::string _type {"baseobject"};
         std::string _remoteType {""};
         std::string _name {""};
+        const char* _traceName {""};
 
         bool _isConnectedToRemote {false}; // True if the object gets data from a World object
         std::string _configFilePath {""}; // All objects know about their location
@@ -735,6 +822,17 @@ class RootObject : public BaseObject
                 _answerCondition.notify_one();
                 return true;
             });
+
+            addAttribute("batch", [&](const Values& args) {
+                for (const auto& arg : args)
+                {
+                    auto entry = arg.asValues();
+                    if (entry.size() != 3)
+                        continue;
+                    set(entry[0].asString(), entry[1].asString(), entry[2].asValues());
+                }
+                return true;
+            });
         }
 
         virtual ~RootObject() {}
@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2016 Emmanuel Durand
+ *
+ * This file is part of Splash.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Splash is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splash.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * @bufferPool.h
+ * The BufferPool class, which recycles the big buffers used for frames
+ * (ImageBuffer, SerializedObject) instead of returning them to the system
+ */
+
+#ifndef SPLASH_BUFFER_POOL_H
+#define SPLASH_BUFFER_POOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "config.h"
+
+#define SPLASH_BUFFER_POOL_MIN_SIZE (64 * 1024) // Buffers smaller than this go through malloc
+#define SPLASH_BUFFER_POOL_MAX_CACHED (1024ull * 1024ull * 1024ull) // Maximum amount of memory kept for reuse
+#define SPLASH_BUFFER_POOL_PAGE_SIZE 4096
+#define SPLASH_BUFFER_POOL_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+namespace Splash
+{
+
+/*************/
+class BufferPool
+{
+    public:
+        struct Stats
+        {
+            uint64_t hits {0}; // Allocations served from a recycled buffer
+            uint64_t misses {0}; // Allocations which needed a new mapping
+            uint64_t releases {0}; // Buffers given back to the system
+            size_t cachedBytes {0}; // Memory held by the pool, waiting for reuse
+            size_t usedBytes {0}; // Memory currently handed out by the pool
+        };
+
+        /**
+         * Deleter to use with unique_ptr, holding the size of the allocation
+         */
+        struct Deleter
+        {
+            Deleter() = default;
+            Deleter(size_t s) : size(s) {}
+
+            size_t size {0};
+            void operator()(void* ptr) const {BufferPool::get().deallocate(ptr, size);}
+        };
+
+        /**
+         * Get the singleton
+         */
+        static BufferPool& get()
+        {
+            static auto instance = new BufferPool;
+            return *instance;
+        }
+
+        /**
+         * Get a buffer of at least the given size, in bytes
+         * Big buffers are page aligned, and recycled from a previous buffer of the same size if possible
+         */
+        void* allocate(size_t size);
+
+        /**
+         * Give back a buffer, size being the one given to allocate
+         */
+        void deallocate(void* ptr, size_t size);
+
+        /**
+         * Release all the buffers waiting for reuse
+         */
+        void clear();
+
+        /**
+         * Get usage statistics
+         */
+        Stats getStats();
+
+        /**
+         * Set whether big buffers should be backed by huge pages, when the system supports it
+         */
+        void setUseHugePages(bool use) {_useHugePages = use;}
+
+    private:
+        std::mutex _mutex {};
+        std::unordered_map<size_t, std::vector<void*>> _freeBuffers {};
+        Stats _stats {};
+        std::atomic_bool _useHugePages {true}; // Set from the World attributes, read by any allocating thread
+
+        BufferPool() = default;
+        BufferPool(const BufferPool&) = delete;
+        BufferPool& operator=(const BufferPool&) = delete;
+
+        /**
+         * Get the size actually mapped for a buffer of the given size
+         */
+        size_t getMappedSize(size_t size) const;
+
+        /**
+         * Release cached buffers of other sizes than the given one, until the cache has room for it
+         */
+        void makeRoom(size_t size);
+};
+
+} // end of namespace
+
+#endif // SPLASH_BUFFER_POOL_H
@@ -174,11 +174,36 @@ class Camera : public BaseObject
         bool _isInitialized {false};
         GlWindowPtr _window;
 
-        GLuint _fbo {0};
+        ContextFramebuffer _fbo;
         Texture_ImagePtr _depthTexture;
         std::vector<Texture_ImagePtr> _outTextures;
         std::vector<std::weak_ptr<Object>> _objects;
 
+        // Uniforms shared by all drawn objects, laid out as the std140 _cameraBlock of the shaders
+        struct CameraUniformBlock
+        {
+            glm::vec4 fovAndColorBalance;
+            glm::vec2 cameraAttributes;
+            int isColorLUT;
+            int padding;
+            glm::vec4 colorMixMatrix[3];
+            glm::vec4 colorLUT[256];
+        };
+
+        struct ObjectUniformSlot
+        {
+            bool uploaded {false};
+            Object::UniformBlock block;
+        };
+
+        // Uniform buffer holding the camera block, followed by one block for each object
+        GLuint _uniformBuffer {0};
+        GLint _uniformBufferAlignment {256};
+        size_t _uniformBufferSize {0};
+        bool _cameraUniformsUploaded {false};
+        CameraUniformBlock _cameraUniforms;
+        std::vector<ObjectUniformSlot> _objectUniforms {};
+
         // Rendering parameters
         bool _drawFrame {false};
         bool _wireframe {false};
@@ -190,7 +215,7 @@ class Camera : public BaseObject
         glm::dvec4 _clearColor {0.6, 0.6, 0.6, 1.0};
 
         // Color correction
-        Values _colorLUT {0};
+        std::vector<float> _colorLUT {};
         bool _isColorLUTActivated {false};
         glm::mat3 _colorMixMatrix;
 
@@ -265,6 +290,21 @@ class Camera : public BaseObject
          */
         void updateColorDepth();
 
+        /**
+         * Get the size of a uniform block once aligned in the uniform buffer
+         */
+        size_t getAlignedUniformBlockSize(size_t size) const;
+
+        /**
+         * Update the camera uniform block if needed, and bind it
+         */
+        void updateCameraUniforms();
+
+        /**
+         * Update the uniform block of the object drawn at the given index if needed, and bind it
+         */
+        void updateObjectUniforms(size_t index, const Object::UniformBlock& block);
+
         /**
          * Register new functors to modify attributes
          */
@@ -39,14 +39,19 @@
 #include <cstring>
 #include <deque>
 #include <execinfo.h>
+#include <map>
 #include <ostream>
 #include <memory>
 #include <mutex>
+#include <new>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <vector>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include "bufferPool.h"
 #include "threadpool.h"
 
 #ifndef SPLASH_CORETYPES_H
@@ -73,6 +78,7 @@ namespace Splash
 
 /*************/
 // Resizable array, used to hold big buffers (like raw images)
+// Its memory comes from the BufferPool, so T has to be trivially copyable
 template <typename T>
 class ResizableArray
 {
@@ -87,33 +93,27 @@ class ResizableArray
         ResizableArray(T* start, T* end)
         {
             if (end <= start)
-            {
-                _size = 0;
-                _shift = 0;
-                _buffer.reset();
-
                 return;
-            }
 
-            _size = static_cast<size_t>(end - start);
-            _shift = 0;
-            _buffer = std::unique_ptr<T[]>(new T[_size]);
+            resize(static_cast<size_t>(end - start));
             memcpy(_buffer.get(), start, _size * sizeof(T));
         }
 
         ResizableArray(const ResizableArray& a)
         {
-            _size = a._size - a._shift;
-            _shift = 0;
-            _buffer = std::unique_ptr<T[]>(new T[_size]);
-            memcpy(_buffer.get() + a._shift, a._buffer.get(), _size);
+            resize(a.size());
+            memcpy(_buffer.get(), a.data(), _size * sizeof(T));
         }
 
         ResizableArray(ResizableArray&& a)
         {
             _size = a._size;
             _shift = a._shift;
+            _capacity = a._capacity;
             _buffer = std::move(a._buffer);
+            a._size = 0;
+            a._shift = 0;
+            a._capacity = 0;
         }
 
         ResizableArray& operator=(const ResizableArray& a)
@@ -121,10 +121,10 @@ class ResizableArray
             if (this == &a)
                 return *this;
 
-            _size = a._size - a._shift;
+            _size = 0;
             _shift = 0;
-            _buffer = std::unique_ptr<T[]>(new T[_size]);
-            memcpy(_buffer.get() + a._shift, a._buffer.get(), _size);
+            resize(a.size());
+            memcpy(_buffer.get(), a.data(), _size * sizeof(T));
 
             return *this;
         }
@@ -136,7 +136,11 @@ class ResizableArray
 
             _size = a._size;
             _shift = a._shift;
+            _capacity = a._capacity;
             _buffer = std::move(a._buffer);
+            a._size = 0;
+            a._shift = 0;
+            a._capacity = 0;
 
             return *this;
         }
@@ -156,11 +160,8 @@ class ResizableArray
          */
         inline void shift(size_t shift)
         {
-            if (shift < _size)
-            {
-                _shift = shift;
-                _size -= shift;
-            }
+            if (shift < size())
+                _shift += shift;
         }
 
         /**
@@ -169,17 +170,29 @@ class ResizableArray
         inline size_t size() const {return _size - _shift;}
 
         /**
-         * Resize the buffer
+         * Resize the buffer, keeping its content up to the new size
+         * The current allocation is reused if it is big enough
          */
         inline void resize(size_t size)
         {
-            auto newBuffer = std::unique_ptr<T[]>(new T[size]);
-            if (size >= _size)
-                memcpy(newBuffer.get(), _buffer.get(), _size);
+            auto keptSize = std::min(size, this->size());
+
+            if (size <= _capacity)
+            {
+                if (_shift != 0 && keptSize != 0)
+                    memmove(_buffer.get(), data(), keptSize * sizeof(T));
+            }
             else
-                memcpy(newBuffer.get(), _buffer.get(), size);
+            {
+                auto bytes = size * sizeof(T);
+                auto newBuffer = std::unique_ptr<T[], BufferPool::Deleter>(static_cast<T*>(BufferPool::get().allocate(bytes)), BufferPool::Deleter(bytes));
+                if (keptSize != 0)
+                    memcpy(newBuffer.get(), data(), keptSize * sizeof(T));
+
+                std::swap(_buffer, newBuffer);
+                _capacity = size;
+            }
 
-            std::swap(_buffer, newBuffer);
             _size = size;
             _shift = 0;
         }
@@ -187,7 +200,8 @@ class ResizableArray
     private:
         size_t _size {0};
         size_t _shift {0};
-        std::unique_ptr<T[]> _buffer {nullptr};
+        size_t _capacity {0};
+        std::unique_ptr<T[], BufferPool::Deleter> _buffer {nullptr};
 };
 
 /*************/
@@ -318,10 +332,410 @@ class GlWindow
 
 typedef std::shared_ptr<GlWindow> GlWindowPtr;
 
+/*************/
+// Framebuffer objects are not shared between contexts, so this creates one in each context
+// it is bound in, all of them having the same attachments. Used by objects which are rendered
+// from the context of their window when windows are rendered in parallel
+class ContextFramebuffer
+{
+    public:
+        ContextFramebuffer() {}
+
+        /**
+         * Destructor
+         * The framebuffers of other contexts are deleted the next time a framebuffer is bound in them
+         */
+        ~ContextFramebuffer()
+        {
+            if (_framebuffers.empty())
+                return;
+
+            auto context = glfwGetCurrentContext();
+            std::lock_guard<std::mutex> lockDeletion(getDeletionMutex());
+            for (auto& f : _framebuffers)
+            {
+                if (f.first == context)
+                    glDeleteFramebuffers(1, &f.second.fbo);
+                else
+                    getPendingDeletions()[f.first].push_back(f.second.fbo);
+            }
+        }
+
+        ContextFramebuffer(const ContextFramebuffer&) = delete;
+        ContextFramebuffer& operator=(const ContextFramebuffer&) = delete;
+
+        /**
+         * Bind the framebuffer of the current context to the given target, creating it or updating its attachments if needed
+         * Returns its id
+         */
+        GLuint bind(GLenum target)
+        {
+            auto context = glfwGetCurrentContext();
+            deletePending(context);
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            auto& framebuffer = _framebuffers[context];
+            if (framebuffer.fbo == 0)
+                glGenFramebuffers(1, &framebuffer.fbo);
+            glBindFramebuffer(target, framebuffer.fbo);
+
+            if (framebuffer.version != _version)
+            {
+                for (auto& a : _attachments)
+                    glFramebufferTexture2D(target, a.first, GL_TEXTURE_2D, a.second, 0);
+                framebuffer.version = _version;
+            }
+
+            return framebuffer.fbo;
+        }
+
+        /**
+         * Set the texture attached to the given attachment point, 0 to detach it
+         * It is applied to each framebuffer the next time it is bound
+         */
+        void setAttachment(GLenum attachment, GLuint texture)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _attachments[attachment] = texture;
+            _version++;
+        }
+
+        /**
+         * Attach the textures again to every framebuffer, to be called once a texture is specified again
+         * Changes made from one context are only guaranteed to be visible from another one after this
+         */
+        void invalidate()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _version++;
+        }
+
+    private:
+        struct Framebuffer
+        {
+            GLuint fbo {0};
+            uint64_t version {0};
+        };
+
+        std::mutex _mutex {};
+        std::map<GLenum, GLuint> _attachments {};
+        uint64_t _version {1};
+        std::map<GLFWwindow*, Framebuffer> _framebuffers {};
+
+        static std::mutex& getDeletionMutex()
+        {
+            static auto mutex = new std::mutex;
+            return *mutex;
+        }
+
+        static std::map<GLFWwindow*, std::vector<GLuint>>& getPendingDeletions()
+        {
+            static auto deletions = new std::map<GLFWwindow*, std::vector<GLuint>>;
+            return *deletions;
+        }
+
+        static void deletePending(GLFWwindow* context)
+        {
+            std::lock_guard<std::mutex> lockDeletion(getDeletionMutex());
+            auto& deletions = getPendingDeletions();
+            auto deletionIt = deletions.find(context);
+            if (deletionIt == deletions.end())
+                return;
+            glDeleteFramebuffers(deletionIt->second.size(), deletionIt->second.data());
+            deletions.erase(deletionIt);
+        }
+};
+
+/*************/
+// Contiguous array which holds up to N elements without allocating,
+// used to hold small, frequently copied arrays (like Values)
+template <typename T, size_t N>
+class SmallVector
+{
+    public:
+        typedef T value_type;
+        typedef T* iterator;
+        typedef const T* const_iterator;
+        typedef size_t size_type;
+
+        SmallVector() {}
+
+        explicit SmallVector(size_t count)
+        {
+            reserve(count);
+            for (size_t i = 0; i < count; ++i)
+                new (_data + i) T();
+            _size = count;
+        }
+
+        SmallVector(size_t count, const T& value)
+        {
+            reserve(count);
+            for (size_t i = 0; i < count; ++i)
+                new (_data + i) T(value);
+            _size = count;
+        }
+
+        template <class InputIt, typename = typename std::enable_if<!std::is_integral<InputIt>::value>::type>
+        SmallVector(InputIt first, InputIt last)
+        {
+            for (auto it = first; it != last; ++it)
+                emplace_back(*it);
+        }
+
+        SmallVector(std::initializer_list<T> init)
+        {
+            reserve(init.size());
+            for (const auto& v : init)
+                new (_data + _size++) T(v);
+        }
+
+        SmallVector(const SmallVector& v)
+        {
+            reserve(v._size);
+            for (size_t i = 0; i < v._size; ++i)
+                new (_data + i) T(v._data[i]);
+            _size = v._size;
+        }
+
+        SmallVector(SmallVector&& v) noexcept
+        {
+            moveFrom(std::move(v));
+        }
+
+        ~SmallVector()
+        {
+            clear();
+            if (_data != inlineData())
+                ::operator delete(_data);
+        }
+
+        SmallVector& operator=(const SmallVector& v)
+        {
+            if (this == &v)
+                return *this;
+
+            clear();
+            reserve(v._size);
+            for (size_t i = 0; i < v._size; ++i)
+                new (_data + i) T(v._data[i]);
+            _size = v._size;
+
+            return *this;
+        }
+
+        SmallVector& operator=(SmallVector&& v) noexcept
+        {
+            if (this == &v)
+                return *this;
+
+            clear();
+            if (_data != inlineData())
+                ::operator delete(_data);
+            _data = inlineData();
+            _capacity = N;
+            moveFrom(std::move(v));
+
+            return *this;
+        }
+
+        bool operator==(const SmallVector& v) const
+        {
+            if (_size != v._size)
+                return false;
+            for (size_t i = 0; i < _size; ++i)
+                if (!(_data[i] == v._data[i]))
+                    return false;
+            return true;
+        }
+        bool operator!=(const SmallVector& v) const {return !operator==(v);}
+
+        T& operator[](size_t i) {return _data[i];}
+        const T& operator[](size_t i) const {return _data[i];}
+
+        T& at(size_t i)
+        {
+            if (i >= _size)
+                throw std::out_of_range("SmallVector::at");
+            return _data[i];
+        }
+        const T& at(size_t i) const
+        {
+            if (i >= _size)
+                throw std::out_of_range("SmallVector::at");
+            return _data[i];
+        }
+
+        T& front() {return _data[0];}
+        const T& front() const {return _data[0];}
+        T& back() {return _data[_size - 1];}
+        const T& back() const {return _data[_size - 1];}
+
+        iterator begin() {return _data;}
+        const_iterator begin() const {return _data;}
+        iterator end() {return _data + _size;}
+        const_iterator end() const {return _data + _size;}
+
+        T* data() {return _data;}
+        const T* data() const {return _data;}
+
+        inline size_t size() const {return _size;}
+        inline bool empty() const {return _size == 0;}
+        inline size_t capacity() const {return _capacity;}
+
+        /**
+         * Make sure the storage can hold the given number of elements
+         */
+        void reserve(size_t capacity)
+        {
+            if (capacity <= _capacity)
+                return;
+
+            T* newData = static_cast<T*>(::operator new(capacity * sizeof(T)));
+            for (size_t i = 0; i < _size; ++i)
+            {
+                new (newData + i) T(std::move(_data[i]));
+                _data[i].~T();
+            }
+
+            if (_data != inlineData())
+                ::operator delete(_data);
+            _data = newData;
+            _capacity = capacity;
+        }
+
+        void resize(size_t size)
+        {
+            if (size < _size)
+            {
+                for (size_t i = size; i < _size; ++i)
+                    _data[i].~T();
+                _size = size;
+                return;
+            }
+
+            reserve(size);
+            for (size_t i = _size; i < size; ++i)
+                new (_data + i) T();
+            _size = size;
+        }
+
+        void clear()
+        {
+            for (size_t i = 0; i < _size; ++i)
+                _data[i].~T();
+            _size = 0;
+        }
+
+        template <typename... Args>
+        void emplace_back(Args&&... args)
+        {
+            if (_size == _capacity)
+            {
+                // The new element may refer to an existing one, so it is built before growing
+                T value(std::forward<Args>(args)...);
+                reserve(std::max<size_t>(1, _capacity * 2));
+                new (_data + _size) T(std::move(value));
+            }
+            else
+            {
+                new (_data + _size) T(std::forward<Args>(args)...);
+            }
+            ++_size;
+        }
+
+        void push_back(const T& value) {emplace_back(value);}
+        void push_back(T&& value) {emplace_back(std::move(value));}
+        void push_front(const T& value) {insert(begin(), value);}
+        void push_front(T&& value) {insert(begin(), std::move(value));}
+
+        void pop_back()
+        {
+            _data[--_size].~T();
+        }
+
+        void pop_front()
+        {
+            erase(begin());
+        }
+
+        iterator insert(const_iterator pos, T value)
+        {
+            size_t index = pos - _data;
+            emplace_back(std::move(value));
+            std::rotate(_data + index, _data + _size - 1, _data + _size);
+            return _data + index;
+        }
+
+        iterator erase(const_iterator pos)
+        {
+            return erase(pos, pos + 1);
+        }
+
+        iterator erase(const_iterator first, const_iterator last)
+        {
+            size_t index = first - _data;
+            size_t count = last - first;
+            if (count == 0)
+                return _data + index;
+
+            std::move(_data + index + count, _data + _size, _data + index);
+            for (size_t i = _size - count; i < _size; ++i)
+                _data[i].~T();
+            _size -= count;
+
+            return _data + index;
+        }
+
+        void swap(SmallVector& v)
+        {
+            SmallVector tmp(std::move(v));
+            v = std::move(*this);
+            *this = std::move(tmp);
+        }
+
+    private:
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type _inline[N];
+        T* _data {inlineData()};
+        size_t _size {0};
+        size_t _capacity {N};
+
+        inline T* inlineData() {return reinterpret_cast<T*>(_inline);}
+
+        /**
+         * Move the content of v, which is left empty. Current content must be empty
+         */
+        void moveFrom(SmallVector&& v)
+        {
+            if (v._data != v.inlineData())
+            {
+                // Steal the heap storage
+                _data = v._data;
+                _capacity = v._capacity;
+                _size = v._size;
+                v._data = v.inlineData();
+                v._capacity = N;
+                v._size = 0;
+            }
+            else
+            {
+                for (size_t i = 0; i < v._size; ++i)
+                {
+                    new (_data + i) T(std::move(v._data[i]));
+                    v._data[i].~T();
+                }
+                _size = v._size;
+                v._size = 0;
+            }
+        }
+};
+
+/*************/
 struct Value;
-typedef std::deque<Value> Values;
+typedef SmallVector<Value, 4> Values;
 
 /*************/
+// Tagged union holding one of the supported types
 struct Value
 {
     public:
@@ -339,76 +753,59 @@ struct Value
         Value(int64_t v) {_l = v; _type = Type::l;}
         Value(float v) {_f = v; _type = Type::f;}
         Value(double v) {_f = (float)v; _type = Type::f;}
-        Value(std::string v) {_s = v; _type = Type::s;}
-        Value(const char* c) {_s = std::string(c); _type = Type::s;}
-        Value(Values v)
+        Value(const std::string& v) {new (&_s) std::string(v); _type = Type::s;}
+        Value(std::string&& v) {new (&_s) std::string(std::move(v)); _type = Type::s;}
+        Value(const char* c) {new (&_s) std::string(c); _type = Type::s;}
+        Value(const Values& v);
+        Value(Values&& v);
+
+        template<class InputIt>
+        Value(InputIt first, InputIt last);
+
+        Value(const Value& v)
         {
-            _v = std::unique_ptr<Values>(new Values());
-            *_v = v; 
-            _type = Type::v;
+            copyFrom(v);
         }
 
-        Value(const Value& v)
+        Value(Value&& v) noexcept
         {
-            operator=(v);
+            moveFrom(std::move(v));
+        }
+
+        ~Value()
+        {
+            reset();
         }
 
         Value& operator=(const Value& v)
         {
-            if (this != &v)
-            {
-                _type = v._type;
-                _i = v._i;
-                _l = v._l;
-                _f = v._f;
+            if (this == &v)
+                return *this;
+
+            if (_type == Type::s && v._type == Type::s)
                 _s = v._s;
-                _v = std::unique_ptr<Values>(new Values());
-                if (v._v)
-                    *_v = *(v._v);
+            else
+            {
+                reset();
+                copyFrom(v);
             }
 
             return *this;
         }
 
-        template<class InputIt>
-        Value(InputIt first, InputIt last)
+        Value& operator=(Value&& v) noexcept
         {
-            _type = Type::v;
-            _v = std::unique_ptr<Values>(new Values());
+            if (this == &v)
+                return *this;
 
-            auto it = first;
-            while (it != last)
-            {
-                _v->push_back(Value(*it));
-                ++it;
-            }
-        }
+            reset();
+            moveFrom(std::move(v));
 
-        bool operator==(Value v) const
-        {
-            if (_type != v._type)
-                return false;
-            else if (_type == Type::i)
-                return _i == v._i;
-            else if (_type == Type::l)
-                return _l == v._l;
-            else if (_type == Type::f)
-                return _f == v._f;
-            else if (_type == Type::s)
-                return _s == v._s;
-            else if (_type == Type::v)
-            {
-                if (_v->size() != v._v->size())
-                    return false;
-                bool isEqual = true;
-                for (int i = 0; i < _v->size(); ++i)
-                    isEqual &= (_v->at(i) == v._v->at(i));
-                return isEqual;
-            }
-            else
-                return false;
+            return *this;
         }
 
+        bool operator==(const Value& v) const;
+
         Value& operator[](int index)
         {
             if (_type != Type::v)
@@ -479,23 +876,15 @@ struct Value
                 return "";
         }
 
-        Values asValues() const
-        {
-            if (_type == Type::i)
-                return {_i};
-            else if (_type == Type::l)
-                return {_l};
-            else if (_type == Type::f)
-                return {_f};
-            else if (_type == Type::s)
-                return {_s};
-            else if (_type == Type::v)
-                return *_v;
-            else
-                return {};
-        }
+        Values asValues() const;
 
-        void* data()
+        /**
+         * Get a reference to the nested Values, without copying them
+         * Returns an empty Values if this is not a nested Values
+         */
+        const Values& getValues() const;
+
+        void* data() const
         {
             if (_type == Type::i)
                 return (void*)&_i;
@@ -514,6 +903,8 @@ struct Value
         {
             switch (_type)
             {
+            default:
+                return 'n';
             case i:
                 return 'n';
             case l:
@@ -527,7 +918,7 @@ struct Value
             }
         }
         
-        int size()
+        int size() const
         {
             if (_type == Type::i)
                 return sizeof(_i);
@@ -543,13 +934,157 @@ struct Value
 
     private:
         Type _type;
-        int _i {0};
-        int64_t _l {0};
-        float _f {0.f};
-        std::string _s {""};
-        std::unique_ptr<Values> _v {nullptr};
+        union
+        {
+            int _i;
+            int64_t _l;
+            float _f;
+            std::string _s;
+            Values* _v; // Nested Values are held on the heap, as Values holds Value inline
+        };
+
+        inline void copyFrom(const Value& v);
+        inline void moveFrom(Value&& v);
+        inline void reset();
 };
 
+/*************/
+inline Value::Value(const Values& v)
+{
+    _v = new Values(v);
+    _type = Type::v;
+}
+
+/*************/
+inline Value::Value(Values&& v)
+{
+    _v = new Values(std::move(v));
+    _type = Type::v;
+}
+
+/*************/
+template<class InputIt>
+Value::Value(InputIt first, InputIt last)
+{
+    _v = new Values();
+    _type = Type::v;
+
+    auto it = first;
+    while (it != last)
+    {
+        _v->push_back(Value(*it));
+        ++it;
+    }
+}
+
+/*************/
+inline bool Value::operator==(const Value& v) const
+{
+    if (_type != v._type)
+        return false;
+    else if (_type == Type::i)
+        return _i == v._i;
+    else if (_type == Type::l)
+        return _l == v._l;
+    else if (_type == Type::f)
+        return _f == v._f;
+    else if (_type == Type::s)
+        return _s == v._s;
+    else if (_type == Type::v)
+        return *_v == *v._v;
+    else
+        return false;
+}
+
+/*************/
+inline Values Value::asValues() const
+{
+    if (_type == Type::i)
+        return {_i};
+    else if (_type == Type::l)
+        return {_l};
+    else if (_type == Type::f)
+        return {_f};
+    else if (_type == Type::s)
+        return {_s};
+    else if (_type == Type::v)
+        return *_v;
+    else
+        return {};
+}
+
+/*************/
+inline const Values& Value::getValues() const
+{
+    static const Values emptyValues {};
+    if (_type == Type::v)
+        return *_v;
+    else
+        return emptyValues;
+}
+
+/*************/
+inline void Value::copyFrom(const Value& v)
+{
+    _type = v._type;
+    switch (_type)
+    {
+    case Type::i:
+        _i = v._i;
+        break;
+    case Type::l:
+        _l = v._l;
+        break;
+    case Type::f:
+        _f = v._f;
+        break;
+    case Type::s:
+        new (&_s) std::string(v._s);
+        break;
+    case Type::v:
+        _v = new Values(*v._v);
+        break;
+    }
+}
+
+/*************/
+inline void Value::moveFrom(Value&& v)
+{
+    _type = v._type;
+    switch (_type)
+    {
+    case Type::i:
+        _i = v._i;
+        break;
+    case Type::l:
+        _l = v._l;
+        break;
+    case Type::f:
+        _f = v._f;
+        break;
+    case Type::s:
+        new (&_s) std::string(std::move(v._s));
+        break;
+    case Type::v:
+        // The moved-from value is left as a default integer
+        _v = v._v;
+        v._type = Type::i;
+        v._i = 0;
+        break;
+    }
+}
+
+/*************/
+inline void Value::reset()
+{
+    if (_type == Type::s)
+        _s.~basic_string();
+    else if (_type == Type::v)
+        delete _v;
+    _type = Type::i;
+    _i = 0;
+}
+
 /*************/
 // OnScopeExit, taken from Switcher (https://github.com/nicobou/switcher)
 template <typename F>
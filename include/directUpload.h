@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2016 Emmanuel Durand
+ *
+ * This file is part of Splash.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Splash is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splash.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * @directUpload.h
+ * The DirectUploadTarget and DirectUpload classes, which let an Image of the World
+ * write its frames directly to the mapped buffers of a Texture_Image of the inner Scene,
+ * bypassing serialization
+ */
+
+#ifndef SPLASH_DIRECT_UPLOAD_H
+#define SPLASH_DIRECT_UPLOAD_H
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "imageBuffer.h"
+
+#define SPLASH_DIRECT_UPLOAD_SLOTS 3
+
+namespace Splash
+{
+
+/*************/
+class DirectUploadTarget
+{
+    public:
+        /**
+         * Constructor
+         * Buffers must hold SPLASH_DIRECT_UPLOAD_SLOTS pointers to memory big enough for the given spec,
+         * which stays valid until close() returns
+         */
+        DirectUploadTarget(const ImageBufferSpec& spec, const std::vector<char*>& buffers);
+
+        /**
+         * Producer side: write a frame to a free slot, or over the frame waiting for upload
+         * The copy function is called with the destination memory
+         * Returns false if the frame can not go through this target (spec mismatch or target closed)
+         * If the texture is late, the frame is dropped and true is returned
+         */
+        bool write(ImageBufferSpec spec, const std::function<void(char*)>& copy);
+
+        /**
+         * Consumer side: get the most recent slot ready for upload, and mark it as being uploaded
+         * Returns -1 if there is none
+         */
+        int acquireReadySlot();
+
+        /**
+         * Consumer side: get the provenance of the frame in a slot acquired with acquireReadySlot
+         */
+        int64_t getSlotTimestamp(int index) const {return _slots[index].timestamp;}
+        uint64_t getSlotFrameIndex(int index) const {return _slots[index].frameIndex;}
+
+        /**
+         * Consumer side: release a slot once its upload is done
+         */
+        void releaseSlot(int index);
+
+        /**
+         * Consumer side: prevent any further write, and wait for the current one to finish
+         */
+        void close();
+
+        /**
+         * Get the number of frames dropped since the creation of the target
+         */
+        uint64_t getDroppedFrames() const {return _dropped;}
+
+        /**
+         * Get the spec of the frames accepted by this target
+         */
+        ImageBufferSpec getSpec() const {return _spec;}
+
+    private:
+        enum SlotState
+        {
+            FREE = 0,
+            WRITING,
+            READY,
+            UPLOADING
+        };
+
+        struct Slot
+        {
+            char* data {nullptr};
+            std::atomic_int state {FREE};
+            std::atomic<uint64_t> sequence {0};
+            // Provenance of the frame, only accessed by the side owning the slot
+            int64_t timestamp {-1};
+            uint64_t frameIndex {0};
+        };
+
+        ImageBufferSpec _spec;
+        Slot _slots[SPLASH_DIRECT_UPLOAD_SLOTS];
+        std::atomic<uint64_t> _sequence {0};
+        std::atomic<uint64_t> _dropped {0};
+        std::atomic_bool _closed {false};
+};
+
+/*************/
+class DirectUpload
+{
+    public:
+        /**
+         * Get the singleton
+         */
+        static DirectUpload& get()
+        {
+            static auto instance = new DirectUpload;
+            return *instance;
+        }
+
+        /**
+         * Set whether the direct path should be used. The World activates it when
+         * the inner Scene is its only peer, as other Scenes still need serialized frames
+         */
+        void setActive(bool active) {_active = active;}
+        bool isActive() const {return _active;}
+
+        /**
+         * Register a target for the image of the given name
+         * If more than one target is registered for the same name, none of them is used
+         */
+        void registerTarget(const std::string& name, const std::shared_ptr<DirectUploadTarget>& target);
+
+        /**
+         * Unregister a target
+         */
+        void unregisterTarget(const std::string& name, const std::shared_ptr<DirectUploadTarget>& target);
+
+        /**
+         * Get the target for the image of the given name, or nullptr if there is none usable
+         */
+        std::shared_ptr<DirectUploadTarget> getTarget(const std::string& name);
+
+    private:
+        std::atomic_bool _active {false};
+        std::mutex _mutex {};
+        std::map<std::string, std::vector<std::shared_ptr<DirectUploadTarget>>> _targets {};
+
+        DirectUpload() = default;
+        DirectUpload(const DirectUpload&) = delete;
+        DirectUpload& operator=(const DirectUpload&) = delete;
+};
+
+} // end of namespace
+
+#endif // SPLASH_DIRECT_UPLOAD_H
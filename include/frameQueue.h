@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2016 Emmanuel Durand
+ *
+ * This file is part of Splash.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Splash is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splash.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * @frameQueue.h
+ * The FrameQueue class, a bounded single producer / single consumer queue
+ * of preallocated slots, used to pass frames from a decoder to a display thread
+ */
+
+#ifndef SPLASH_FRAME_QUEUE_H
+#define SPLASH_FRAME_QUEUE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace Splash
+{
+
+/*************/
+template <typename T>
+class FrameQueue
+{
+    public:
+        /**
+         * Constructor
+         */
+        FrameQueue(size_t depth = 2)
+        {
+            reset(depth, 0);
+        }
+
+        /**
+         * No copy constructor
+         */
+        FrameQueue(const FrameQueue&) = delete;
+        FrameQueue& operator=(const FrameQueue&) = delete;
+
+        /**
+         * Empty the queue and set its capacity, in slots and in bytes (0 for no byte limit)
+         * Slots are kept from one reset to another so that their content can be reused
+         * Must not be called while a producer or a consumer uses the queue
+         */
+        void reset(size_t depth, size_t maxBytes)
+        {
+            _depth = std::max<size_t>(depth, 1);
+            _maxBytes = maxBytes;
+            _slots.resize(_depth);
+            _slotBytes.assign(_depth, 0);
+            _head = 0;
+            _tail = 0;
+            _bytes = 0;
+            _stopped = false;
+        }
+
+        /**
+         * Wake up the producer and the consumer, and make them return immediately from now on
+         */
+        void stop()
+        {
+            _stopped = true;
+            std::lock_guard<std::mutex> lock(_mutex);
+            _condition.notify_all();
+        }
+
+        /**
+         * Producer side: get the next free slot, waiting for one to be available
+         * The slot still holds what it held the last time it was used, to be recycled
+         * Ahead allows for filling several slots at once: it is the number of slots
+         * already acquired and not yet published, which come before the returned one
+         * Returns nullptr if the queue has been stopped
+         */
+        T* acquire(size_t ahead = 0)
+        {
+            if (isFull(ahead))
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _waiting++;
+                _condition.wait(lock, [&]() {return _stopped || !isFull(ahead);});
+                _waiting--;
+            }
+
+            if (_stopped)
+                return nullptr;
+
+            return &_slots[(_head + ahead) % _depth];
+        }
+
+        /**
+         * Producer side: make the oldest slot given by acquire available to the consumer
+         */
+        void publish(size_t bytes)
+        {
+            _slotBytes[_head % _depth] = bytes;
+            _bytes += bytes;
+            _head++;
+            wakeUp();
+        }
+
+        /**
+         * Consumer side: get the oldest slot, waiting at most for the given timeout
+         * Returns nullptr if the queue is still empty, or if it has been stopped
+         */
+        template <typename Rep, typename Period>
+        T* front(const std::chrono::duration<Rep, Period>& timeout)
+        {
+            if (_head == _tail && !_stopped)
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _waiting++;
+                _condition.wait_for(lock, timeout, [&]() {return _stopped || _head != _tail;});
+                _waiting--;
+            }
+
+            if (_stopped || _head == _tail)
+                return nullptr;
+
+            return &_slots[_tail % _depth];
+        }
+
+        /**
+         * Consumer side: get the slot following the oldest one, or nullptr if there is none
+         */
+        T* second()
+        {
+            if (_head - _tail < 2)
+                return nullptr;
+            return &_slots[(_tail + 1) % _depth];
+        }
+
+        /**
+         * Consumer side: release the oldest slot
+         */
+        void pop()
+        {
+            _bytes -= _slotBytes[_tail % _depth];
+            _tail++;
+            wakeUp();
+        }
+
+        /**
+         * Get the number of slots waiting for the consumer
+         */
+        size_t size() const {return _head - _tail;}
+
+        /**
+         * Get the number of bytes waiting for the consumer
+         */
+        size_t bytes() const {return _bytes;}
+
+    private:
+        std::vector<T> _slots {};
+        std::vector<size_t> _slotBytes {};
+        size_t _depth {1};
+        size_t _maxBytes {0};
+
+        // The producer only writes _head, the consumer only writes _tail
+        std::atomic<uint64_t> _head {0};
+        std::atomic<uint64_t> _tail {0};
+        std::atomic<size_t> _bytes {0};
+        std::atomic_bool _stopped {false};
+
+        // Only used to sleep when the queue is full or empty
+        std::mutex _mutex {};
+        std::condition_variable _condition {};
+        std::atomic_int _waiting {0};
+
+        bool isFull(size_t ahead = 0) const
+        {
+            auto count = _head - _tail + ahead;
+            // The byte limit never prevents a frame from being queued in an empty queue
+            return count >= _depth || (_maxBytes != 0 && count != 0 && _bytes >= _maxBytes);
+        }
+
+        void wakeUp()
+        {
+            // The other side checks its condition after declaring itself as waiting,
+            // so the lock is only needed when someone is waiting
+            if (_waiting == 0)
+                return;
+            std::lock_guard<std::mutex> lock(_mutex);
+            _condition.notify_all();
+        }
+};
+
+} // end of namespace
+
+#endif // SPLASH_FRAME_QUEUE_H
@@ -38,6 +38,8 @@
 #include "gpuBuffer.h"
 #include "mesh.h"
 
+#define SPLASH_GEOMETRY_LIVE_MESH_UPDATES 8 // A mesh uploaded again within this number of updates is considered as live
+
 namespace Splash {
 
 class Geometry : public BufferObject
@@ -86,6 +88,22 @@ class Geometry : public BufferObject
          */
         int getVerticesNumber() const {return _useAlternativeBuffers ? _alternativeVerticesNumber : _verticesNumber;}
 
+        /**
+         * Get the number of indices to draw, if the geometry is indexed
+         */
+        int getIndicesNumber() const {return _indicesNumber;}
+
+        /**
+         * Get the offset in bytes of the indices in the element buffer
+         */
+        size_t getIndicesOffset() const {return _glIndexBuffer ? _glIndexBuffer->getOffset() : 0;}
+
+        /**
+         * Get whether the geometry has to be drawn with its indices
+         * The alternative buffers are never indexed
+         */
+        bool isIndexed() const {return !_useAlternativeBuffers && _indicesNumber != 0;}
+
         /**
          * Get the geometry as serialized
          */
@@ -111,6 +129,13 @@ class Geometry : public BufferObject
          */
         float pickVertex(glm::dvec3 p, glm::dvec3& v);
 
+        /**
+         * Reset the alternative buffers to the base geometry, and use them
+         * The blending stores data per primitive, so indexed geometries are expanded to a triangle soup
+         * Non-indexed geometries simply go back to their base buffers
+         */
+        void resetAlternativeBuffers();
+
         /**
          * Specify the number of vertices to draw
          */
@@ -126,6 +151,16 @@ class Geometry : public BufferObject
          */
         void swapBuffers();
 
+        /**
+         * Prevent the buffers from being uploaded to, while they are drawn from several contexts
+         * Only the vertex arrays of the current context are updated then
+         */
+        void setUploadLocked(bool locked)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _uploadLocked = locked;
+        }
+
         /**
          * Updates the object
          */
@@ -142,16 +177,24 @@ class Geometry : public BufferObject
 
         std::shared_ptr<Mesh> _defaultMesh;
         std::weak_ptr<Mesh> _mesh;
+        std::weak_ptr<Mesh> _uploadedMesh; // Mesh currently held in the buffers
+        int _meshUploads {0}; // Number of uploads of the current mesh
+        int _updatesSinceUpload {0};
 
         std::map<GLFWwindow*, GLuint> _vertexArray;
+        std::map<GLFWwindow*, int> _vertexArrayVersion; // Version of the buffers each vertex array points to
+        int _buffersVersion {0}; // Increased when the buffers, or the regions of streamed buffers, change
         std::vector<std::shared_ptr<GpuBuffer>> _glBuffers {};
+        std::shared_ptr<GpuBuffer> _glIndexBuffer {}; // Element buffer for the base buffers, if the mesh is indexed
         std::vector<std::shared_ptr<GpuBuffer>> _glAlternativeBuffers {}; // Alternative buffers used for rendering
         std::vector<std::shared_ptr<GpuBuffer>> _glTemporaryBuffers {}; // Temporary buffers used for feedback
         bool _buffersDirty {false};
+        bool _uploadLocked {false};
         bool _buffersResized {false}; // Holds whether the alternative buffers have been resized in the previous feedback
         bool _useAlternativeBuffers {false};
 
         int _verticesNumber {0};
+        int _indicesNumber {0};
         int _alternativeVerticesNumber {0};
         int _alternativeBufferSize {0};
         int _temporaryVerticesNumber {0};
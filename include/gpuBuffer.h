@@ -36,6 +36,9 @@
 #include "basetypes.h"
 #include "mesh.h"
 
+#define SPLASH_GPU_BUFFER_RING_SIZE 3 // Number of regions of streamed buffers
+#define SPLASH_GPU_BUFFER_FENCE_TIMEOUT 100000000 // Maximum wait for a region to be released by the GPU, in ns
+
 namespace Splash {
 
 class GpuBuffer
@@ -44,6 +47,8 @@ class GpuBuffer
         /**
          * Constructor
          * size is given as the number of elements
+         * Buffers created with the GL_STREAM_DRAW usage are meant to be updated often. If supported, they are
+         * allocated as a persistently mapped ring of SPLASH_GPU_BUFFER_RING_SIZE regions, written in place
          */
         GpuBuffer(GLint elementSize, GLenum type, GLenum usage, size_t size, GLvoid* data = nullptr);
 
@@ -82,6 +87,7 @@ class GpuBuffer
 
         /**
          * Fill the buffer with 0
+         * Streamed buffers get their next region filled, as with setData
          */
         void clear();
 
@@ -90,6 +96,16 @@ class GpuBuffer
          */
         inline GLuint getId() const {return _glId;}
 
+        /**
+         * Get the offset in bytes of the region to read from, which is not null only for streamed buffers
+         */
+        inline size_t getOffset() const {return _ringIndex * getMemorySize();}
+
+        /**
+         * Get whether the buffer is a persistently mapped ring
+         */
+        inline bool isStreamed() const {return _mappedData != nullptr;}
+
         /**
          * Get the size of the buffer
          */
@@ -126,6 +142,13 @@ class GpuBuffer
          */
         void setBufferFromVector(const std::vector<char>& buffer);
 
+        /**
+         * Set the content of the buffer without reallocating it, size being given as the number of elements
+         * Streamed buffers are written to the next region of their ring, once the GPU is done with it
+         * Returns false if the data does not fit in the buffer
+         */
+        bool setData(const GLvoid* data, size_t size);
+
     private:
         GLuint _glId {0};
         size_t _size {0};
@@ -135,6 +158,27 @@ class GpuBuffer
         GLenum _usage {0};
 
         GLuint _copyBufferId {0};
+
+        // Streaming
+        char* _mappedData {nullptr}; // Persistently mapped storage, holding all the regions
+        unsigned int _ringIndex {0}; // Region to read from
+        GLsync _ringFences[SPLASH_GPU_BUFFER_RING_SIZE] {}; // Fences set when leaving each region
+
+        /**
+         * Allocate the storage of the currently bound buffer as a persistently mapped ring
+         * Returns false if not supported, in which case nothing has been allocated
+         */
+        bool allocateRing(const GLvoid* data);
+
+        /**
+         * Fence the region of the ring read until now, and get the next one once the GPU is done with it
+         */
+        char* getNextRegion();
+
+        /**
+         * Release the ring fences
+         */
+        void releaseFences();
 };
 
 } // end of namespace
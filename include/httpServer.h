@@ -201,7 +201,8 @@ namespace Http {
                 nop,
                 get,
                 set,
-                scene
+                scene,
+                stats
             };
     
             struct Command
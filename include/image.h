@@ -133,9 +133,23 @@ class Image : public BufferObject
         bool _flop {false};
         bool _imageUpdated {false};
         bool _srgb {true};
+        bool _gpuYUV {true}; //< If true, YUV sources are sent as is and converted to RGB by the GPU
         bool _benchmark {false};
         bool _worldObject {false};
 
+        ImageBufferSpec::Header _deserializeHeader {}; //< Header of the last deserialized frame, its spec being cached
+        ImageBufferSpec _deserializeSpec {};
+        uint64_t _sourceFrameIndex {0}; //< Index of the last frame stamped by the source
+
+        /**
+         * Set the provenance of a frame the source captured or decoded at the given time, before handing it to the image
+         * Only to be called from the thread reading the source
+         */
+        void stampFrame(ImageBuffer& buffer, int64_t timestamp)
+        {
+            buffer.setProvenance(timestamp, ++_sourceFrameIndex);
+        }
+
         void createDefaultImage(); //< Create a default black image
         void createPattern(); //< Create a default pattern
 
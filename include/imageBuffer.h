@@ -82,6 +82,10 @@ class ImageBufferSpec
         Type type {Type::UINT8};
         std::vector<std::string> format {};
 
+        // Provenance of the frame, which is not compared between specs
+        int64_t timestamp {-1}; //< Time at which the source captured or decoded the frame, in us (see Timer::getTime), -1 if unknown
+        uint64_t frameIndex {0}; //< Index of the frame in its source
+
         inline bool operator==(const ImageBufferSpec& spec)
         {
             if (width != spec.width)
@@ -106,6 +110,15 @@ class ImageBufferSpec
         std::string to_string();
         void from_string(const std::string& spec);
 
+        /**
+         * Get the binary header describing this spec, and set the spec from such a header
+         * Formats without a code are written as a string, which goes right after the header
+         * fromHeader returns false if the header is not valid
+         */
+        struct Header;
+        Header toHeader(std::string& customFormat) const;
+        bool fromHeader(const Header& header, const char* customFormat);
+
         int pixelBytes()
         {
             int bytes = channels;
@@ -130,6 +143,54 @@ class ImageBufferSpec
         }
 };
 
+/*************/
+/**
+ * Fixed layout header sent in front of the pixels of a serialized image
+ * It is copied as is, so it must stay trivially copyable
+ */
+struct ImageBufferSpec::Header
+{
+    static const uint32_t MAGIC = 0x494c5053; // "SPLI"
+    static const uint32_t VERSION = 1;
+
+    // Codes of the known formats, Custom being any other format
+    enum FormatCode : uint32_t
+    {
+        Custom = 0,
+        R,
+        RG,
+        RGB,
+        RGBA,
+        BGR,
+        BGRA,
+        RGB_DXT1,
+        RGBA_DXT5,
+        YCoCg_DXT5,
+        YUV_I420,
+        YUV_UYVY
+    };
+
+    uint32_t magic {MAGIC};
+    uint32_t version {VERSION};
+    uint32_t width {0};
+    uint32_t height {0};
+    uint32_t channels {0};
+    uint32_t type {0};
+    uint32_t formatCode {Custom};
+    uint32_t formatSize {0}; //< Size of the custom format string, if formatCode is Custom
+    int64_t timestamp {0};
+    uint64_t frameIndex {0};
+
+    /**
+     * Check whether the given header describes the same spec, regardless of its provenance
+     */
+    bool sameSpec(const Header& header) const
+    {
+        return width == header.width && height == header.height && channels == header.channels
+            && type == header.type && formatCode == header.formatCode && formatSize == header.formatSize;
+    }
+};
+
 /*************/
 class ImageBuffer
 {
@@ -158,6 +219,15 @@ class ImageBuffer
 
         ImageBufferSpec getSpec() {return _spec;}
 
+        /**
+         * Set the provenance of the frame held by the buffer
+         */
+        void setProvenance(int64_t timestamp, uint64_t frameIndex)
+        {
+            _spec.timestamp = timestamp;
+            _spec.frameIndex = frameIndex;
+        }
+
         void fill(float value);
 
         /**
@@ -168,6 +238,15 @@ class ImageBuffer
         {
             _buffer = std::move(buffer);
         }
+
+        /**
+         * Set the inner raw buffer along with the spec it matches, to use with caution
+         */
+        void setRawBuffer(ResizableArray<char>&& buffer, const ImageBufferSpec& spec)
+        {
+            _spec = spec;
+            _buffer = std::move(buffer);
+        }
         
     private:
         ImageBufferSpec _spec {};
@@ -38,11 +38,13 @@ extern "C" {
 #include <libavformat/avformat.h>
 #include <libavutil/avutil.h>
 #include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
 #include <libswscale/swscale.h>
 }
 
 #include "coretypes.h"
 #include "basetypes.h"
+#include "frameQueue.h"
 #include "image.h"
 #if HAVE_PORTAUDIO
     #include "speaker.h"
@@ -85,11 +87,16 @@ class Image_FFmpeg : public Image
         {
             std::unique_ptr<ImageBuffer> frame {};
             int64_t timing {0ull}; // in us
+            uint32_t seekIndex {0}; // Value of _seekIndex when the frame was decoded
         };
-        std::deque<TimedFrame> _timedFrames;
-        std::mutex _videoQueueMutex;
+        FrameQueue<TimedFrame> _timedFrames {};
+        int _queueDepth {8}; // Maximum number of frames decoded ahead
+        int _queueMaxSize {0}; // Maximum size of the decoded frames, in MB, 0 for no limit
+        std::atomic<uint64_t> _framesDropped {0}; // Frames skipped by the display loop, as they were late
+        std::atomic<uint64_t> _underruns {0}; // Frames displayed late because the queue was empty
         std::mutex _videoSeekMutex;
-        std::condition_variable _videoQueueCondition;
+        std::atomic_int _seeking {0}; // Number of seeks in progress
+        std::atomic<uint32_t> _seekIndex {0}; // Incremented at each seek
 
         std::atomic_bool _timeJump {false};
 
@@ -109,6 +116,7 @@ class Image_FFmpeg : public Image
         double _timeBase {0.033};
         AVCodecContext* _videoCodecContext {nullptr};
         int _videoStreamIndex {-1};
+        int _decodeThreads {0}; // 0 lets FFmpeg choose
 
 #if HAVE_PORTAUDIO
         std::unique_ptr<Speaker> _speaker;
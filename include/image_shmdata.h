@@ -66,6 +66,7 @@ class Image_Shmdata : public Image
         std::unique_ptr<shmdata::Follower> _reader {nullptr};
 
         ImageBuffer _readerBuffer;
+        int64_t _frameArrival {0}; // Time at which the frame being read was received
         std::string _inputDataType {""};
         int _bpp {0};
         int _width {0};
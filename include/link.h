@@ -37,6 +37,7 @@
 
 #include "config.h"
 #include "coretypes.h"
+#include "sharedMemoryRing.h"
 
 namespace Splash {
 
@@ -82,6 +83,13 @@ class Link
         template <typename T>
         bool sendMessage(const std::string& name, const std::string& attribute, const std::vector<T>& message);
 
+        /**
+         * Activate the shared memory transport for buffers sent to other processes
+         * Buffers are then copied to a ring of shared memory slots, and only a notification goes through the socket
+         * Buffers bigger than slotSize are still sent through the socket
+         */
+        void setSharedMemoryTransport(bool active, size_t slotSize = SPLASH_SHM_DEFAULT_SLOT_SIZE);
+
         /**
          * Check that all buffers were sent to the client
          */
@@ -109,6 +117,9 @@ class Link
         std::mutex _otgMutex;
         std::atomic_int _otgNumber {0};
 
+        std::unique_ptr<SharedMemoryRing> _shmBufferOut {nullptr};
+        std::map<std::string, std::unique_ptr<SharedMemoryRing>> _shmBuffersIn;
+
         std::thread _bufferInThread;
         std::thread _messageInThread;
 
@@ -126,6 +137,16 @@ class Link
          * Buffer input thread function
          */
         void handleInputBuffers();
+
+        /**
+         * Read a buffer from shared memory, given the notification received through the buffer socket
+         */
+        std::shared_ptr<SerializedObject> readSharedMemoryBuffer(const zmq::message_t& msg);
+
+        /**
+         * Send a buffer through shared memory, returns false if it has to be sent through the socket
+         */
+        bool sendSharedMemoryBuffer(const std::string& name, const std::shared_ptr<SerializedObject>& buffer);
 };
 
 /*************/
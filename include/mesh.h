@@ -29,6 +29,7 @@
 #include <memory>
 #include <mutex>
 #include <vector>
+#include <sys/stat.h>
 #include <glm/glm.hpp>
 
 #include "config.h"
@@ -84,6 +85,12 @@ class Mesh : public BufferObject
          */
         virtual std::vector<float> getAnnexe() const;
 
+        /**
+         * Get the vertex indices of the triangles, three per triangle
+         * An empty vector means that the vertices form a triangle soup
+         */
+        virtual std::vector<unsigned int> getIndices() const;
+
         /**
          * Read / update the mesh
          */
@@ -113,6 +120,7 @@ class Mesh : public BufferObject
             std::vector<glm::vec2> uvs;
             std::vector<glm::vec3> normals;
             std::vector<glm::vec4> annexe;
+            std::vector<unsigned int> indices; // Empty for a triangle soup
         };
 
         std::string _filepath {};
@@ -125,6 +133,17 @@ class Mesh : public BufferObject
     private:
         void init();
 
+        /**
+         * Read the binary cache of the given mesh file, if it is up to date with it
+         */
+        bool readCache(const std::string& filepath, MeshContainer& mesh) const;
+
+        /**
+         * Write the binary cache of the given mesh file, next to it
+         * The source stat has to be taken before parsing the mesh
+         */
+        void writeCache(const std::string& filepath, const struct stat& sourceStat, const MeshContainer& mesh) const;
+
         /**
          * Create a plane mesh, subdivided according to the parameter
          */
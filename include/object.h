@@ -162,6 +162,22 @@ class Object : public BaseObject
          */
         void setViewProjectionMatrix(const glm::dmat4& mv, const glm::dmat4& mp);
 
+        /**
+         * Uniforms of the object as seen from a camera, laid out as the std140 _objectBlock of the shaders
+         */
+        struct UniformBlock
+        {
+            glm::mat4 modelViewProjectionMatrix;
+            glm::mat4 normalMatrix;
+            glm::vec3 scale;
+            float normalExp;
+        };
+
+        /**
+         * Get the uniform block for the given view and projection matrices
+         */
+        UniformBlock getUniformBlock(const glm::dmat4& mv, const glm::dmat4& mp) const;
+
         /**
          * Set the model matrix. This overrides the position attribute
          */
@@ -186,8 +202,8 @@ class Object : public BaseObject
         ShaderPtr _computeShaderTransferVisibilityToAttr {};
         ShaderPtr _feedbackShaderSubdivideCamera {};
 
-        // A map for previously used graphics shaders
-        std::map<std::string, ShaderPtr> _graphicsShaders;
+        // A map for previously used graphics shaders, for each context drawing the object
+        std::map<GLFWwindow*, std::map<std::string, ShaderPtr>> _graphicsShaders;
 
         std::vector<TexturePtr> _textures;
         std::vector<GeometryPtr> _geometries;
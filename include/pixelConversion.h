@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2016 Emmanuel Durand
+ *
+ * This file is part of Splash.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Splash is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splash.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * @pixelConversion.h
+ * Pixel format conversions done on the CPU, with SIMD implementations
+ * selected at runtime according to the instruction sets of the processor
+ *
+ * YUV to RGB conversions follow BT.601 (limited range), in fixed point,
+ * and all implementations give exactly the same result
+ */
+
+#ifndef SPLASH_PIXEL_CONVERSION_H
+#define SPLASH_PIXEL_CONVERSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Splash
+{
+    namespace PixelConversion
+    {
+        enum class Isa
+        {
+            Scalar,
+            SSE41,
+            AVX2
+        };
+
+        /**
+         * Get the instruction set in use, which defaults to the best one supported
+         */
+        Isa getIsa();
+
+        /**
+         * Force the instruction set to use, for testing purposes
+         * Returns false if it is not supported by this processor
+         */
+        bool setIsa(Isa isa);
+
+        /**
+         * Get a readable name for the instruction set
+         */
+        std::string getIsaName(Isa isa);
+
+        /**
+         * Convert lines [firstLine, lastLine[ of an I420 image to RGB (dstChannels == 3) or RGBA (dstChannels == 4)
+         * Width must be even, planes are expected to be contiguous
+         */
+        void i420ToRGB(const uint8_t* y, const uint8_t* u, const uint8_t* v, int width, uint8_t* dst, int dstChannels, int firstLine, int lastLine);
+
+        /**
+         * Convert lines [firstLine, lastLine[ of an UYVY image to RGB (dstChannels == 3) or RGBA (dstChannels == 4)
+         * Width must be even
+         */
+        void uyvyToRGB(const uint8_t* src, int width, uint8_t* dst, int dstChannels, int firstLine, int lastLine);
+
+        /**
+         * Convert the given number of RGB pixels to RGBA, with an opaque alpha
+         */
+        void rgbToRGBA(const uint8_t* src, size_t pixels, uint8_t* dst);
+    } // end of namespace
+} // end of namespace
+
+#endif // SPLASH_PIXEL_CONVERSION_H
@@ -25,6 +25,7 @@
 #ifndef SPLASH_QUEUE_H
 #define SPLASH_QUEUE_H
 
+#include <condition_variable>
 #include <list>
 #include <memory>
 #include <string>
@@ -110,6 +111,22 @@ class Queue : public BufferObject
         std::shared_ptr<BufferObject> _currentSource; // The source being played
         bool _defaultSource {false};
 
+        struct PreparedSource
+        {
+            std::mutex mutex {};
+            std::condition_variable condition {};
+            std::shared_ptr<BufferObject> source {};
+            bool isDone {false}; // Set by the opening task once it has finished
+            bool isCancelled {false}; // If set, the opening task releases the source itself
+        };
+
+        float _preloadTime {1.f}; // Time before its start at which the next source is opened, in seconds
+        int32_t _nextSourceIndex {-1}; // Index of the source being opened ahead of time
+        std::shared_ptr<PreparedSource> _nextSource {}; // The source opened ahead of time, paused on its first frame
+        std::mutex _openingMutex {};
+        std::condition_variable _openingCondition {};
+        int32_t _openingCount {0}; // Number of opening tasks still running, even if dropped
+
         int32_t _currentSourceIndex {-1};
         bool _playing {false};
 
@@ -124,9 +141,26 @@ class Queue : public BufferObject
         void cleanPlaylist(std::vector<Source>& playlist);
 
         /**
-         * Create a source object from the given type
+         * Create a source object from the given type, with the given name
+         */
+        std::shared_ptr<BufferObject> createSource(std::string type, const std::string& name);
+
+        /**
+         * Create the source for the given playlist entry, and open its file
+         * If paused, the source is kept on its first frame until unpaused
+         * Returns an empty pointer if the type is not supported
+         */
+        std::shared_ptr<BufferObject> openSource(const Source& source, const std::string& name, bool useClock, bool paused);
+
+        /**
+         * Drop the source opened ahead of time, if any
+         */
+        void dropNextSource();
+
+        /**
+         * Release a source without waiting for its threads to finish
          */
-        std::shared_ptr<BufferObject> createSource(std::string type);
+        void releaseSource(std::shared_ptr<BufferObject>& source);
 
         /**
          * Register new functors to modify attributes
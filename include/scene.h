@@ -46,6 +46,8 @@ namespace Splash {
 
 class Scene;
 typedef std::shared_ptr<Scene> ScenePtr;
+class Geometry;
+class Window;
 
 /*************/
 class Scene : public RootObject
@@ -221,9 +223,29 @@ class Scene : public RootObject
         bool _started {false};
 
         bool _isMaster {false}; //< Set to true if this is the master Scene of the current config
+        bool _isTraceFrameCounter {true}; //< False for the inner Scene of a World, which shares its tracer
         bool _isInitialized {false};
         bool _status {false}; //< Set to true if an error occured during rendering
         int _swapInterval {1}; //< Global value for the swap interval, default for all windows
+        int _timingLogPeriod {60}; //< Period of the timing statistics log, in seconds, 0 to disable
+        int64_t _lastTimingLog {0};
+
+        // Glass to glass latency measurement: frames rendered for the first time, and last frame measured for each source
+        bool _measureLatency {false};
+        std::vector<std::pair<std::string, int64_t>> _latencyFrames {};
+        std::unordered_map<std::string, uint64_t> _latencyFrameIndices {};
+
+        // Parallel rendering of the windows, each one from its own context along with the cameras and warps only it uses
+        struct WindowRenderJob
+        {
+            std::shared_ptr<Window> window {nullptr};
+            std::vector<std::shared_ptr<Camera>> cameras {};
+            std::vector<std::shared_ptr<Warp>> warps {};
+            std::vector<std::shared_ptr<Geometry>> geometries {}; // Drawn by the cameras, uploaded to from the main context only
+            GLsync fence {nullptr};
+            bool isError {false};
+        };
+        bool _parallelWindows {false};
 
         // Joystick update loop and attributes
         std::future<void> _joystickUpdateFuture;
@@ -264,6 +286,11 @@ class Scene : public RootObject
          */
         std::vector<int> findGLVersion();
 
+        /**
+         * Get the windows to render in parallel, along with the cameras and warps used only by each of them
+         */
+        std::vector<WindowRenderJob> getWindowRenderJobs();
+
         /**
          * Set up the context and everything
          */
@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2016 Emmanuel Durand
+ *
+ * This file is part of Splash.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Splash is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splash.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * @serializer.h
+ * Compact binary encoding of Values, used to send messages through Link
+ *
+ * A message is packed in a single buffer:
+ *   varint name size, name, varint attribute size, attribute, values
+ * and Values are encoded as:
+ *   varint count, then for each value a type byte followed by
+ *   i, l: zigzag varint / f: 4 raw bytes / s: varint size and chars / v: nested values
+ */
+
+#ifndef SPLASH_SERIALIZER_H
+#define SPLASH_SERIALIZER_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "coretypes.h"
+
+namespace Splash
+{
+    namespace Serializer
+    {
+        /*****/
+        inline size_t getVarintSize(uint64_t value)
+        {
+            size_t size = 1;
+            while (value >= 0x80)
+            {
+                value >>= 7;
+                ++size;
+            }
+            return size;
+        }
+
+        /*****/
+        inline char* writeVarint(uint64_t value, char* ptr)
+        {
+            while (value >= 0x80)
+            {
+                *ptr++ = static_cast<char>((value & 0x7F) | 0x80);
+                value >>= 7;
+            }
+            *ptr++ = static_cast<char>(value);
+            return ptr;
+        }
+
+        /*****/
+        inline bool readVarint(const char*& ptr, const char* end, uint64_t& value)
+        {
+            value = 0;
+            for (int shift = 0; shift < 64 && ptr < end; shift += 7)
+            {
+                uint8_t byte = static_cast<uint8_t>(*ptr++);
+                value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0)
+                    return true;
+            }
+            return false;
+        }
+
+        /*****/
+        inline uint64_t zigzagEncode(int64_t value)
+        {
+            return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+        }
+
+        /*****/
+        inline int64_t zigzagDecode(uint64_t value)
+        {
+            return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+        }
+
+        /*****/
+        inline size_t getSize(const Values& values)
+        {
+            size_t size = getVarintSize(values.size());
+            for (const auto& v : values)
+            {
+                size += 1;
+                switch (v.getType())
+                {
+                case Value::i:
+                    size += getVarintSize(zigzagEncode(v.asInt()));
+                    break;
+                case Value::l:
+                    size += getVarintSize(zigzagEncode(v.asLong()));
+                    break;
+                case Value::f:
+                    size += sizeof(float);
+                    break;
+                case Value::s:
+                    size += getVarintSize(v.size()) + v.size();
+                    break;
+                case Value::v:
+                    size += getSize(v.getValues());
+                    break;
+                }
+            }
+            return size;
+        }
+
+        /*****/
+        inline char* serialize(const Values& values, char* ptr)
+        {
+            ptr = writeVarint(values.size(), ptr);
+            for (const auto& v : values)
+            {
+                auto type = v.getType();
+                *ptr++ = static_cast<char>(type);
+                switch (type)
+                {
+                case Value::i:
+                    ptr = writeVarint(zigzagEncode(v.asInt()), ptr);
+                    break;
+                case Value::l:
+                    ptr = writeVarint(zigzagEncode(v.asLong()), ptr);
+                    break;
+                case Value::f:
+                    memcpy(ptr, v.data(), sizeof(float));
+                    ptr += sizeof(float);
+                    break;
+                case Value::s:
+                    ptr = writeVarint(v.size(), ptr);
+                    memcpy(ptr, v.data(), v.size());
+                    ptr += v.size();
+                    break;
+                case Value::v:
+                    ptr = serialize(v.getValues(), ptr);
+                    break;
+                }
+            }
+            return ptr;
+        }
+
+        /*****/
+        // Decodes straight from the given buffer, the only allocations being the ones of the output Values
+        inline bool deserialize(const char*& ptr, const char* end, Values& values)
+        {
+            uint64_t count;
+            if (!readVarint(ptr, end, count) || count > static_cast<uint64_t>(end - ptr))
+                return false;
+
+            values.reserve(values.size() + count);
+            for (uint64_t i = 0; i < count; ++i)
+            {
+                if (ptr >= end)
+                    return false;
+
+                auto type = static_cast<Value::Type>(*ptr++);
+                uint64_t raw;
+                switch (type)
+                {
+                default:
+                    return false;
+                case Value::i:
+                    if (!readVarint(ptr, end, raw))
+                        return false;
+                    values.emplace_back(static_cast<int>(zigzagDecode(raw)));
+                    break;
+                case Value::l:
+                    if (!readVarint(ptr, end, raw))
+                        return false;
+                    values.emplace_back(static_cast<int64_t>(zigzagDecode(raw)));
+                    break;
+                case Value::f:
+                {
+                    if (end - ptr < static_cast<std::ptrdiff_t>(sizeof(float)))
+                        return false;
+                    float f;
+                    memcpy(&f, ptr, sizeof(float));
+                    ptr += sizeof(float);
+                    values.emplace_back(f);
+                    break;
+                }
+                case Value::s:
+                    if (!readVarint(ptr, end, raw) || raw > static_cast<uint64_t>(end - ptr))
+                        return false;
+                    values.emplace_back(std::string(ptr, raw));
+                    ptr += raw;
+                    break;
+                case Value::v:
+                {
+                    Values nested;
+                    if (!deserialize(ptr, end, nested))
+                        return false;
+                    values.emplace_back(std::move(nested));
+                    break;
+                }
+                }
+            }
+            return true;
+        }
+
+        /*****/
+        inline size_t getMessageSize(const std::string& name, const std::string& attribute, const Values& values)
+        {
+            return getVarintSize(name.size()) + name.size() + getVarintSize(attribute.size()) + attribute.size() + getSize(values);
+        }
+
+        /*****/
+        inline char* serializeMessage(const std::string& name, const std::string& attribute, const Values& values, char* ptr)
+        {
+            ptr = writeVarint(name.size(), ptr);
+            memcpy(ptr, name.c_str(), name.size());
+            ptr += name.size();
+            ptr = writeVarint(attribute.size(), ptr);
+            memcpy(ptr, attribute.c_str(), attribute.size());
+            ptr += attribute.size();
+            return serialize(values, ptr);
+        }
+
+        /*****/
+        inline bool deserializeMessage(const char* ptr, size_t size, std::string& name, std::string& attribute, Values& values)
+        {
+            const char* end = ptr + size;
+            uint64_t stringSize;
+
+            if (!readVarint(ptr, end, stringSize) || stringSize > static_cast<uint64_t>(end - ptr))
+                return false;
+            name.assign(ptr, stringSize);
+            ptr += stringSize;
+
+            if (!readVarint(ptr, end, stringSize) || stringSize > static_cast<uint64_t>(end - ptr))
+                return false;
+            attribute.assign(ptr, stringSize);
+            ptr += stringSize;
+
+            values.clear();
+            return deserialize(ptr, end, values) && ptr == end;
+        }
+    } // end of namespace
+} // end of namespace
+
+#endif // SPLASH_SERIALIZER_H
@@ -31,6 +31,7 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <glm/glm.hpp>
 
 #include "config.h"
 
@@ -81,6 +82,26 @@ class Shader : public BaseObject
             window
         };
 
+        /**
+         * Binding points of uniform blocks
+         * Camera and object blocks are not handled by the shader, their owners bind them before drawing
+         */
+        enum UniformBlockBinding
+        {
+            defaultBlockBinding = 1,
+            cameraBlockBinding,
+            objectBlockBinding
+        };
+
+        /**
+         * Handle to a uniform, resolved once from its name and usable with any shader
+         */
+        struct UniformHandle
+        {
+            int id {-1};
+            explicit operator bool() const {return id >= 0;}
+        };
+
         /**
          * Constructor
          */
@@ -138,6 +159,36 @@ class Shader : public BaseObject
          */
         void setModelViewProjectionMatrix(const glm::dmat4& mv, const glm::dmat4& mp);
 
+        /**
+         * Get the handle for the given uniform name
+         * This is slow-ish, handles should be resolved once and kept by the caller
+         */
+        static UniformHandle getUniformHandle(const std::string& name);
+
+        /**
+         * Set the value of a uniform
+         * The value is sent to the GPU on the next call to updateUniforms, and only if it changed
+         */
+        void setUniform(UniformHandle handle, int value);
+        void setUniform(UniformHandle handle, float value);
+        void setUniform(UniformHandle handle, const glm::vec2& value);
+        void setUniform(UniformHandle handle, const glm::vec3& value);
+        void setUniform(UniformHandle handle, const glm::vec4& value);
+        void setUniform(UniformHandle handle, const glm::ivec4& value);
+        void setUniform(UniformHandle handle, const glm::mat3& value);
+        void setUniform(UniformHandle handle, const glm::mat4& value);
+
+        /**
+         * Set the value of an array uniform, or of a uniform block
+         */
+        void setUniform(UniformHandle handle, const int* values, size_t count);
+        void setUniform(UniformHandle handle, const float* values, size_t count);
+
+        /**
+         * Set the value of a uniform from generic Values, as done through the "uniform" attribute
+         */
+        bool setUniform(const std::string& name, const Values& values);
+
         /**
          * Set the currently queued uniforms updates
          */
@@ -155,14 +206,23 @@ class Shader : public BaseObject
 
         struct Uniform
         {
-            std::string type {""};
-            Values values {};
+            GLenum type {0}; // GLSL type of the uniform, GL_UNIFORM_BUFFER for uniform blocks
             GLint glIndex {-1};
             GLuint glBuffer {0};
+            GLuint binding {defaultBlockBinding};
             bool glBufferReady {false};
+            bool toUpdate {false};
+
+            // Values are stored as sent to the GPU, either as ints or as floats
+            bool isInt {false};
+            std::vector<GLint> ints {};
+            std::vector<GLfloat> floats {};
+
+            size_t size() const {return isInt ? ints.size() : floats.size();}
         };
-        std::map<std::string, Uniform> _uniforms;
-        std::vector<std::string> _uniformsToUpdate;
+        std::map<std::string, Uniform> _uniforms; // Uniforms are never removed, so pointers to them stay valid
+        std::vector<Uniform*> _uniformsByHandle {};
+        std::vector<Uniform*> _uniformsToUpdate {};
         std::vector<TexturePtr> _textures; // Currently used textures
 
         // A map of previously compiled programs
@@ -197,6 +257,17 @@ class Shader : public BaseObject
          */
         void parseUniforms(const std::string& src);
 
+        /**
+         * Get the uniform for the given handle, creating it if needed
+         */
+        Uniform& getUniform(UniformHandle handle);
+
+        /**
+         * Store the new value of a uniform, and queue it for update if it changed
+         */
+        void setUniformData(Uniform& uniform, const GLint* values, size_t count);
+        void setUniformData(Uniform& uniform, const GLfloat* values, size_t count);
+
         /**
          * Get a string expression of the shader type, used for logging
          */
@@ -115,6 +115,70 @@ struct ShaderSources
                 vec3 p = abs(fract(c.xxx + K.xyz) * 6.0 - K.www);
                 return c.z * mix(K.xxx, clamp(p - K.xxx, 0.0, 1.0), c.y);
             }
+        )"},
+        //
+        // YUV (BT.601, limited range) to RGB, from raw frames uploaded as is
+        // format is 1 for I420, whose planes are stacked in a single channel texture,
+        // and 2 for UYVY, whose macropixels are stored as RGBA texels
+        {"yuv", R"(
+            vec4 yuv2rgb(sampler2D tex, vec2 coords, int format)
+            {
+                ivec2 texSize = textureSize(tex, 0);
+                float y, u, v;
+
+                if (format == 1)
+                {
+                    ivec2 size = ivec2(texSize.x, texSize.y * 2 / 3);
+                    ivec2 pixel = clamp(ivec2(coords * vec2(size)), ivec2(0), size - ivec2(1));
+                    y = texelFetch(tex, pixel, 0).r;
+
+                    int chromaWidth = size.x / 2;
+                    int uIndex = size.x * size.y + (pixel.y / 2) * chromaWidth + pixel.x / 2;
+                    int vIndex = uIndex + chromaWidth * (size.y / 2);
+                    u = texelFetch(tex, ivec2(uIndex % size.x, uIndex / size.x), 0).r;
+                    v = texelFetch(tex, ivec2(vIndex % size.x, vIndex / size.x), 0).r;
+                }
+                else
+                {
+                    ivec2 size = ivec2(texSize.x * 2, texSize.y);
+                    ivec2 pixel = clamp(ivec2(coords * vec2(size)), ivec2(0), size - ivec2(1));
+                    vec4 macropixel = texelFetch(tex, ivec2(pixel.x / 2, pixel.y), 0);
+                    y = (pixel.x % 2 == 0) ? macropixel.g : macropixel.a;
+                    u = macropixel.r;
+                    v = macropixel.b;
+                }
+
+                y = 1.164 * (y - 16.0 / 255.0);
+                u = u - 128.0 / 255.0;
+                v = v - 128.0 / 255.0;
+                vec3 rgb = vec3(y + 1.596 * v, y - 0.392 * u - 0.813 * v, y + 2.017 * u);
+                return vec4(clamp(rgb, vec3(0.0), vec3(1.0)), 1.0);
+            }
+        )"},
+        //
+        // Uniforms set by the camera, shared by all the objects it draws
+        // The layout must match Camera::CameraUniformBlock
+        {"cameraUniforms", R"(
+            layout(std140) uniform _cameraBlock
+            {
+                vec4 _fovAndColorBalance; // fovX and fovY, r/g and b/g
+                vec2 _cameraAttributes; // blendWidth and brightness
+                int _isColorLUT;
+                mat3 _colorMixMatrix;
+                vec3 _colorLUT[256];
+            };
+        )"},
+        //
+        // Uniforms of an object, as seen from the camera drawing it
+        // The layout must match Object::UniformBlock
+        {"objectUniforms", R"(
+            layout(std140) uniform _objectBlock
+            {
+                mat4 _modelViewProjectionMatrix;
+                mat4 _normalMatrix;
+                vec3 _scale;
+                float _normalExp;
+            };
         )"}
     };
 
@@ -680,6 +744,7 @@ struct ShaderSources
      */
     const std::string FRAGMENT_SHADER_FILTER {R"(
         #include hsv
+        #include yuv
 
         #define PI 3.14159265359
 
@@ -698,6 +763,9 @@ struct ShaderSources
         uniform int _tex0_flop = 0;
         // HapQ specific parameters
         uniform int _tex0_YCoCg = 0;
+        // YUV specific parameters, see yuv2rgb
+        uniform int _tex0_YUV = 0;
+        uniform int _tex0_srgb = 0;
 
         // Film uniforms
         uniform float _filmDuration = 0.f;
@@ -723,7 +791,22 @@ struct ShaderSources
             else
                 realCoords = texCoord;
 
+        #ifdef TEXTURE_RECT
             vec4 color = texture(_tex0, realCoords * _tex0_size);
+        #else
+            vec4 color;
+            // Raw YUV frames are converted here, the filter output having the size of the image
+            if (_tex0_YUV != 0)
+            {
+                color = yuv2rgb(_tex0, realCoords, _tex0_YUV);
+                if (_tex0_srgb == 1)
+                    color.rgb = pow(color.rgb, vec3(2.2));
+            }
+            else
+            {
+                color = texture(_tex0, realCoords * _tex0_size);
+            }
+        #endif
 
             // If the color is expressed as YCoCg (for HapQ compression), extract RGB color from it
             if (_tex0_YCoCg == 1)
@@ -838,17 +921,14 @@ struct ShaderSources
      */
     const std::string VERTEX_SHADER_TEXTURE {R"(
         #include getSmoothBlendFromVertex
+        #include cameraUniforms
+        #include objectUniforms
 
         layout(location = 0) in vec4 _vertex;
         layout(location = 1) in vec2 _texcoord;
         layout(location = 2) in vec4 _normal;
         layout(location = 3) in vec4 _annexe;
 
-        uniform mat4 _modelViewProjectionMatrix;
-        uniform mat4 _normalMatrix;
-        uniform vec3 _scale = vec3(1.0, 1.0, 1.0);
-        uniform vec2 _cameraAttributes = vec2(0.05, 1.0); // blendWidth and brightness
-
         out VertexData
         {
             vec4 position;
@@ -897,14 +977,9 @@ struct ShaderSources
 
         uniform int _sideness = 0;
         uniform int _textureNbr = 0;
-        uniform vec2 _cameraAttributes = vec2(0.05, 1.0); // blendWidth and brightness
-        uniform vec4 _fovAndColorBalance = vec4(0.0, 0.0, 1.0, 1.0); // fovX and fovY, r/g and b/g
-        uniform int _isColorLUT = 0;
-        uniform vec3 _colorLUT[256];
-        uniform mat3 _colorMixMatrix = mat3(1.0, 0.0, 0.0,
-                                            0.0, 1.0, 0.0,
-                                            0.0, 0.0, 1.0);
-        uniform float _normalExp = 0.0;
+
+        #include cameraUniforms
+        #include objectUniforms
 
         in VertexData
         {
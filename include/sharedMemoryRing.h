@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2016 Emmanuel Durand
+ *
+ * This file is part of Splash.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Splash is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splash.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * @sharedMemoryRing.h
+ * The SharedMemoryRing class, a ring of frame slots held in POSIX shared memory,
+ * used by Link to send big buffers to other processes without going through a socket
+ */
+
+#ifndef SPLASH_SHARED_MEMORY_RING_H
+#define SPLASH_SHARED_MEMORY_RING_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "config.h"
+#include "coretypes.h"
+
+#define SPLASH_SHM_DEFAULT_SLOT_COUNT 4
+#define SPLASH_SHM_DEFAULT_SLOT_SIZE (128 * 1024 * 1024)
+#define SPLASH_SHM_SLOT_TIMEOUT 100000 // Time after which a slot not read by all readers is reclaimed, in us
+
+namespace Splash {
+
+/*************/
+class SharedMemoryRing
+{
+    public:
+        /**
+         * Notification sent through the control channel once a slot is ready
+         * It is followed by the name of the shared memory segment
+         */
+        struct Notification
+        {
+            uint64_t ringId {0};
+            uint64_t sequence {0};
+            uint64_t size {0};
+            uint32_t slot {0};
+            uint32_t nameSize {0};
+        };
+
+        /**
+         * Constructor, creating a new segment
+         * The segment is unlinked when this object is destroyed
+         */
+        SharedMemoryRing(const std::string& name, size_t slotSize, unsigned int slotCount);
+
+        /**
+         * Constructor, opening an existing segment
+         */
+        SharedMemoryRing(const std::string& name);
+
+        /**
+         * Destructor
+         */
+        ~SharedMemoryRing();
+
+        SharedMemoryRing(const SharedMemoryRing&) = delete;
+        SharedMemoryRing& operator=(const SharedMemoryRing&) = delete;
+
+        /**
+         * Safe bool idiom
+         */
+        explicit operator bool() const {return _header != nullptr;}
+
+        /**
+         * Get the name of the segment
+         */
+        const std::string& getName() const {return _name;}
+
+        /**
+         * Get the unique identifier of this segment
+         */
+        uint64_t getId() const;
+
+        /**
+         * Get the maximum size of a buffer which can be held in a slot
+         */
+        size_t getSlotSize() const;
+
+        /**
+         * Copy the given buffer to a free slot, which will have to be read by the given number of readers before being reused
+         * Returns false if no slot is available or if the buffer is too big
+         */
+        bool write(const char* data, size_t size, unsigned int readers, Notification& notification);
+
+        /**
+         * Release the slot described by the notification, when it could not be sent to the readers
+         */
+        void release(const Notification& notification);
+
+        /**
+         * Read the slot described by the notification into a new SerializedObject
+         * Returns an empty pointer if the slot has been overwritten in the meantime
+         */
+        std::shared_ptr<SerializedObject> read(const Notification& notification);
+
+    private:
+        struct RingHeader;
+        struct SlotHeader;
+
+        std::string _name {""};
+        bool _owner {false};
+        size_t _mappedSize {0};
+        RingHeader* _header {nullptr};
+        unsigned int _nextSlot {0};
+
+        /**
+         * Map the segment, given its file descriptor
+         */
+        bool map(int fd, size_t size);
+
+        /**
+         * Get the header and the data for the given slot
+         */
+        SlotHeader* getSlotHeader(unsigned int slot) const;
+        char* getSlotData(unsigned int slot) const;
+};
+
+} // end of namespace
+
+#endif // SPLASH_SHARED_MEMORY_RING_H
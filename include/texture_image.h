@@ -25,6 +25,7 @@
 #ifndef SPLASH_TEXTURE_IMAGE_H
 #define SPLASH_TEXTURE_IMAGE_H
 
+#include <atomic>
 #include <chrono>
 #include <memory>
 #include <vector>
@@ -34,6 +35,7 @@
 
 #include "coretypes.h"
 #include "basetypes.h"
+#include "directUpload.h"
 #include "image.h"
 #include "texture.h"
 
@@ -73,8 +75,8 @@ class Texture_Image : public Texture
         void unbind();
 
         /**
-         * Flush the PBO copy which may still be happening. Do this before
-         * closing the current context!
+         * Release the image if the PBO copy is done. This never waits for the copy:
+         * if it is still running, it is finished by the next call to update()
          */
         void flushPbo();
 
@@ -104,6 +106,14 @@ class Texture_Image : public Texture
          */
         bool linkTo(std::shared_ptr<BaseObject> obj);
 
+        /**
+         * Get the provenance of the frame currently in the texture, see ImageBufferSpec
+         * Along with the name of its image, it is only valid while uploads are prevented
+         */
+        int64_t getFrameTimestamp() const {return _frameTimestamp;}
+        uint64_t getFrameIndex() const {return _frameIndex;}
+        std::string getFrameSource() const {return _frameSource;}
+
         /**
          * Lock the texture for read / write operations
          */
@@ -146,9 +156,49 @@ class Texture_Image : public Texture
         GLint _glVersionMinor {0};
 
         GLuint _glTex {0};
-        GLuint _pbos[2];
-        int _pboReadIndex {0};
-        std::vector<unsigned int> _pboCopyThreadIds;
+        bool _hasBufferStorage {false}; // True if persistently mapped buffers are available
+
+        // Ring of PBOs, filled by the copy threads and uploaded once filled
+        // A PBO is written again only once the fence set after its upload is signalled
+        struct PboSlot
+        {
+            GLuint pbo {0};
+            char* pixels {nullptr}; // Only set if the buffer is persistently mapped
+            GLsync fence {nullptr};
+            int64_t timestamp {-1}; // Provenance of the frame in the PBO
+            uint64_t frameIndex {0};
+        };
+        std::vector<PboSlot> _pbos {};
+        int _pboCount {3};
+        int _pboWriteIndex {0};
+        int _pboReadyIndex {-1}; // PBO filled and waiting for upload, if any
+        bool _pboCopying {false};
+        std::atomic_int _pboPendingCopies {0};
+        std::shared_ptr<Image> _pboCopyImage {nullptr}; // Image locked during the copy
+
+        // Persistently mapped buffers, written directly by an Image of the World when the Scene is in the same process
+        std::shared_ptr<DirectUploadTarget> _directTarget {nullptr};
+        std::string _directTargetName {};
+        GLuint _directPbos[SPLASH_DIRECT_UPLOAD_SLOTS];
+        GLsync _directFences[SPLASH_DIRECT_UPLOAD_SLOTS];
+
+        // Provenance of the frame in the texture
+        int64_t _frameTimestamp {-1};
+        uint64_t _frameIndex {0};
+        std::string _frameSource {};
+
+        // Parameters of the last upload, reused for direct uploads
+        struct UploadParameters
+        {
+            int width {0};
+            int height {0};
+            GLenum channelOrder {GL_RGBA};
+            GLenum dataFormat {GL_UNSIGNED_BYTE};
+            GLenum internalFormat {GL_RGBA};
+            bool isCompressed {false};
+            int imageDataSize {0};
+            bool mipmaps {false};
+        } _uploadParameters;
 
         // Store some texture parameters
         bool _filtering {true};
@@ -175,9 +225,48 @@ class Texture_Image : public Texture
         GLenum getChannelOrder(const ImageBufferSpec& spec);
 
         /**
-         * Update the pbos according to the parameters
+         * Recreate the PBO ring, each buffer holding the given size
+         */
+        void updatePbos(int size);
+
+        /**
+         * Delete the PBO ring
+         */
+        void releasePbos();
+
+        /**
+         * Start copying the image to the next PBO of the ring, with the copy threads
+         * Returns false if this PBO is still used by the GL, in which case nothing is done
+         */
+        bool copyToPbo(const std::shared_ptr<Image>& img, int size);
+
+        /**
+         * Release the image and mark the PBO as ready for upload, if the copy is done
+         * Returns false if the copy is still running
+         */
+        bool finishPboCopy();
+
+        /**
+         * Upload the PBO ready for upload to the texture, if any
+         */
+        void uploadPbo();
+
+        /**
+         * Create the buffers written directly by the Image of the given name, if the direct path is active
+         * Nothing is done if they already match the given spec
+         */
+        void updateDirectTarget(const std::string& name, const ImageBufferSpec& spec, int size);
+
+        /**
+         * Release the directly written buffers, after the end of their uploads
+         */
+        void releaseDirectTarget();
+
+        /**
+         * Upload the most recent frame written directly to the buffers, if any
+         * Returns true if a frame has been uploaded
          */
-        void updatePbos(int width, int height, int bytes);
+        bool uploadDirectFrame();
 
         /**
          * Register new functors to modify attributes
@@ -26,116 +26,356 @@
 #ifndef SPLASH_THREADPOOL_H
 #define SPLASH_THREADPOOL_H
 
+#include <algorithm>
 #include <atomic>
-#include <iostream>
-#include <vector>
+#include <condition_variable>
+#include <cstddef>
 #include <deque>
-#include <thread>
 #include <memory>
 #include <mutex>
-#include <condition_variable>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "config.h"
 
 #define SPLASH_MAX_THREAD 8
 
-/*************/
-class ThreadPool;
+namespace Splash
+{
 
 /*************/
-class Worker
+// Type erased callable, stored inline when small enough to avoid any allocation
+class Task
 {
     public:
-        Worker(ThreadPool &s) : pool(s) { }
-        void operator() ();
-     
+        Task() {}
+
+        template<class F, class = typename std::enable_if<!std::is_same<typename std::decay<F>::type, Task>::value>::type>
+        Task(F&& f)
+        {
+            typedef typename std::decay<F>::type Func;
+            construct<Func>(std::forward<F>(f), std::integral_constant<bool, isInline<Func>()>());
+        }
+
+        Task(Task&& task)
+        {
+            *this = std::move(task);
+        }
+
+        Task& operator=(Task&& task)
+        {
+            if (this == &task)
+                return *this;
+
+            reset();
+            if (task._ops)
+            {
+                task._ops->move(&_storage, &task._storage);
+                _ops = task._ops;
+                task._ops = nullptr;
+            }
+            return *this;
+        }
+
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+
+        ~Task()
+        {
+            reset();
+        }
+
+        explicit operator bool() const {return _ops != nullptr;}
+        void operator()() {_ops->invoke(&_storage);}
+
     private:
-        ThreadPool &pool;
+        static const size_t inlineSize = 64;
+
+        struct Ops
+        {
+            void (*invoke)(void*);
+            void (*move)(void* dst, void* src);
+            void (*destroy)(void*);
+        };
+
+        template<class F>
+        struct InlineOps
+        {
+            static void invoke(void* storage) {(*static_cast<F*>(storage))();}
+            static void move(void* dst, void* src)
+            {
+                new (dst) F(std::move(*static_cast<F*>(src)));
+                static_cast<F*>(src)->~F();
+            }
+            static void destroy(void* storage) {static_cast<F*>(storage)->~F();}
+            static const Ops ops;
+        };
+
+        template<class F>
+        struct HeapOps
+        {
+            static void invoke(void* storage) {(**static_cast<F**>(storage))();}
+            static void move(void* dst, void* src) {*static_cast<F**>(dst) = *static_cast<F**>(src);}
+            static void destroy(void* storage) {delete *static_cast<F**>(storage);}
+            static const Ops ops;
+        };
+
+        typename std::aligned_storage<inlineSize, alignof(std::max_align_t)>::type _storage;
+        const Ops* _ops {nullptr};
+
+        template<class F>
+        static constexpr bool isInline()
+        {
+            return sizeof(F) <= inlineSize && alignof(std::max_align_t) % alignof(F) == 0 && std::is_nothrow_move_constructible<F>::value;
+        }
+
+        template<class F, class G>
+        void construct(G&& f, std::true_type)
+        {
+            new (&_storage) F(std::forward<G>(f));
+            _ops = &InlineOps<F>::ops;
+        }
+
+        template<class F, class G>
+        void construct(G&& f, std::false_type)
+        {
+            *reinterpret_cast<F**>(&_storage) = new F(std::forward<G>(f));
+            _ops = &HeapOps<F>::ops;
+        }
+
+        void reset()
+        {
+            if (_ops)
+                _ops->destroy(&_storage);
+            _ops = nullptr;
+        }
 };
 
+template<class F> const Task::Ops Task::InlineOps<F>::ops = {&Task::InlineOps<F>::invoke, &Task::InlineOps<F>::move, &Task::InlineOps<F>::destroy};
+template<class F> const Task::Ops Task::HeapOps<F>::ops = {&Task::HeapOps<F>::invoke, &Task::HeapOps<F>::move, &Task::HeapOps<F>::destroy};
+
+} // end of namespace
+
 /*************/
+// Work stealing thread pool: each worker has its own queue, takes its newest task first,
+// and steals the oldest tasks of the other workers when its queue is empty
 class ThreadPool
 {
     public:
         ThreadPool(int threads = -1);
         ~ThreadPool();
 
+        /**
+         * Add a task, returning an id which can be given to waitThreads
+         */
         template<class F> unsigned int enqueue(F f);
+
+        /**
+         * Add a task which will not be waited for
+         */
         template<class F> void enqueueWithoutId(F f);
+
+        /**
+         * Split [0, count) in at most the given number of contiguous ranges, and call func(begin, end)
+         * on each of them in parallel. The calling thread processes one of the ranges
+         */
+        template<class F> void parallelFor(size_t count, size_t stripes, const F& func);
+
+        /**
+         * Get the number of tasks waiting for a worker
+         */
         unsigned int getTasksNumber();
-        void addWorkers(unsigned int nbr);
+
+        /**
+         * Get the number of workers
+         */
+        unsigned int getWorkersNumber() const {return _workers.size();}
+
+        /**
+         * Wait for all the tasks to be done
+         */
         void waitAllThreads();
+
+        /**
+         * Wait for the tasks of the given ids to be done, and empty the list
+         */
         void waitThreads(std::vector<unsigned int>&);
 
     private:
-        friend class Worker;
+        struct Queue
+        {
+            std::mutex mutex {};
+            std::deque<Splash::Task> tasks {};
+        };
+
+        std::vector<std::thread> _workers {};
+        std::vector<std::unique_ptr<Queue>> _queues {};
+        std::atomic_uint _nextQueue {0};
 
-        std::vector<std::thread> workers;
-        std::deque<std::shared_ptr<std::function<void()>>> tasks;
-        std::deque<unsigned int> tasksId;
-        std::deque<unsigned int> tasksFinished;
+        std::atomic_int _queuedTasks {0};
+        std::atomic_int _workingThreads {0};
+        std::atomic_int _sleepingThreads {0};
+        std::atomic_bool _stop {false};
+        std::mutex _sleepMutex {};
+        std::condition_variable _sleepCondition {};
 
-        std::atomic_uint workingThreads {0};
-        std::mutex queue_mutex;
-        std::condition_variable condition;
-        bool stop {false};
+        std::atomic_uint _nextId {1};
+        std::unordered_set<unsigned int> _finishedIds {};
+        std::mutex _finishedMutex {};
+        std::condition_variable _finishedCondition {};
 
-        std::atomic_uint nextId {1};
+        void push(Splash::Task&& task);
+        bool pop(int index, Splash::Task& task);
+        void markFinished(unsigned int id);
+        void workerLoop(int index);
 };
 
 typedef std::shared_ptr<ThreadPool> ThreadPoolPtr;
 
 /*************/
-template<class F>
-unsigned int ThreadPool::enqueue(F f)
+// Global thread pool
+struct SThread
 {
-    unsigned int id;
-    {
-        // Acquire lock
-        queue_mutex.lock();
+    public:
+        static ThreadPool pool;
+};
 
-        id = std::atomic_fetch_add(&nextId, 1u);
-        if (id == std::numeric_limits<unsigned int>::max())
-            nextId = 1;
+namespace Splash
+{
 
-        // Add the task
-        tasks.push_back(std::shared_ptr<std::function<void()>>(new std::function<void()>(f)));
-        tasksId.push_back(id);
+/*************/
+// Group of tasks which can be waited for together
+// While waiting, the calling thread runs the tasks of the group not yet started,
+// and only then sleeps until the ones taken by the workers are done
+class TaskGroup
+{
+    public:
+        TaskGroup(ThreadPool& pool = SThread::pool)
+            : _pool(pool)
+            , _state(std::make_shared<State>())
+        {
+        }
 
-        queue_mutex.unlock();
-    }
+        ~TaskGroup()
+        {
+            wait();
+        }
 
-    // Wake up one thread
-    condition.notify_one();
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
 
-    return id;
-}
+        /**
+         * Add a task to the group
+         */
+        template<class F>
+        void run(F f)
+        {
+            {
+                std::lock_guard<std::mutex> lock(_state->mutex);
+                _state->tasks.emplace_back(std::move(f));
+                _state->pending++;
+            }
+
+            auto state = _state;
+            _pool.enqueueWithoutId([state]() {
+                runOne(*state);
+            });
+        }
+
+        /**
+         * Wait for all the tasks of the group to be done
+         */
+        void wait()
+        {
+            while (runOne(*_state)) {}
+
+            std::unique_lock<std::mutex> lock(_state->mutex);
+            _state->condition.wait(lock, [&]() {return _state->pending == 0;});
+        }
+
+    private:
+        struct State
+        {
+            std::mutex mutex {};
+            std::condition_variable condition {};
+            std::deque<Splash::Task> tasks {};
+            int pending {0};
+        };
+
+        ThreadPool& _pool;
+        std::shared_ptr<State> _state;
+
+        // Run one of the tasks not yet started, returns false if there is none
+        static bool runOne(State& state)
+        {
+            Splash::Task task;
+            {
+                std::lock_guard<std::mutex> lock(state.mutex);
+                if (state.tasks.empty())
+                    return false;
+                task = std::move(state.tasks.front());
+                state.tasks.pop_front();
+            }
+
+            task();
+
+            std::lock_guard<std::mutex> lock(state.mutex);
+            if (--state.pending == 0)
+                state.condition.notify_all();
+            return true;
+        }
+};
+
+} // end of namespace
 
 /*************/
 template<class F>
-void ThreadPool::enqueueWithoutId(F f)
+unsigned int ThreadPool::enqueue(F f)
 {
-    {
-        // Acquire lock
-        queue_mutex.lock();
+    unsigned int id = _nextId++;
+    if (id == 0)
+        id = _nextId++;
 
-        // Add the task
-        tasks.push_back(std::shared_ptr<std::function<void()>>(new std::function<void()>(f)));
-        tasksId.push_back(0);
+    push(Splash::Task([=]() mutable {
+        f();
+        markFinished(id);
+    }));
 
-        queue_mutex.unlock();
-    }
+    return id;
+}
 
-    // Wake up one thread
-    condition.notify_one();
+/*************/
+template<class F>
+void ThreadPool::enqueueWithoutId(F f)
+{
+    push(Splash::Task(std::move(f)));
 }
 
 /*************/
-// Global thread pool
-struct SThread
+template<class F>
+void ThreadPool::parallelFor(size_t count, size_t stripes, const F& func)
 {
-    public:
-        static ThreadPool pool;
-};
+    stripes = std::max<size_t>(1, std::min(stripes, count));
+    if (stripes == 1)
+    {
+        if (count != 0)
+            func(0, count);
+        return;
+    }
+
+    Splash::TaskGroup group(*this);
+    for (size_t i = 0; i < stripes - 1; ++i)
+    {
+        group.run([&func, i, count, stripes]() {
+            func(count * i / stripes, count * (i + 1) / stripes);
+        });
+    }
+    func(count * (stripes - 1) / stripes, count);
+    group.wait();
+}
 
 #endif // SPLASH_THREADPOOL_H
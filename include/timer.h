@@ -25,24 +25,189 @@
 #ifndef SPLASH_TIMER_H
 #define SPLASH_TIMER_H
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <cstdio>
 #include <ctime>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <unordered_map>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "config.h"
 #include "coretypes.h"
 
+#define SPLASH_TIMER_HISTOGRAM_SLICES 10
+#define SPLASH_TIMER_HISTOGRAM_SLICE_DURATION 1000000
+
 namespace Splash
 {
 
+/*************/
+// Log-linear histogram of durations in us, over a sliding window of SPLASH_TIMER_HISTOGRAM_SLICES
+// slices of SPLASH_TIMER_HISTOGRAM_SLICE_DURATION us. Each power of two is split in 16 sub-buckets,
+// so that percentiles are given with less than 7% error whatever the duration
+class LatencyHistogram
+{
+    public:
+        struct Statistics
+        {
+            unsigned long long count {0};
+            unsigned long long min {0};
+            unsigned long long mean {0};
+            unsigned long long p50 {0};
+            unsigned long long p95 {0};
+            unsigned long long p99 {0};
+            unsigned long long max {0};
+        };
+
+        /**
+         * Add a duration, recorded at the given time (both in us)
+         * Only atomic increments, except once per slice to recycle it
+         */
+        void record(unsigned long long duration, int64_t time)
+        {
+            auto epoch = time / SPLASH_TIMER_HISTOGRAM_SLICE_DURATION;
+            auto& slice = _slices[epoch % SPLASH_TIMER_HISTOGRAM_SLICES];
+            if (slice.epoch != epoch)
+            {
+                std::lock_guard<std::mutex> lock(_sliceMutex);
+                if (slice.epoch != epoch)
+                {
+                    for (auto& c : slice.counts)
+                        c.store(0, std::memory_order_relaxed);
+                    slice.count = 0;
+                    slice.sum = 0;
+                    slice.min = ~0ull;
+                    slice.max = 0;
+                    slice.epoch = epoch;
+                }
+            }
+
+            slice.counts[getBucket(duration)].fetch_add(1, std::memory_order_relaxed);
+            slice.count.fetch_add(1, std::memory_order_relaxed);
+            slice.sum.fetch_add(duration, std::memory_order_relaxed);
+
+            auto value = slice.min.load(std::memory_order_relaxed);
+            while (duration < value && !slice.min.compare_exchange_weak(value, duration, std::memory_order_relaxed));
+            value = slice.max.load(std::memory_order_relaxed);
+            while (duration > value && !slice.max.compare_exchange_weak(value, duration, std::memory_order_relaxed));
+        }
+
+        /**
+         * Get the statistics over the sliding window ending at the given time
+         */
+        Statistics getStatistics(int64_t time) const
+        {
+            Statistics stats;
+            std::array<unsigned long long, _bucketCount> counts {};
+            unsigned long long sum = 0;
+            unsigned long long min = ~0ull;
+
+            auto epoch = time / SPLASH_TIMER_HISTOGRAM_SLICE_DURATION;
+            for (auto& slice : _slices)
+            {
+                if (slice.epoch <= epoch - SPLASH_TIMER_HISTOGRAM_SLICES || slice.epoch > epoch)
+                    continue;
+
+                for (int i = 0; i < _bucketCount; ++i)
+                    counts[i] += slice.counts[i].load(std::memory_order_relaxed);
+                stats.count += slice.count.load(std::memory_order_relaxed);
+                sum += slice.sum.load(std::memory_order_relaxed);
+                min = std::min<unsigned long long>(min, slice.min.load(std::memory_order_relaxed));
+                stats.max = std::max<unsigned long long>(stats.max, slice.max.load(std::memory_order_relaxed));
+            }
+
+            if (stats.count == 0)
+                return stats;
+
+            stats.min = min;
+            stats.mean = sum / stats.count;
+
+            // Percentiles are clamped to the exact extrema, which are known
+            auto percentile = [&](double p) -> unsigned long long {
+                auto rank = std::max<unsigned long long>(1, (unsigned long long)(p * (double)stats.count + 0.5));
+                unsigned long long seen = 0;
+                for (int i = 0; i < _bucketCount; ++i)
+                {
+                    seen += counts[i];
+                    if (seen >= rank)
+                        return std::min(std::max(getBucketValue(i), stats.min), stats.max);
+                }
+                return stats.max;
+            };
+
+            stats.p50 = percentile(0.5);
+            stats.p95 = percentile(0.95);
+            stats.p99 = percentile(0.99);
+
+            return stats;
+        }
+
+    private:
+        static const int _subBucketBits {4};
+        static const int _subBucketCount {1 << _subBucketBits};
+        static const int _maxExponent {36 - _subBucketBits}; // Durations are clamped to about 19 hours
+        static const int _bucketCount {(_maxExponent + 2) * _subBucketCount};
+
+        struct Slice
+        {
+            std::array<std::atomic<uint32_t>, _bucketCount> counts {};
+            std::atomic_ullong count {0};
+            std::atomic_ullong sum {0};
+            std::atomic_ullong min {~0ull};
+            std::atomic_ullong max {0};
+            std::atomic<int64_t> epoch {-1};
+        };
+
+        std::array<Slice, SPLASH_TIMER_HISTOGRAM_SLICES> _slices {};
+        std::mutex _sliceMutex {};
+
+        static int getBucket(unsigned long long value)
+        {
+            if (value < 2 * _subBucketCount)
+                return (int)value;
+
+            int msb = 63 - __builtin_clzll(value);
+            // The unary plus passes a copy, as the static constant has no out of line definition
+            int exponent = std::min(msb - _subBucketBits, +_maxExponent);
+            auto mantissa = std::min<unsigned long long>(value >> exponent, 2 * _subBucketCount - 1);
+            return exponent * _subBucketCount + (int)mantissa;
+        }
+
+        // Middle of the range of values falling in the bucket
+        static unsigned long long getBucketValue(int bucket)
+        {
+            if (bucket < 2 * _subBucketCount)
+                return bucket;
+
+            int exponent = bucket / _subBucketCount - 1;
+            unsigned long long mantissa = bucket % _subBucketCount + _subBucketCount;
+            return (mantissa << exponent) + (1ull << (exponent - 1));
+        }
+};
+
+/*************/
 class Timer
 {
     public:
+        /**
+         * Last value of a duration, along with its histogram which is set once when the duration is created
+         */
+        struct Duration
+        {
+            std::atomic_ullong value {0};
+            LatencyHistogram* histogram {nullptr};
+
+            operator unsigned long long() const {return value;}
+        };
+
         /**
          * Get the singleton
          */
@@ -84,11 +249,9 @@ class Timer
             {
                 auto currentTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
 
-                auto durationIt = _durationMap.find(name);
-                if (durationIt == _durationMap.end())
-                    _durationMap[name] = currentTime - timeIt->second;
-                else
-                    durationIt->second = currentTime - timeIt->second;
+                auto& duration = getDurationEntry(name);
+                duration.value = currentTime - timeIt->second;
+                duration.histogram->record(currentTime - timeIt->second, currentTime);
             }
         }
 
@@ -105,7 +268,6 @@ class Timer
         
            auto currentTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
            auto timeIt = _timeMap.find(name);
-           auto durationIt = _durationMap.find(name);
            unsigned long long elapsed;
 
            elapsed = currentTime - timeIt->second;
@@ -121,10 +283,9 @@ class Timer
                overtime = true;
            }
         
-           if (durationIt == _durationMap.end())
-               _durationMap[name] = std::max(duration, elapsed);
-           else
-               durationIt->second = std::max(duration, elapsed);
+           auto& durationEntry = getDurationEntry(name);
+           durationEntry.value = std::max(duration, elapsed);
+           durationEntry.histogram->record(std::max(duration, elapsed), currentTime);
         
            nanosleep(&nap, NULL);
         
@@ -136,6 +297,7 @@ class Timer
          */
         unsigned long long getDuration(const std::string& name) const
         {
+           std::lock_guard<std::mutex> lock(_durationMutex);
            auto durationIt = _durationMap.find(name);
            if (durationIt == _durationMap.end())
                return 0;
@@ -145,7 +307,7 @@ class Timer
         /**
          * Get the whole time map
          */
-        const std::unordered_map<std::string, std::atomic_ullong>& getDurationMap() const
+        const std::unordered_map<std::string, Duration>& getDurationMap() const
         {
            return _durationMap;
         }
@@ -155,11 +317,61 @@ class Timer
          */
         void setDuration(const std::string& name, unsigned long long value)
         {
-           auto durationIt = _durationMap.find(name);
-           if (durationIt == _durationMap.end())
-               _durationMap[name] = value;
-           else
-               durationIt->second = value;
+           auto& duration = getDurationEntry(name);
+           duration.value = value;
+           duration.histogram->record(value, getTime());
+        }
+
+        /**
+         * Get the statistics of the specified duration, over the last SPLASH_TIMER_HISTOGRAM_SLICES seconds
+         */
+        LatencyHistogram::Statistics getStatistics(const std::string& name)
+        {
+           std::unique_lock<std::mutex> lock(_histogramMutex);
+           auto histogramIt = _histogramMap.find(name);
+           if (histogramIt == _histogramMap.end())
+               return {};
+           auto histogram = histogramIt->second.get();
+           lock.unlock();
+
+           return histogram->getStatistics(getTime());
+        }
+
+        /**
+         * Get the statistics of all durations, sorted by name
+         */
+        std::map<std::string, LatencyHistogram::Statistics> getStatisticsMap()
+        {
+           std::map<std::string, LatencyHistogram::Statistics> statistics;
+           std::unique_lock<std::mutex> lock(_histogramMutex);
+           auto histograms = std::vector<std::pair<std::string, LatencyHistogram*>>();
+           for (auto& h : _histogramMap)
+               histograms.push_back(std::make_pair(h.first, h.second.get()));
+           lock.unlock();
+
+           auto currentTime = getTime();
+           for (auto& h : histograms)
+               statistics[h.first] = h.second->getStatistics(currentTime);
+           return statistics;
+        }
+
+        /**
+         * Get a one line summary of the statistics of all durations which
+         * were measured during the sliding window, in ms
+         */
+        std::string getStatisticsSummary()
+        {
+           std::string summary;
+           char buffer[256];
+           for (auto& s : getStatisticsMap())
+           {
+               if (s.second.count == 0)
+                   continue;
+               snprintf(buffer, sizeof(buffer), "%s%s p50 %.2f / p99 %.2f / max %.2f",
+                   summary.empty() ? "" : ", ", s.first.c_str(), s.second.p50 * 1e-3, s.second.p99 * 1e-3, s.second.max * 1e-3);
+               summary += buffer;
+           }
+           return summary;
         }
         
         /**
@@ -287,14 +499,43 @@ class Timer
         Timer(const Timer&) = delete;
         const Timer& operator=(const Timer&) = delete;
 
+    private:
+        LatencyHistogram& getHistogram(const std::string& name)
+        {
+            // Histograms are never removed, so the reference stays valid once the lock is released
+            std::lock_guard<std::mutex> lock(_histogramMutex);
+            auto histogramIt = _histogramMap.find(name);
+            if (histogramIt == _histogramMap.end())
+                histogramIt = _histogramMap.emplace(name, std::unique_ptr<LatencyHistogram>(new LatencyHistogram())).first;
+            return *histogramIt->second;
+        }
+
+        Duration& getDurationEntry(const std::string& name)
+        {
+            // The entry is complete once visible to other threads. Elements of the map are never removed,
+            // so the reference stays valid once the lock is released
+            std::lock_guard<std::mutex> lock(_durationMutex);
+            auto durationIt = _durationMap.find(name);
+            if (durationIt != _durationMap.end())
+                return durationIt->second;
+
+            // The histogram is only looked up when the duration is created, records then go through the pointer
+            auto& duration = _durationMap[name];
+            duration.histogram = &getHistogram(name);
+            return duration;
+        }
+
     private:
         std::unordered_map<std::string, std::atomic_ullong> _timeMap; 
-        std::unordered_map<std::string, std::atomic_ullong> _durationMap;
+        std::unordered_map<std::string, Duration> _durationMap;
+        mutable std::mutex _durationMutex; // Not _timerMutex, which is held between the two parts of a Timer >> duration >> name
         std::atomic_ullong _currentDuration {0};
         bool _isDurationSet {false};
 		std::thread::id _durationThreadId;
         mutable std::mutex _timerMutex;
         mutable std::mutex _clockMutex;
+        std::unordered_map<std::string, std::unique_ptr<LatencyHistogram>> _histogramMap;
+        std::mutex _histogramMutex;
         bool _enabled {true};
         bool _isDebug {false};
         Values _clock;
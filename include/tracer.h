@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2016 Emmanuel Durand
+ *
+ * This file is part of Splash.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Splash is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splash.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * @tracer.h
+ * The Tracer class, which records nested begin / end events per thread
+ * and exports them in the Chrome trace format
+ */
+
+#ifndef SPLASH_TRACER_H
+#define SPLASH_TRACER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "config.h"
+
+#define SPLASH_TRACER_EVENTS_PER_THREAD 32768
+
+namespace Splash
+{
+
+/*************/
+class Tracer
+{
+    public:
+        /**
+         * Get the singleton
+         */
+        static Tracer& get()
+        {
+            static auto instance = new Tracer;
+            return *instance;
+        }
+
+        /**
+         * Scoped event: begins when created, ends when destroyed
+         * Name and detail must outlive the tracer, typically a string literal and a string given by intern
+         * Detail is an optional information, for example BaseObject::getTraceName
+         */
+        class Scope
+        {
+            public:
+                Scope(const char* name)
+                    : _name(name)
+                    , _active(Tracer::get().isEnabled())
+                {
+                    if (_active)
+                        Tracer::get().begin(_name, nullptr);
+                }
+
+                Scope(const char* name, const char* detail)
+                    : _name(name)
+                    , _active(Tracer::get().isEnabled())
+                {
+                    if (_active)
+                        Tracer::get().begin(_name, detail);
+                }
+
+                /**
+                 * Variant for details which are not known beforehand, interned only if tracing is enabled
+                 */
+                Scope(const char* name, const std::string& detail)
+                    : _name(name)
+                    , _active(Tracer::get().isEnabled())
+                {
+                    if (_active)
+                        Tracer::get().begin(_name, Tracer::get().intern(detail));
+                }
+
+                ~Scope()
+                {
+                    if (_active)
+                        Tracer::get().end(_name);
+                }
+
+                Scope(const Scope&) = delete;
+                Scope& operator=(const Scope&) = delete;
+
+            private:
+                const char* _name;
+                bool _active;
+        };
+
+        /**
+         * Enable / disable the tracing. When disabled, scopes only cost the check of this flag
+         */
+        void setEnabled(bool enabled) {_enabled = enabled;}
+        bool isEnabled() const {return _enabled;}
+
+        /**
+         * Begin / end an event for the current thread. Events must be nested
+         */
+        void begin(const char* name, const char* detail = nullptr);
+        void end(const char* name);
+
+        /**
+         * Start a new frame. Each event holds the index of the frame it started in
+         * Only one loop per process should call it: the World, or the Scene when it has its own process
+         */
+        void nextFrame() {_frame++;}
+        uint64_t getFrame() const {return _frame;}
+
+        /**
+         * Get a pointer to a string equal to the given one, valid as long as the tracer
+         * Only the first call for a given string and thread takes a lock
+         */
+        const char* intern(const std::string& str);
+
+        /**
+         * Set the name of the current thread, as shown in the trace
+         */
+        void setThreadName(const std::string& name);
+
+        /**
+         * Write the events still held by the buffers to the given file, as Chrome trace JSON
+         * It can be opened with chrome://tracing or Perfetto
+         */
+        bool exportChromeTrace(const std::string& filename, const std::string& processName);
+
+    private:
+        struct Event
+        {
+            const char* name {nullptr};
+            const char* detail {nullptr};
+            int64_t timestamp {0};
+            uint64_t frame {0};
+            bool isBegin {false};
+        };
+
+        // Ring buffer written only by its thread
+        struct ThreadBuffer
+        {
+            std::vector<Event> events {};
+            std::atomic<uint64_t> head {0};
+            int threadId {0};
+            std::string name {};
+        };
+
+        std::atomic_bool _enabled {false};
+        std::atomic<uint64_t> _frame {0};
+
+        std::mutex _buffersMutex {};
+        std::vector<std::shared_ptr<ThreadBuffer>> _buffers {};
+
+        std::mutex _stringsMutex {};
+        std::unordered_set<std::string> _strings {};
+
+        Tracer() = default;
+        Tracer(const Tracer&) = delete;
+        Tracer& operator=(const Tracer&) = delete;
+
+        ThreadBuffer& getThreadBuffer();
+        void record(const char* name, const char* detail, bool isBegin);
+};
+
+} // end of namespace
+
+#endif // SPLASH_TRACER_H
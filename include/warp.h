@@ -112,7 +112,7 @@ class Warp : public Texture
         GlWindowPtr _window;
         std::weak_ptr<Camera> _inCamera;
 
-        GLuint _fbo {0};
+        ContextFramebuffer _fbo;
         std::shared_ptr<Texture_Image> _outTexture {nullptr};
         std::shared_ptr<Mesh_BezierPatch> _screenMesh {nullptr};
         std::shared_ptr<Object> _screen {nullptr};
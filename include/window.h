@@ -121,6 +121,12 @@ class Window : public BaseObject
          */
         bool render();
 
+        /**
+         * Set / release the context of this window as current, to render it from another thread
+         */
+        bool setAsCurrentContext() const {return _window->setAsCurrentContext();}
+        void releaseContext() const {_window->releaseContext();}
+
         /**
          * Hide / show cursor
          */
@@ -161,7 +167,7 @@ class Window : public BaseObject
         static std::atomic_int _swappableWindowsCount;
 
         // Offscreen rendering related objects
-        GLuint _renderFbo {0};
+        ContextFramebuffer _renderFbo;
         GLuint _readFbo {0};
         Texture_ImagePtr _depthTexture {nullptr};
         Texture_ImagePtr _colorTexture {nullptr};
@@ -105,6 +105,9 @@ class World : public RootObject
 
         std::map<std::string, int> _scenes;
         std::string _masterSceneName {""};
+        std::unordered_map<std::string, int> _sentDurations {}; // Last timings sent to the master Scene
+        int _timingLogPeriod {60}; // Period of the timing statistics log, in seconds, 0 to disable
+        int64_t _lastTimingLog {0};
         bool _reloadingConfig {false}; // TODO: workaround to allow for correct reloading when an inner scene was used
 
         std::atomic_int _nextId {0};
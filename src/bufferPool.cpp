@@ -0,0 +1,141 @@
+#include "bufferPool.h"
+
+#include <cstdlib>
+#include <sys/mman.h>
+
+#include "log.h"
+
+using namespace std;
+
+namespace Splash
+{
+
+/*************/
+void* BufferPool::allocate(size_t size)
+{
+    if (size == 0)
+        return nullptr;
+
+    if (size < SPLASH_BUFFER_POOL_MIN_SIZE)
+        return malloc(size);
+
+    auto mappedSize = getMappedSize(size);
+
+    {
+        lock_guard<mutex> lock(_mutex);
+        auto freeIt = _freeBuffers.find(mappedSize);
+        if (freeIt != _freeBuffers.end() && !freeIt->second.empty())
+        {
+            auto ptr = freeIt->second.back();
+            freeIt->second.pop_back();
+            _stats.hits++;
+            _stats.cachedBytes -= mappedSize;
+            _stats.usedBytes += mappedSize;
+            return ptr;
+        }
+
+        _stats.misses++;
+        _stats.usedBytes += mappedSize;
+    }
+
+    // Anonymous mappings are page aligned, and given back to the system as soon as they are unmapped
+    auto ptr = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED)
+    {
+        Log::get() << Log::ERROR << "BufferPool::" << __FUNCTION__ << " - Unable to allocate a buffer of size " << mappedSize << Log::endl;
+        lock_guard<mutex> lock(_mutex);
+        _stats.usedBytes -= mappedSize;
+        throw bad_alloc();
+    }
+
+#ifdef MADV_HUGEPAGE
+    // Only a hint: it fails silently if transparent huge pages are disabled
+    if (_useHugePages && mappedSize >= SPLASH_BUFFER_POOL_HUGE_PAGE_SIZE)
+        madvise(ptr, mappedSize, MADV_HUGEPAGE);
+#endif
+
+    return ptr;
+}
+
+/*************/
+void BufferPool::deallocate(void* ptr, size_t size)
+{
+    if (ptr == nullptr)
+        return;
+
+    if (size < SPLASH_BUFFER_POOL_MIN_SIZE)
+    {
+        free(ptr);
+        return;
+    }
+
+    auto mappedSize = getMappedSize(size);
+
+    {
+        lock_guard<mutex> lock(_mutex);
+        _stats.usedBytes -= mappedSize;
+
+        if (_stats.cachedBytes + mappedSize > SPLASH_BUFFER_POOL_MAX_CACHED)
+            makeRoom(mappedSize);
+
+        if (_stats.cachedBytes + mappedSize <= SPLASH_BUFFER_POOL_MAX_CACHED)
+        {
+            _freeBuffers[mappedSize].push_back(ptr);
+            _stats.cachedBytes += mappedSize;
+            return;
+        }
+
+        _stats.releases++;
+    }
+
+    munmap(ptr, mappedSize);
+}
+
+/*************/
+void BufferPool::clear()
+{
+    lock_guard<mutex> lock(_mutex);
+    for (auto& buffers : _freeBuffers)
+    {
+        for (auto ptr : buffers.second)
+            munmap(ptr, buffers.first);
+        _stats.releases += buffers.second.size();
+    }
+    _freeBuffers.clear();
+    _stats.cachedBytes = 0;
+}
+
+/*************/
+BufferPool::Stats BufferPool::getStats()
+{
+    lock_guard<mutex> lock(_mutex);
+    return _stats;
+}
+
+/*************/
+size_t BufferPool::getMappedSize(size_t size) const
+{
+    return (size + SPLASH_BUFFER_POOL_PAGE_SIZE - 1) / SPLASH_BUFFER_POOL_PAGE_SIZE * SPLASH_BUFFER_POOL_PAGE_SIZE;
+}
+
+/*************/
+void BufferPool::makeRoom(size_t size)
+{
+    // Buffers of another size are most likely leftovers from a media which is not played anymore
+    for (auto it = _freeBuffers.begin(); it != _freeBuffers.end() && _stats.cachedBytes + size > SPLASH_BUFFER_POOL_MAX_CACHED;)
+    {
+        if (it->first == size)
+        {
+            ++it;
+            continue;
+        }
+
+        for (auto ptr : it->second)
+            munmap(ptr, it->first);
+        _stats.releases += it->second.size();
+        _stats.cachedBytes -= it->first * it->second.size();
+        it = _freeBuffers.erase(it);
+    }
+}
+
+} // end of namespace
@@ -61,11 +61,9 @@ void Camera::init()
 
     // Intialize FBO, textures and everything OpenGL
     glGetError();
-    glGenFramebuffers(1, &_fbo);
-
     setOutputNbr(1);
 
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo);
+    _fbo.bind(GL_DRAW_FRAMEBUFFER);
     GLenum _status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
     if (_status != GL_FRAMEBUFFER_COMPLETE)
 	{
@@ -101,7 +99,10 @@ Camera::~Camera()
 #endif
 
     if (!_root.expired())
-        glDeleteFramebuffers(1, &_fbo);
+    {
+        if (_uniformBuffer != 0)
+            glDeleteBuffers(1, &_uniformBuffer);
+    }
 }
 
 /*************/
@@ -154,7 +155,7 @@ void Camera::computeBlendingMap(ImagePtr& map)
 #ifdef DEBUG
     GLenum error = glGetError();
 #endif
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, _fbo);
+    _fbo.bind(GL_READ_FRAMEBUFFER);
     ImageBuffer img(_outTextures[0]->getSpec());
     glReadPixels(0, 0, img.getSpec().width, img.getSpec().height, GL_RGBA, GL_UNSIGNED_SHORT, img.data());
     glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
@@ -394,11 +395,11 @@ bool Camera::doCalibration()
     vector<double> selectedValues(9);
 
     mutex gslMutex;
-    vector<unsigned int> threadIds;
+    TaskGroup calibrationTasks;
     // First step: we try a bunch of starts and keep the best one
     for (int index = 0; index < 4; ++index)
     {
-        threadIds.push_back(SThread::pool.enqueue([&]() {
+        calibrationTasks.run([&]() {
             gsl_multimin_fminimizer* minimizer;
             minimizer = gsl_multimin_fminimizer_alloc(minimizerType, 9);
 
@@ -454,9 +455,9 @@ bool Camera::doCalibration()
             }
 
             gsl_multimin_fminimizer_free(minimizer);
-        }));
+        });
     }
-    SThread::pool.waitThreads(threadIds);
+    calibrationTasks.wait();
 
     // Second step: we improve on the best result from the previous step
     for (int index = 0; index < 8; ++index)
@@ -602,7 +603,7 @@ Values Camera::pickVertex(float x, float y)
     float realY = y * _height;
 
     // Get the depth at the given point
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, _fbo);
+    _fbo.bind(GL_READ_FRAMEBUFFER);
     float depth;
     glReadPixels(realX, realY, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &depth);
     glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
@@ -643,7 +644,7 @@ Values Camera::pickFragment(float x, float y, float& fragDepth)
     float realY = y * _height;
 
     // Get the depth at the given point
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, _fbo);
+    _fbo.bind(GL_READ_FRAMEBUFFER);
     float depth;
     glReadPixels(realX, realY, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, &depth);
     glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
@@ -746,7 +747,7 @@ bool Camera::render()
 #endif
     glViewport(0, 0, _width, _height);
 
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo);
+    _fbo.bind(GL_DRAW_FRAMEBUFFER);
     GLenum fboBuffers[_outTextures.size()];
     for (int i = 0; i < _outTextures.size(); ++i)
         fboBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
@@ -769,43 +770,25 @@ bool Camera::render()
 
     if (!_hidden)
     {
+        auto viewMatrix = computeViewMatrix();
+        auto projectionMatrix = computeProjectionMatrix();
+
+        updateCameraUniforms();
+
         // Draw the objects
-        for (auto& o : _objects)
+        for (size_t i = 0; i < _objects.size(); ++i)
         {
-            if (o.expired())
+            auto obj = _objects[i].lock();
+            if (!obj)
                 continue;
-            auto obj = o.lock();
 
             obj->activate();
-            vec2 colorBalance = colorBalanceFromTemperature(_colorTemperature);
-            obj->getShader()->setAttribute("uniform", {"_cameraAttributes", _blendWidth, _brightness});
-            obj->getShader()->setAttribute("uniform", {"_fovAndColorBalance", _fov * _width / _height * M_PI / 180.0, _fov * M_PI / 180.0, colorBalance.x, colorBalance.y});
-            if (_colorLUT.size() == 768 && _isColorLUTActivated)
-            {
-                obj->getShader()->setAttribute("uniform", {"_colorLUT", _colorLUT});
-                obj->getShader()->setAttribute("uniform", {"_isColorLUT", 1});
-
-                Values m(10);
-                m[0] = "_colorMixMatrix";
-                for (int u = 0; u < 3; ++u)
-                    for (int v = 0; v < 3; ++v)
-                        m[u*3 + v + 1] = _colorMixMatrix[u][v];
-                obj->getShader()->setAttribute("uniform", m);
-            }
-            else
-            {
-                obj->getShader()->setAttribute("uniform", {"_isColorLUT", 0});
-            }
-
-
-            obj->setViewProjectionMatrix(computeViewMatrix(), computeProjectionMatrix());
+            updateObjectUniforms(i, obj->getUniformBlock(viewMatrix, projectionMatrix));
+            obj->setViewProjectionMatrix(viewMatrix, projectionMatrix);
             obj->draw();
             obj->deactivate();
         }
 
-        auto viewMatrix = computeViewMatrix();
-        auto projectionMatrix = computeProjectionMatrix();
-
         // Draw the calibrations points of all the cameras
         if (_displayAllCalibrations)
         {
@@ -1053,18 +1036,16 @@ void Camera::setOutputNbr(int nbr)
     if (nbr < 1 || nbr == _outTextures.size())
         return;
 
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo);
-
     if (!_depthTexture)
     {
         _depthTexture = make_shared<Texture_Image>(_root, GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, 512, 512, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
-        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, _depthTexture->getTexId(), 0);
+        _fbo.setAttachment(GL_DEPTH_ATTACHMENT, _depthTexture->getTexId());
     }
 
     if (nbr < _outTextures.size())
     {
         for (int i = nbr; i < _outTextures.size(); ++i)
-            glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, 0, 0);
+            _fbo.setAttachment(GL_COLOR_ATTACHMENT0 + i, 0);
 
         _outTextures.resize(nbr);
     }
@@ -1076,11 +1057,12 @@ void Camera::setOutputNbr(int nbr)
             texture->setAttribute("clampToEdge", {1});
             texture->setAttribute("filtering", {0});
             texture->reset(GL_TEXTURE_2D, 0, GL_RGBA, 512, 512, 0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, nullptr);
-            glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, texture->getTexId(), 0);
+            _fbo.setAttachment(GL_COLOR_ATTACHMENT0 + i, texture->getTexId());
             _outTextures.push_back(texture);
         }
     }
 
+    _fbo.bind(GL_DRAW_FRAMEBUFFER);
     glClearColor(0.0, 0.0, 0.0, 0.0);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -1090,20 +1072,16 @@ void Camera::setOutputNbr(int nbr)
 /*************/
 void Camera::updateColorDepth()
 {
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo);
-
     for (int i = 0; i < _outTextures.size(); ++i)
     {
         auto spec = _outTextures[i]->getSpec();
-        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, 0, 0);
         if (_render16bits)
             _outTextures[i]->reset(GL_TEXTURE_2D, 0, GL_RGBA16, spec.width, spec.height, 0, GL_RGBA, GL_UNSIGNED_SHORT, nullptr);
         else
             _outTextures[i]->reset(GL_TEXTURE_2D, 0, GL_RGBA, spec.width, spec.height, 0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, nullptr);
-        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, _outTextures[i]->getTexId(), 0);
+        _fbo.setAttachment(GL_COLOR_ATTACHMENT0 + i, _outTextures[i]->getTexId());
     }
 
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
     _updateColorDepth = false;
 }
 
@@ -1126,6 +1104,9 @@ void Camera::setOutputSize(int width, int height)
 
     _width = width;
     _height = height;
+
+    // The textures were specified again, possibly from another context
+    _fbo.invalidate();
 }
 
 /*************/
@@ -1311,6 +1292,79 @@ void Camera::sendCalibrationPointsToObjects()
     }
 }
 
+/*************/
+size_t Camera::getAlignedUniformBlockSize(size_t size) const
+{
+    size_t alignment = max(_uniformBufferAlignment, 1);
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+/*************/
+void Camera::updateCameraUniforms()
+{
+    if (_uniformBuffer == 0)
+    {
+        glGenBuffers(1, &_uniformBuffer);
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &_uniformBufferAlignment);
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, _uniformBuffer);
+
+    // Grow the buffer if there are more objects than slots, everything has to be sent again
+    auto bufferSize = getAlignedUniformBlockSize(sizeof(CameraUniformBlock)) + _objects.size() * getAlignedUniformBlockSize(sizeof(Object::UniformBlock));
+    if (bufferSize > _uniformBufferSize)
+    {
+        glBufferData(GL_UNIFORM_BUFFER, bufferSize, nullptr, GL_DYNAMIC_DRAW);
+        _uniformBufferSize = bufferSize;
+        _cameraUniformsUploaded = false;
+        _objectUniforms.clear();
+    }
+    _objectUniforms.resize(_objects.size());
+
+    CameraUniformBlock block;
+    memset(&block, 0, sizeof(block));
+    vec2 colorBalance = colorBalanceFromTemperature(_colorTemperature);
+    block.fovAndColorBalance = vec4(_fov * _width / _height * M_PI / 180.0, _fov * M_PI / 180.0, colorBalance.x, colorBalance.y);
+    block.cameraAttributes = vec2(_blendWidth, _brightness);
+    block.isColorLUT = (_colorLUT.size() == 768 && _isColorLUTActivated) ? 1 : 0;
+    for (int c = 0; c < 3; ++c)
+        block.colorMixMatrix[c] = vec4(_colorMixMatrix[c], 0.f);
+    if (block.isColorLUT)
+        for (int i = 0; i < 256; ++i)
+            block.colorLUT[i] = vec4(_colorLUT[i * 3], _colorLUT[i * 3 + 1], _colorLUT[i * 3 + 2], 0.f);
+
+    if (!_cameraUniformsUploaded || memcmp(&block, &_cameraUniforms, sizeof(block)) != 0)
+    {
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &block);
+        _cameraUniforms = block;
+        _cameraUniformsUploaded = true;
+    }
+
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferRange(GL_UNIFORM_BUFFER, Shader::cameraBlockBinding, _uniformBuffer, 0, sizeof(CameraUniformBlock));
+}
+
+/*************/
+void Camera::updateObjectUniforms(size_t index, const Object::UniformBlock& block)
+{
+    if (index >= _objectUniforms.size())
+        return;
+
+    auto offset = getAlignedUniformBlockSize(sizeof(CameraUniformBlock)) + index * getAlignedUniformBlockSize(sizeof(Object::UniformBlock));
+
+    auto& slot = _objectUniforms[index];
+    if (!slot.uploaded || memcmp(&block, &slot.block, sizeof(block)) != 0)
+    {
+        glBindBuffer(GL_UNIFORM_BUFFER, _uniformBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(block), &block);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        slot.block = block;
+        slot.uploaded = true;
+    }
+
+    glBindBufferRange(GL_UNIFORM_BUFFER, Shader::objectBlockBinding, _uniformBuffer, offset, sizeof(Object::UniformBlock));
+}
+
 /*************/
 void Camera::registerAttributes()
 {
@@ -1602,12 +1656,14 @@ void Camera::registerAttributes()
             if (v.getType() != Value::Type::f)
                 return false;
 
-        _colorLUT = args[0].asValues();
+        _colorLUT.clear();
+        for (auto& v : args[0].asValues())
+            _colorLUT.push_back(v.asFloat());
 
         return true;
     }, [&]() -> Values {
         if (_colorLUT.size() == 768)
-            return {_colorLUT};
+            return {Values(_colorLUT.begin(), _colorLUT.end())};
         else
             return {};
     }, {'v'});
@@ -8,15 +8,12 @@ namespace Splash
 /*************/
 void hapDecodeCallback(HapDecodeWorkFunction func, void* p, unsigned int count, void* info)
 {
-    std::vector<unsigned int> threadIds;
-    for (unsigned int i = 0; i < count; ++i)
-    {
-        threadIds.push_back(SThread::pool.enqueue([=]() {
-            func(p, i);
-        }));
-    }
-
-    SThread::pool.waitThreads(threadIds);
+    // The calling thread decodes its share of the chunks, and runs the ones not yet taken
+    // by the workers while waiting, so this can not deadlock even if it is itself a worker
+    SThread::pool.parallelFor(count, SPLASH_MAX_THREAD, [&](size_t begin, size_t end) {
+        for (auto index = begin; index < end; ++index)
+            func(p, index);
+    });
 }
 
 /*************/
@@ -34,7 +31,7 @@ bool hapDecodeFrame(void* in, unsigned int inSize, void* out, unsigned int outSi
     if (textureFormat == HapTextureFormat_RGB_DXT1)
         format = "RGB_DXT1";
     else if (textureFormat == HapTextureFormat_RGBA_DXT5)
-        format = "RGB_DXT5";
+        format = "RGBA_DXT5";
     else if (textureFormat == HapTextureFormat_YCoCg_DXT5)
         format = "YCoCg_DXT5";
     else
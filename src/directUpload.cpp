@@ -0,0 +1,154 @@
+#include "directUpload.h"
+
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+namespace Splash
+{
+
+/*************/
+DirectUploadTarget::DirectUploadTarget(const ImageBufferSpec& spec, const vector<char*>& buffers)
+    : _spec(spec)
+{
+    for (int i = 0; i < SPLASH_DIRECT_UPLOAD_SLOTS && i < buffers.size(); ++i)
+        _slots[i].data = buffers[i];
+}
+
+/*************/
+bool DirectUploadTarget::write(ImageBufferSpec spec, const function<void(char*)>& copy)
+{
+    if (_closed || spec != _spec)
+        return false;
+
+    // Take a free slot, or replace the frame not yet uploaded by this more recent one
+    Slot* slot = nullptr;
+    for (auto state : {FREE, READY})
+    {
+        for (auto& s : _slots)
+        {
+            int expected = state;
+            if (s.data && s.state.compare_exchange_strong(expected, WRITING))
+            {
+                slot = &s;
+                break;
+            }
+        }
+
+        if (slot)
+            break;
+    }
+
+    if (!slot)
+    {
+        _dropped++;
+        return true;
+    }
+
+    // The target may have been closed after the check above
+    if (_closed)
+    {
+        slot->state = FREE;
+        return false;
+    }
+
+    copy(slot->data);
+    slot->timestamp = spec.timestamp;
+    slot->frameIndex = spec.frameIndex;
+    slot->sequence = ++_sequence;
+    slot->state = READY;
+
+    return true;
+}
+
+/*************/
+int DirectUploadTarget::acquireReadySlot()
+{
+    int newest = -1;
+    uint64_t newestSequence = 0;
+    for (int i = 0; i < SPLASH_DIRECT_UPLOAD_SLOTS; ++i)
+    {
+        if (_slots[i].state == READY && _slots[i].sequence > newestSequence)
+        {
+            newest = i;
+            newestSequence = _slots[i].sequence;
+        }
+    }
+
+    if (newest == -1)
+        return -1;
+
+    int expected = READY;
+    if (!_slots[newest].state.compare_exchange_strong(expected, UPLOADING))
+        return -1; // The producer is replacing it, it will be ready for the next upload
+
+    // Older frames are not needed anymore
+    for (int i = 0; i < SPLASH_DIRECT_UPLOAD_SLOTS; ++i)
+    {
+        expected = READY;
+        if (i != newest && _slots[i].sequence < newestSequence)
+            _slots[i].state.compare_exchange_strong(expected, FREE);
+    }
+
+    return newest;
+}
+
+/*************/
+void DirectUploadTarget::releaseSlot(int index)
+{
+    if (index < 0 || index >= SPLASH_DIRECT_UPLOAD_SLOTS)
+        return;
+
+    int expected = UPLOADING;
+    _slots[index].state.compare_exchange_strong(expected, FREE);
+}
+
+/*************/
+void DirectUploadTarget::close()
+{
+    _closed = true;
+
+    // A writer checks _closed after taking its slot, so once no slot is being written,
+    // no write can start anymore
+    while (any_of(begin(_slots), end(_slots), [](const Slot& s) {return s.state == WRITING;}))
+        this_thread::yield();
+}
+
+/*************/
+void DirectUpload::registerTarget(const string& name, const shared_ptr<DirectUploadTarget>& target)
+{
+    lock_guard<mutex> lock(_mutex);
+    _targets[name].push_back(target);
+}
+
+/*************/
+void DirectUpload::unregisterTarget(const string& name, const shared_ptr<DirectUploadTarget>& target)
+{
+    lock_guard<mutex> lock(_mutex);
+    auto targetsIt = _targets.find(name);
+    if (targetsIt == _targets.end())
+        return;
+
+    auto& targets = targetsIt->second;
+    targets.erase(remove(targets.begin(), targets.end(), target), targets.end());
+    if (targets.empty())
+        _targets.erase(targetsIt);
+}
+
+/*************/
+shared_ptr<DirectUploadTarget> DirectUpload::getTarget(const string& name)
+{
+    if (!_active)
+        return {};
+
+    lock_guard<mutex> lock(_mutex);
+    auto targetsIt = _targets.find(name);
+    // With more than one texture for this image, each of them needs the serialized frames
+    if (targetsIt == _targets.end() || targetsIt->second.size() != 1)
+        return {};
+
+    return targetsIt->second[0];
+}
+
+} // end of namespace
@@ -194,6 +194,14 @@ void Filter::update()
 /*************/
 void Filter::updateUniforms()
 {
+    static auto filmRemainingHandle = Shader::getUniformHandle("_filmRemaining");
+    static auto filmDurationHandle = Shader::getUniformHandle("_filmDuration");
+    static auto blackLevelHandle = Shader::getUniformHandle("_blackLevel");
+    static auto brightnessHandle = Shader::getUniformHandle("_brightness");
+    static auto contrastHandle = Shader::getUniformHandle("_contrast");
+    static auto colorBalanceHandle = Shader::getUniformHandle("_colorBalance");
+    static auto saturationHandle = Shader::getUniformHandle("_saturation");
+
     auto shader = _screen->getShader();
 
     for (auto& weakObject : _linkedObjects)
@@ -209,18 +217,18 @@ void Filter::updateUniforms()
                 obj->getAttribute("duration", duration);
                 obj->getAttribute("remaining", remainingTime);
                 if (remainingTime.size() == 1)
-                    shader->setAttribute("uniform", {"_filmRemaining", remainingTime[0].asFloat()});
+                    shader->setUniform(filmRemainingHandle, remainingTime[0].asFloat());
                 if (duration.size() == 1)
-                    shader->setAttribute("uniform", {"_filmDuration", duration[0].asFloat()});
+                    shader->setUniform(filmDurationHandle, duration[0].asFloat());
             }
         }
     }
 
-    shader->setAttribute("uniform", {"_blackLevel", _blackLevel});
-    shader->setAttribute("uniform", {"_brightness", _brightness});
-    shader->setAttribute("uniform", {"_contrast", _contrast});
-    shader->setAttribute("uniform", {"_colorBalance", _colorBalance.x, _colorBalance.y});
-    shader->setAttribute("uniform", {"_saturation", _saturation});
+    shader->setUniform(blackLevelHandle, _blackLevel);
+    shader->setUniform(brightnessHandle, _brightness);
+    shader->setUniform(contrastHandle, _contrast);
+    shader->setUniform(colorBalanceHandle, _colorBalance);
+    shader->setUniform(saturationHandle, _saturation);
 }
 
 /*************/
@@ -83,17 +83,17 @@ void Geometry::activateAsSharedBuffer()
     }
     else
     {
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, _glBuffers[0]->getId());
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, _glBuffers[1]->getId());
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, _glBuffers[2]->getId());
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, _glBuffers[3]->getId());
+        // Streamed buffers are bound to the region currently in use
+        for (unsigned int i = 0; i < _glBuffers.size(); ++i)
+            glBindBufferRange(GL_SHADER_STORAGE_BUFFER, i, _glBuffers[i]->getId(), _glBuffers[i]->getOffset(), _glBuffers[i]->getMemorySize());
     }
 }
 
 /*************/
 void Geometry::activateForFeedback()
 {
-    _feedbackMaxNbrPrimitives = std::max(_verticesNumber / 3, _feedbackMaxNbrPrimitives);
+    int primitivesNumber = (_indicesNumber != 0 ? _indicesNumber : _verticesNumber) / 3;
+    _feedbackMaxNbrPrimitives = std::max(primitivesNumber, _feedbackMaxNbrPrimitives);
     if (_glTemporaryBuffers.size() < _glBuffers.size() || _buffersDirty || _feedbackMaxNbrPrimitives * 6 > _temporaryBufferSize)
     {
         _glTemporaryBuffers.clear();
@@ -209,6 +209,36 @@ float Geometry::pickVertex(dvec3 p, dvec3& v)
     return distance;
 }
 
+/*************/
+void Geometry::resetAlternativeBuffers()
+{
+    if (!_glIndexBuffer)
+    {
+        useAlternativeBuffers(false);
+        return;
+    }
+
+    auto indexBuffer = _glIndexBuffer->getBufferAsVector();
+    auto indices = reinterpret_cast<const unsigned int*>(indexBuffer.data());
+
+    _glAlternativeBuffers.clear();
+    for (auto& buffer : _glBuffers)
+    {
+        auto vertexBuffer = buffer->getBufferAsVector();
+        auto vertexSize = buffer->getElementSize() * buffer->getComponentSize();
+
+        vector<char> soup(_indicesNumber * vertexSize);
+        for (int i = 0; i < _indicesNumber; ++i)
+            memcpy(soup.data() + i * vertexSize, vertexBuffer.data() + indices[i] * vertexSize, vertexSize);
+
+        _glAlternativeBuffers.push_back(make_shared<GpuBuffer>(buffer->getElementSize(), GL_FLOAT, GL_STATIC_DRAW, _indicesNumber, soup.data()));
+    }
+
+    _alternativeVerticesNumber = _indicesNumber;
+    _alternativeBufferSize = _indicesNumber;
+    useAlternativeBuffers(true);
+}
+
 /*************/
 void Geometry::swapBuffers()
 {
@@ -230,61 +260,109 @@ void Geometry::update()
         return;
     auto mesh = _mesh.lock();
 
+    lock_guard<mutex> lock(_mutex);
+
     if (_glBuffers.size() != 4)
         _glBuffers.resize(4);
 
+    if (_updatesSinceUpload <= SPLASH_GEOMETRY_LIVE_MESH_UPDATES)
+        ++_updatesSinceUpload;
+
     // Update the vertex buffers if mesh was updated
-    if (_timestamp != mesh->getTimestamp())
+    if (!_uploadLocked && _timestamp != mesh->getTimestamp())
     {
         mesh->update();
 
         vector<float> vertices = mesh->getVertCoords();
-        if (vertices.size() == 0)
-            return;
-        _verticesNumber = vertices.size() / 4;
-        _glBuffers[0] = make_shared<GpuBuffer>(4, GL_FLOAT, GL_STATIC_DRAW, _verticesNumber, vertices.data());
-        
         vector<float> texcoords = mesh->getUVCoords();
-        if (texcoords.size() == 0)
-            return;
-        _glBuffers[1] = make_shared<GpuBuffer>(2, GL_FLOAT, GL_STATIC_DRAW, _verticesNumber, texcoords.data());
-
         vector<float> normals = mesh->getNormals();
-        if (normals.size() == 0)
+        if (vertices.size() == 0 || texcoords.size() == 0 || normals.size() == 0)
             return;
-        _glBuffers[2] = make_shared<GpuBuffer>(4, GL_FLOAT, GL_STATIC_DRAW, _verticesNumber, normals.data());
 
         // An additional annexe buffer, to be filled by compute shaders. Contains a vec4 for each vertex
         vector<float> annexe = mesh->getAnnexe();
-        if (annexe.size() == 0)
-            _glBuffers[3] = make_shared<GpuBuffer>(4, GL_FLOAT, GL_STATIC_DRAW, _verticesNumber, nullptr);
-        else
-            _glBuffers[3] = make_shared<GpuBuffer>(4, GL_FLOAT, GL_STATIC_DRAW, _verticesNumber, annexe.data());
+        // The element buffer, if the mesh is indexed
+        vector<unsigned int> indices = mesh->getIndices();
 
-        // Check the buffers
-        bool buffersSet = true;
-        for (auto& buffer : _glBuffers)
-            if (!*buffer)
-                buffersSet = false;
+        int verticesNumber = vertices.size() / 4;
+        int indicesNumber = indices.size();
+
+        // A mesh updated again shortly after its previous upload is considered as live: its buffers are streamed, and updated in place.
+        // The first upload of a mesh holds its default geometry, and is replaced as soon as the actual one is received: it is not counted
+        if (_uploadedMesh.lock() != mesh)
+            _meshUploads = 0;
+        bool isLive = _meshUploads >= 2 && _updatesSinceUpload <= SPLASH_GEOMETRY_LIVE_MESH_UPDATES;
+        _uploadedMesh = mesh;
+        ++_meshUploads;
+        _updatesSinceUpload = 0;
+
+        bool updateInPlace = isLive && _glBuffers[0] && _glBuffers[0]->isStreamed() && verticesNumber <= _glBuffers[0]->getSize()
+                             && (indicesNumber == 0) == (!_glIndexBuffer) && (!_glIndexBuffer || indicesNumber <= _glIndexBuffer->getSize());
 
-        if (!buffersSet)
+        if (updateInPlace)
         {
-            _glBuffers.clear();
-            _glBuffers.resize(4);
-            return;
+            _glBuffers[0]->setData(vertices.data(), verticesNumber);
+            _glBuffers[1]->setData(texcoords.data(), verticesNumber);
+            _glBuffers[2]->setData(normals.data(), verticesNumber);
+            if (annexe.size() == 0)
+                _glBuffers[3]->clear();
+            else
+                _glBuffers[3]->setData(annexe.data(), verticesNumber);
+            if (_glIndexBuffer)
+                _glIndexBuffer->setData(indices.data(), indicesNumber);
+
+            _verticesNumber = verticesNumber;
+            _indicesNumber = indicesNumber;
+
+            // The buffers are the same, but the regions to read from changed
+            ++_buffersVersion;
         }
+        else
+        {
+            GLenum usage = isLive ? GL_STREAM_DRAW : GL_STATIC_DRAW;
+
+            _verticesNumber = verticesNumber;
+            _glBuffers[0] = make_shared<GpuBuffer>(4, GL_FLOAT, usage, _verticesNumber, vertices.data());
+            _glBuffers[1] = make_shared<GpuBuffer>(2, GL_FLOAT, usage, _verticesNumber, texcoords.data());
+            _glBuffers[2] = make_shared<GpuBuffer>(4, GL_FLOAT, usage, _verticesNumber, normals.data());
+            if (annexe.size() == 0)
+                _glBuffers[3] = make_shared<GpuBuffer>(4, GL_FLOAT, usage, _verticesNumber, nullptr);
+            else
+                _glBuffers[3] = make_shared<GpuBuffer>(4, GL_FLOAT, usage, _verticesNumber, annexe.data());
 
-        for (auto& v : _vertexArray)
-            glDeleteVertexArrays(1, &(v.second));
-        _vertexArray.clear();
+            _indicesNumber = indicesNumber;
+            if (_indicesNumber == 0)
+                _glIndexBuffer.reset();
+            else
+                _glIndexBuffer = make_shared<GpuBuffer>(1, GL_UNSIGNED_INT, usage, _indicesNumber, indices.data());
+
+            // Check the buffers
+            bool buffersSet = true;
+            for (auto& buffer : _glBuffers)
+                if (!*buffer)
+                    buffersSet = false;
+            if (_glIndexBuffer && !*_glIndexBuffer)
+                buffersSet = false;
 
-        _timestamp = mesh->getTimestamp();
+            if (!buffersSet)
+            {
+                _glBuffers.clear();
+                _glBuffers.resize(4);
+                _glIndexBuffer.reset();
+                _indicesNumber = 0;
+                return;
+            }
 
-        _buffersDirty = true;
+            // Vertex arrays belong to the context they were created in, each one is updated from there
+            ++_buffersVersion;
+            _buffersDirty = true;
+        }
+
+        _timestamp = mesh->getTimestamp();
     }
 
     // If a serialized geometry is present, we use it as the alternative buffer
-    if (!_onMasterScene && _serializedObject && _serializedObject->size() != 0)
+    if (!_uploadLocked && !_onMasterScene && _serializedObject && _serializedObject->size() != 0)
     {
         if (_glTemporaryBuffers.size() != 4)
             _glTemporaryBuffers.resize(4);
@@ -318,12 +396,13 @@ void Geometry::update()
 
 
         swapBuffers();
+        ++_buffersVersion;
         _buffersDirty = true;
     }
 
     GLFWwindow* context = glfwGetCurrentContext();
     auto vertexArrayIt = _vertexArray.find(context);
-    if (vertexArrayIt == _vertexArray.end() || _buffersDirty)
+    if (vertexArrayIt == _vertexArray.end() || _vertexArrayVersion[context] != _buffersVersion)
     {
         if (vertexArrayIt == _vertexArray.end())
         {
@@ -344,14 +423,21 @@ void Geometry::update()
             else
             {
                 glBindBuffer(GL_ARRAY_BUFFER, _glBuffers[idx]->getId());
-                glVertexAttribPointer((GLuint)idx, _glBuffers[idx]->getElementSize(), GL_FLOAT, GL_FALSE, 0, 0);
+                glVertexAttribPointer((GLuint)idx, _glBuffers[idx]->getElementSize(), GL_FLOAT, GL_FALSE, 0, (GLvoid*)_glBuffers[idx]->getOffset());
             }
             glEnableVertexAttribArray((GLuint)idx);
         }
 
+        // The element buffer binding is part of the vertex array state
+        if (_glIndexBuffer && !_useAlternativeBuffers)
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _glIndexBuffer->getId());
+        else
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glBindVertexArray(0);
 
+        _vertexArrayVersion[context] = _buffersVersion;
         _buffersDirty = false;
     }
 }
@@ -360,6 +446,7 @@ void Geometry::update()
 void Geometry::useAlternativeBuffers(bool isActive)
 {
     _useAlternativeBuffers = isActive;
+    ++_buffersVersion;
     _buffersDirty = true;
 }
 
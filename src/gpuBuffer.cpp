@@ -1,5 +1,9 @@
 #include "gpuBuffer.h"
 
+#include <cstring>
+
+#include "log.h"
+
 using namespace std;
 
 namespace Splash
@@ -39,6 +43,12 @@ GpuBuffer::GpuBuffer(GLint elementSize, GLenum type, GLenum usage, size_t size,
     _type = type;
     _usage = usage;
 
+    if (usage == GL_STREAM_DRAW && allocateRing(data))
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return;
+    }
+
     if (data == nullptr)
     {
         auto zeroBuffer = vector<char>(size * _elementSize * _baseSize, 0);
@@ -55,6 +65,7 @@ GpuBuffer::GpuBuffer(GLint elementSize, GLenum type, GLenum usage, size_t size,
 /*************/
 GpuBuffer::~GpuBuffer()
 {
+    releaseFences();
     if (_glId)
         glDeleteBuffers(1, &_glId);
     if (_copyBufferId)
@@ -67,6 +78,13 @@ void GpuBuffer::clear()
     if (!_glId)
         return;
 
+    // Streamed buffers are cleared like they are updated, region by region
+    if (_mappedData)
+    {
+        memset(getNextRegion(), 0, getMemorySize());
+        return;
+    }
+
     glBindBuffer(GL_ARRAY_BUFFER, _glId);
     glClearBufferData(GL_ARRAY_BUFFER, GL_R8, GL_RED, _type, NULL);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -107,7 +125,7 @@ vector<char> GpuBuffer::getBufferAsVector(size_t vertexNbr)
     // Copy the actual buffer to the copy buffer
     glBindBuffer(GL_COPY_READ_BUFFER, _glId);
     glBindBuffer(GL_COPY_WRITE_BUFFER, _copyBufferId);
-    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, vectorSize);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, getOffset(), 0, vectorSize);
     glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
     glBindBuffer(GL_COPY_READ_BUFFER, 0);
 
@@ -129,6 +147,12 @@ void GpuBuffer::setBufferFromVector(const vector<char>& buffer)
     if (buffer.size() > _baseSize * _elementSize * _size)
         resize(buffer.size());
 
+    if (_mappedData)
+    {
+        setData(buffer.data(), buffer.size() / (_baseSize * _elementSize));
+        return;
+    }
+
     glBindBuffer(GL_ARRAY_BUFFER, _glId);
     glBufferSubData(GL_ARRAY_BUFFER, 0, buffer.size(), buffer.data());
     glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -140,16 +164,102 @@ void GpuBuffer::resize(size_t size)
     if (!_type || !_usage || !_elementSize)
         return;
 
+    // Deleting the buffer also unmaps it
+    bool isStreamed = (_mappedData != nullptr);
+    releaseFences();
+    _mappedData = nullptr;
+    _ringIndex = 0;
+
     glDeleteBuffers(1, &_glId);
     glGenBuffers(1, &_glId);
     if (!_glId)
         return;
 
+    _size = size;
+
     glBindBuffer(GL_ARRAY_BUFFER, _glId);
-    glBufferData(GL_ARRAY_BUFFER, size * _elementSize * _baseSize, nullptr, _usage);
+    if (!isStreamed || !allocateRing(nullptr))
+        glBufferData(GL_ARRAY_BUFFER, size * _elementSize * _baseSize, nullptr, _usage);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
-    _size = size;
+/*************/
+bool GpuBuffer::setData(const GLvoid* data, size_t size)
+{
+    if (!_glId || !_elementSize || size > _size)
+        return false;
+
+    if (!_mappedData)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, _glId);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, size * _elementSize * _baseSize, data);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        return true;
+    }
+
+    memcpy(getNextRegion(), data, size * _elementSize * _baseSize);
+    return true;
+}
+
+/*************/
+char* GpuBuffer::getNextRegion()
+{
+    // Fence the region which was read until now, and move to the next one
+    // which was fenced SPLASH_GPU_BUFFER_RING_SIZE - 1 updates ago
+    if (_ringFences[_ringIndex])
+        glDeleteSync(_ringFences[_ringIndex]);
+    _ringFences[_ringIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _ringIndex = (_ringIndex + 1) % SPLASH_GPU_BUFFER_RING_SIZE;
+
+    if (_ringFences[_ringIndex])
+    {
+        if (glClientWaitSync(_ringFences[_ringIndex], GL_SYNC_FLUSH_COMMANDS_BIT, SPLASH_GPU_BUFFER_FENCE_TIMEOUT) == GL_TIMEOUT_EXPIRED)
+            Log::get() << Log::DEBUGGING << "GpuBuffer::" << __FUNCTION__ << " - Timeout while waiting for the GPU to release a region" << Log::endl;
+        glDeleteSync(_ringFences[_ringIndex]);
+        _ringFences[_ringIndex] = nullptr;
+    }
+
+    return _mappedData + getOffset();
+}
+
+/*************/
+bool GpuBuffer::allocateRing(const GLvoid* data)
+{
+    if (!GLAD_GL_ARB_buffer_storage)
+        return false;
+
+    auto regionSize = getMemorySize();
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_ARRAY_BUFFER, regionSize * SPLASH_GPU_BUFFER_RING_SIZE, nullptr, flags);
+    _mappedData = static_cast<char*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, regionSize * SPLASH_GPU_BUFFER_RING_SIZE, flags));
+
+    if (!_mappedData)
+    {
+        // The storage is immutable, so we need a new buffer to fall back to glBufferData
+        glDeleteBuffers(1, &_glId);
+        glGenBuffers(1, &_glId);
+        glBindBuffer(GL_ARRAY_BUFFER, _glId);
+        return false;
+    }
+
+    _ringIndex = 0;
+    if (data)
+        memcpy(_mappedData, data, regionSize);
+    else
+        memset(_mappedData, 0, regionSize);
+
+    return true;
+}
+
+/*************/
+void GpuBuffer::releaseFences()
+{
+    for (auto& fence : _ringFences)
+    {
+        if (fence)
+            glDeleteSync(fence);
+        fence = nullptr;
+    }
 }
 
 } // end of namespace
@@ -9,6 +9,7 @@
 
 #include "log.h"
 #include "scene.h"
+#include "timer.h"
 
 using namespace std;
 
@@ -687,6 +688,8 @@ namespace Http {
                 _commandQueue.push_back({CommandId::get, args});
             else if (args[0].asString() == "/scene")
                 _commandQueue.push_back({CommandId::scene, args});
+            else if (args[0].asString() == "/stats")
+                _commandQueue.push_back({CommandId::stats, args});
             else
             {
                 Log::get() << Log::WARNING << "RequestHandler::" << __FUNCTION__ << " - No command associated to string " << args[0].asString() << Log::endl;
@@ -929,6 +932,24 @@ void HttpServer::run()
                     else
                         returnFunc("Failed");
                 }
+                else if (command == Http::RequestHandler::CommandId::stats)
+                {
+                    // Timing statistics of this process, in us, over the sliding window of the histograms
+                    Json::Value jsValue;
+                    for (auto& s : Timer::get().getStatisticsMap())
+                    {
+                        Json::Value jsStats;
+                        jsStats["count"] = (Json::UInt64)s.second.count;
+                        jsStats["min"] = (Json::UInt64)s.second.min;
+                        jsStats["mean"] = (Json::UInt64)s.second.mean;
+                        jsStats["p50"] = (Json::UInt64)s.second.p50;
+                        jsStats["p95"] = (Json::UInt64)s.second.p95;
+                        jsStats["p99"] = (Json::UInt64)s.second.p99;
+                        jsStats["max"] = (Json::UInt64)s.second.max;
+                        jsValue[s.first] = jsStats;
+                    }
+                    returnFunc(jsValue.toStyledString());
+                }
             }
             else
             {
@@ -1,17 +1,21 @@
 #include "image.h"
 
+#include <cstring>
 #include <fstream>
 #include <memory>
+#include <stdexcept>
 
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include <stb_image.h>
 #include <stb_image_write.h>
 
+#include "directUpload.h"
 #include "log.h"
 #include "osUtils.h"
 #include "threadpool.h"
 #include "timer.h"
+#include "tracer.h"
 
 #define SPLASH_IMAGE_COPY_THREADS 2
 #define SPLASH_IMAGE_SERIALIZED_HEADER_SIZE 4096
@@ -123,43 +127,51 @@ shared_ptr<SerializedObject> Image::serialize() const
 {
     lock_guard<mutex> lock(_readMutex);
 
+    if (!_image)
+        return {};
+
+    // Copy the image to the given buffer, split between a few threads
+    auto copyImage = [&](char* dst) {
+        const char* imgPtr = reinterpret_cast<const char*>(_image->data());
+        SThread::pool.parallelFor(_image->getSpec().rawSize(), SPLASH_IMAGE_COPY_THREADS, [&](size_t begin, size_t end) {
+            copy(imgPtr + begin, imgPtr + end, dst + begin);
+        });
+    };
+
+    // If the texture of this image lives in the same process, the frame is written directly to its buffers
+    if (_worldObject && _image->data() != nullptr)
+    {
+        auto target = DirectUpload::get().getTarget(_name);
+        if (target && target->write(_image->getSpec(), copyImage))
+            return {};
+    }
+
     if (Timer::get().isDebug())
         Timer::get() << "serialize " + _name;
 
-    // We first get the xml version of the specs, and pack them into the obj
-    if (!_image)
+    // We first write the binary header, followed by the format if it has no code
+    string customFormat;
+    auto header = _image->getSpec().toHeader(customFormat);
+    if (sizeof(header) + customFormat.size() > SPLASH_IMAGE_SERIALIZED_HEADER_SIZE)
+    {
+        Log::get() << Log::WARNING << "Image::" << __FUNCTION__ << " - Image format description is too long to be serialized" << Log::endl;
         return {};
-    string xmlSpec = _image->getSpec().to_string();
-    int nbrChar = xmlSpec.size();
+    }
+
     int imgSize = _image->getSpec().rawSize();
     int totalSize = SPLASH_IMAGE_SERIALIZED_HEADER_SIZE + imgSize;
-    
+
     auto obj = make_shared<SerializedObject>(totalSize);
 
     auto currentObjPtr = obj->data();
-    const char* ptr = reinterpret_cast<const char*>(&nbrChar);
-    copy(ptr, ptr + sizeof(nbrChar), currentObjPtr);
-    currentObjPtr += sizeof(nbrChar);
-
-    const char* charPtr = reinterpret_cast<const char*>(xmlSpec.c_str());
-    copy(charPtr, charPtr + nbrChar, currentObjPtr);
+    memcpy(currentObjPtr, &header, sizeof(header));
+    copy(customFormat.begin(), customFormat.end(), currentObjPtr + sizeof(header));
     currentObjPtr = obj->data() + SPLASH_IMAGE_SERIALIZED_HEADER_SIZE;
 
     // And then, the image
-    const char* imgPtr = reinterpret_cast<const char*>(_image->data());
-    if (imgPtr == NULL)
+    if (_image->data() == nullptr)
         return {};
-    
-    vector<unsigned int> threadIds;
-    int stride = SPLASH_IMAGE_COPY_THREADS;
-    for (int i = 0; i < stride - 1; ++i)
-    {
-        threadIds.push_back(SThread::pool.enqueue([=]() {
-            copy(imgPtr + imgSize / stride * i, imgPtr + imgSize / stride * (i + 1), currentObjPtr + imgSize / stride * i);
-        }));
-    }
-    copy(imgPtr + imgSize / stride * (stride - 1), imgPtr + imgSize, currentObjPtr + imgSize / stride * (stride - 1));
-    SThread::pool.waitThreads(threadIds);
+    copyImage(currentObjPtr);
 
     if (Timer::get().isDebug())
         Timer::get() >> "serialize " + _name;
@@ -170,38 +182,40 @@ shared_ptr<SerializedObject> Image::serialize() const
 /*************/
 bool Image::deserialize(const shared_ptr<SerializedObject>& obj)
 {
-    if (obj.get() == nullptr || obj->size() == 0)
+    if (obj.get() == nullptr || obj->size() < SPLASH_IMAGE_SERIALIZED_HEADER_SIZE)
         return false;
 
     if (Timer::get().isDebug())
         Timer::get() << "deserialize " + _name;
+    Tracer::Scope trace("deserialize", _traceName);
 
-    // First, we get the size of the metadata
-    int nbrChar;
-    char* ptr = reinterpret_cast<char*>(&nbrChar);
-
-    auto currentObjPtr = obj->data();
-    copy(currentObjPtr, currentObjPtr + sizeof(nbrChar), ptr);
-    currentObjPtr += sizeof(nbrChar);
+    // First, we get the header, and the spec it describes
+    ImageBufferSpec::Header header;
+    memcpy(&header, obj->data(), sizeof(header));
 
     try
     {
-        char xmlSpecChar[nbrChar];
-        ptr = reinterpret_cast<char*>(xmlSpecChar);
-        copy(currentObjPtr, currentObjPtr + nbrChar, ptr);
-        currentObjPtr = obj->data() + SPLASH_IMAGE_SERIALIZED_HEADER_SIZE;
-        string xmlSpec(xmlSpecChar);
+        if (header.magic != ImageBufferSpec::Header::MAGIC || header.version != ImageBufferSpec::Header::VERSION)
+            throw runtime_error("unknown header");
 
-        ImageBufferSpec spec;
-        spec.from_string(xmlSpec.c_str());
+        // The spec is only parsed when it changes
+        if (header.formatCode == ImageBufferSpec::Header::Custom || !header.sameSpec(_deserializeHeader))
+        {
+            ImageBufferSpec spec;
+            if (sizeof(header) + header.formatSize > SPLASH_IMAGE_SERIALIZED_HEADER_SIZE || !spec.fromHeader(header, obj->data() + sizeof(header)))
+                throw runtime_error("invalid header");
+            _deserializeSpec = spec;
+        }
+        _deserializeHeader = header;
+        _deserializeSpec.timestamp = header.timestamp;
+        _deserializeSpec.frameIndex = header.frameIndex;
 
-        ImageBufferSpec curSpec = _bufferDeserialize.getSpec();
-        if (spec != curSpec)
-            _bufferDeserialize = ImageBuffer(spec);
+        if (obj->size() < static_cast<size_t>(SPLASH_IMAGE_SERIALIZED_HEADER_SIZE + _deserializeSpec.rawSize()))
+            throw runtime_error("truncated image");
 
         auto rawBuffer = obj->grabData();
         rawBuffer.shift(SPLASH_IMAGE_SERIALIZED_HEADER_SIZE);
-        _bufferDeserialize.setRawBuffer(std::move(rawBuffer));
+        _bufferDeserialize.setRawBuffer(std::move(rawBuffer), _deserializeSpec);
 
         if (!_bufferImage)
             _bufferImage = unique_ptr<ImageBuffer>(new ImageBuffer());
@@ -403,6 +417,14 @@ void Image::registerAttributes()
     }, {'n'});
     setAttributeDescription("srgb", "Set to 1 if the image file is stored as sRGB");
 
+    addAttribute("gpuYUV", [&](const Values& args) {
+        _gpuYUV = (args[0].asInt() > 0) ? true : false;
+        return true;
+    }, [&]() -> Values {
+        return {_gpuYUV};
+    }, {'n'});
+    setAttributeDescription("gpuYUV", "Set to 1 for YUV video sources to be converted to RGB by the GPU instead of the CPU");
+
     addAttribute("benchmark", [&](const Values& args) {
         if (args[0].asInt() > 0)
             _benchmark = true;
@@ -1,5 +1,7 @@
 #include "./imageBuffer.h"
 
+#include <algorithm>
+
 using namespace std;
 
 namespace Splash {
@@ -101,6 +103,94 @@ void ImageBufferSpec::from_string(const string& spec)
     }
 }
 
+/*************/
+namespace
+{
+const vector<pair<ImageBufferSpec::Header::FormatCode, vector<string>>> formatCodes {
+    {ImageBufferSpec::Header::R, {"R"}},
+    {ImageBufferSpec::Header::RG, {"R", "G"}},
+    {ImageBufferSpec::Header::RGB, {"R", "G", "B"}},
+    {ImageBufferSpec::Header::RGBA, {"R", "G", "B", "A"}},
+    {ImageBufferSpec::Header::BGR, {"B", "G", "R"}},
+    {ImageBufferSpec::Header::BGRA, {"B", "G", "R", "A"}},
+    {ImageBufferSpec::Header::RGB_DXT1, {"RGB_DXT1"}},
+    {ImageBufferSpec::Header::RGBA_DXT5, {"RGBA_DXT5"}},
+    {ImageBufferSpec::Header::YCoCg_DXT5, {"YCoCg_DXT5"}},
+    {ImageBufferSpec::Header::YUV_I420, {"YUV_I420"}},
+    {ImageBufferSpec::Header::YUV_UYVY, {"YUV_UYVY"}}
+};
+}
+
+/*************/
+ImageBufferSpec::Header ImageBufferSpec::toHeader(string& customFormat) const
+{
+    Header header;
+    header.width = width;
+    header.height = height;
+    header.channels = channels;
+    header.type = static_cast<uint32_t>(type);
+    header.timestamp = timestamp;
+    header.frameIndex = frameIndex;
+
+    customFormat.clear();
+    auto codeIt = find_if(formatCodes.begin(), formatCodes.end(), [&](const pair<Header::FormatCode, vector<string>>& code) {
+        return code.second == format;
+    });
+
+    if (codeIt != formatCodes.end())
+    {
+        header.formatCode = codeIt->first;
+    }
+    else
+    {
+        for (auto& c : format)
+            customFormat += c + ";";
+        header.formatSize = customFormat.size();
+    }
+
+    return header;
+}
+
+/*************/
+bool ImageBufferSpec::fromHeader(const Header& header, const char* customFormat)
+{
+    if (header.magic != Header::MAGIC || header.version != Header::VERSION)
+        return false;
+    if (header.type > static_cast<uint32_t>(Type::FLOAT))
+        return false;
+
+    width = header.width;
+    height = header.height;
+    channels = header.channels;
+    type = static_cast<Type>(header.type);
+    timestamp = header.timestamp;
+    frameIndex = header.frameIndex;
+
+    format.clear();
+    if (header.formatCode == Header::Custom)
+    {
+        auto formatString = string(customFormat, header.formatSize);
+        size_t prev = 0;
+        size_t curr;
+        while ((curr = formatString.find(";", prev)) != string::npos)
+        {
+            format.push_back(formatString.substr(prev, curr - prev));
+            prev = curr + 1;
+        }
+    }
+    else
+    {
+        auto codeIt = find_if(formatCodes.begin(), formatCodes.end(), [&](const pair<Header::FormatCode, vector<string>>& code) {
+            return code.first == header.formatCode;
+        });
+        if (codeIt == formatCodes.end())
+            return false;
+        format = codeIt->second;
+    }
+
+    return true;
+}
+
 /*************/
 ImageBuffer::ImageBuffer()
 {
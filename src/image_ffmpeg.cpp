@@ -12,6 +12,11 @@
 #define PIX_FMT_RGB24 AV_PIX_FMT_RGB24
 #endif
 
+// The send / receive decoding API appeared with FFmpeg 3.1
+#define SPLASH_FFMPEG_SEND_RECEIVE (LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(57, 37, 100))
+#define SPLASH_FFMPEG_MIN_SLICE_HEIGHT 64
+#define SPLASH_FFMPEG_HAP_PARALLEL_FRAMES 4 // Maximum number of Hap frames decoded at once
+
 using namespace std;
 
 namespace Splash
@@ -57,7 +62,7 @@ void Image_FFmpeg::freeFFmpegObjects()
     _clockTime = -1;
 
     _continueRead = false;
-    _videoQueueCondition.notify_one();
+    _timedFrames.stop();
 
     if (_videoDisplayThread.joinable())
         _videoDisplayThread.join();
@@ -95,6 +100,9 @@ bool Image_FFmpeg::read(const string& filename)
     _filepath = filename;
 
     // Launch the loops
+    _timedFrames.reset(_queueDepth, (size_t)_queueMaxSize * 1024 * 1024);
+    _framesDropped = 0;
+    _underruns = 0;
     _continueRead = true;
     _videoDisplayThread = thread([&]() {
         videoDisplayLoop();
@@ -157,7 +165,7 @@ void Image_FFmpeg::readLoop()
 
     // Find a video decoder
     auto videoStream = (_avContext)->streams[_videoStreamIndex];
-    auto _videoCodecContext = (_avContext)->streams[_videoStreamIndex]->codec;
+    _videoCodecContext = (_avContext)->streams[_videoStreamIndex]->codec;
     auto videoCodec = avcodec_find_decoder(_videoCodecContext->codec_id);
     auto isHap = false;
 
@@ -182,6 +190,10 @@ void Image_FFmpeg::readLoop()
 
     if (videoCodec)
     {
+        // Let the decoder use frame and slice threading, as most codecs support at least one of them
+        _videoCodecContext->thread_count = _decodeThreads;
+        _videoCodecContext->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
         AVDictionary* optionsDict = nullptr;
         if (avcodec_open2(_videoCodecContext, videoCodec, &optionsDict) < 0)
         {
@@ -257,49 +269,278 @@ void Image_FFmpeg::readLoop()
 #endif
 
     // Start reading frames
-    AVFrame *frame, *rgbFrame;
+    AVFrame* frame;
 #if HAVE_FFMPEG_3
     frame = av_frame_alloc();
-    rgbFrame = av_frame_alloc();
 #else
     frame = avcodec_alloc_frame();
-    rgbFrame = avcodec_alloc_frame();
 #endif
 
-    if (!frame || !rgbFrame)
+    if (!frame)
     {
         Log::get() << Log::WARNING << "Image_FFmpeg::" << __FUNCTION__ << " - Error while allocating frame structures" << Log::endl;
         return;
     }
 
-#if HAVE_FFMPEG_3
-    int numBytes = av_image_get_buffer_size(AV_PIX_FMT_RGB24, _videoCodecContext->width, _videoCodecContext->height, 1);
+    // The conversion to RGB is split in horizontal slices, each one with its own context so that they can run in parallel
+    struct ScaleSlice
+    {
+        struct SwsContext* context {nullptr};
+        int y {0};
+        int height {0};
+    };
+    vector<ScaleSlice> scaleSlices;
+    int chromaShift = 0;
+
+    // YUV frames which the GPU knows how to convert are sent as is
+    string yuvFormat;
+    if (!isHap && _gpuYUV && _videoCodecContext->width % 2 == 0 && _videoCodecContext->height % 2 == 0)
+    {
+        if (_videoCodecContext->pix_fmt == AV_PIX_FMT_YUV420P)
+            yuvFormat = "YUV_I420";
+        else if (_videoCodecContext->pix_fmt == AV_PIX_FMT_UYVY422)
+            yuvFormat = "YUV_UYVY";
+    }
+
+    if (!isHap && yuvFormat.empty())
+    {
+        auto width = _videoCodecContext->width;
+        auto height = _videoCodecContext->height;
+
+        auto sliceCount = 1;
+        auto pixDesc = av_pix_fmt_desc_get(_videoCodecContext->pix_fmt);
+        if (pixDesc && !(pixDesc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM | AV_PIX_FMT_FLAG_HWACCEL)))
+        {
+            chromaShift = pixDesc->log2_chroma_h;
+            sliceCount = std::max(1, std::min(SPLASH_MAX_THREAD, height / SPLASH_FFMPEG_MIN_SLICE_HEIGHT));
+        }
+
+        // Slices start on a full chroma line
+        auto alignment = 1 << chromaShift;
+        auto sliceHeight = (height / sliceCount + alignment - 1) / alignment * alignment;
+        for (int y = 0; y < height; y += sliceHeight)
+        {
+            ScaleSlice slice;
+            slice.y = y;
+            slice.height = std::min(sliceHeight, height - y);
+            slice.context = sws_getContext(width, slice.height, _videoCodecContext->pix_fmt, width, slice.height, PIX_FMT_RGB24, SWS_BILINEAR, nullptr, nullptr, nullptr);
+            if (!slice.context)
+            {
+                // Slices missing would leave parts of the frames unconverted
+                for (auto& previousSlice : scaleSlices)
+                    sws_freeContext(previousSlice.context);
+                scaleSlices.clear();
+                break;
+            }
+            scaleSlices.push_back(slice);
+        }
+
+        // Fall back to a single context for the whole frame
+        if (scaleSlices.empty())
+        {
+            ScaleSlice slice;
+            slice.y = 0;
+            slice.height = height;
+            slice.context = sws_getContext(width, height, _videoCodecContext->pix_fmt, width, height, PIX_FMT_RGB24, SWS_BILINEAR, nullptr, nullptr, nullptr);
+            if (slice.context)
+                scaleSlices.push_back(slice);
+            else
+                Log::get() << Log::WARNING << "Image_FFmpeg::" << __FUNCTION__ << " - Could not create a conversion context for file " << _filepath << Log::endl;
+        }
+    }
+
+    // Frame slots keep their image from one use to another, it is only reallocated if the spec changed
+    auto reuseImage = [&](unique_ptr<ImageBuffer>& img, ImageBufferSpec& spec) {
+        if (!img || img->getSpec() != spec)
+            img = unique_ptr<ImageBuffer>(new ImageBuffer(spec));
+    };
+
+    // Copy the planes of the decoded frame to a YUV image, contiguously
+    auto copyYUVFrame = [&](unique_ptr<ImageBuffer>& img) {
+        int width = _videoCodecContext->width;
+        int height = _videoCodecContext->height;
+
+        ImageBufferSpec spec;
+        if (yuvFormat == "YUV_I420")
+            spec = ImageBufferSpec(width, height * 3 / 2, 1, ImageBufferSpec::Type::UINT8);
+        else
+            spec = ImageBufferSpec(width, height, 2, ImageBufferSpec::Type::UINT8);
+        spec.format = {yuvFormat};
+        reuseImage(img, spec);
+
+        auto pixels = reinterpret_cast<uint8_t*>(img->data());
+        auto copyPlane = [&](int plane, int lineSize, int lines) {
+            for (int y = 0; y < lines; ++y)
+                memcpy(pixels + y * lineSize, frame->data[plane] + y * frame->linesize[plane], lineSize);
+            pixels += lineSize * lines;
+        };
+
+        if (yuvFormat == "YUV_I420")
+        {
+            copyPlane(0, width, height);
+            copyPlane(1, width / 2, height / 2);
+            copyPlane(2, width / 2, height / 2);
+        }
+        else
+        {
+            copyPlane(0, width * 2, height);
+        }
+    };
+
+    // Convert the decoded frame to an RGB image
+    auto convertFrame = [&](unique_ptr<ImageBuffer>& img) -> bool {
+        if (!yuvFormat.empty())
+        {
+            copyYUVFrame(img);
+            return true;
+        }
+
+        ImageBufferSpec spec(_videoCodecContext->width, _videoCodecContext->height, 3, ImageBufferSpec::Type::UINT8);
+        spec.format = {"R", "G", "B"};
+        reuseImage(img, spec);
+
+        auto pixels = reinterpret_cast<uint8_t*>(img->data());
+        int lineSize = spec.width * 3;
+
+        auto scaleSlice = [&](const ScaleSlice& slice) {
+            const uint8_t* srcData[4];
+            for (int plane = 0; plane < 4; ++plane)
+            {
+                auto shift = (plane == 1 || plane == 2) ? chromaShift : 0;
+                srcData[plane] = frame->data[plane] ? frame->data[plane] + (slice.y >> shift) * frame->linesize[plane] : nullptr;
+            }
+            uint8_t* dstData[4] = {pixels + slice.y * lineSize, nullptr, nullptr, nullptr};
+            int dstLineSize[4] = {lineSize, 0, 0, 0};
+            sws_scale(slice.context, srcData, frame->linesize, 0, slice.height, dstData, dstLineSize);
+        };
+
+        if (scaleSlices.size() == 1)
+        {
+            scaleSlice(scaleSlices[0]);
+        }
+        else
+        {
+            TaskGroup sliceTasks;
+            for (auto& slice : scaleSlices)
+                sliceTasks.run([&]() {
+                    scaleSlice(slice);
+                });
+            sliceTasks.wait();
+        }
+
+        return true;
+    };
+
+    // With frame threading, frames come out of the decoder later than their packet
+    auto getFrameTiming = [&](const AVPacket& packet) -> uint64_t {
+        uint64_t timing;
+        auto pts = frame->best_effort_timestamp != AV_NOPTS_VALUE ? frame->best_effort_timestamp : packet.pts;
+        if (pts != AV_NOPTS_VALUE)
+            timing = static_cast<uint64_t>((double)pts * _timeBase * 1e6);
+        else
+            timing = 0.0;
+        // This handles repeated frames
+        timing += frame->repeat_pict * _timeBase * 0.5;
+        return timing;
+    };
+
+    // Fill the next free slot of the queue, waiting for the display loop to release one if needed
+    auto queueFrame = [&](const function<bool(unique_ptr<ImageBuffer>&)>& fillImage, uint64_t timing) {
+        auto timedFrame = _timedFrames.acquire();
+        if (!timedFrame || !fillImage(timedFrame->frame))
+            return;
+
+        timedFrame->timing = timing;
+        timedFrame->seekIndex = _seekIndex;
+        stampFrame(*timedFrame->frame, Timer::getTime());
+        _timedFrames.publish(timedFrame->frame->getSpec().rawSize());
+    };
+
+    // Send a packet to the decoder, and queue all the frames it outputs
+    // An empty packet flushes the frames still held by the decoder
+    auto decodeVideo = [&](AVPacket& packet) {
+        if (scaleSlices.empty() && yuvFormat.empty())
+            return;
+#if SPLASH_FFMPEG_SEND_RECEIVE
+        if (avcodec_send_packet(_videoCodecContext, packet.data ? &packet : nullptr) < 0)
+            return;
+        while (avcodec_receive_frame(_videoCodecContext, frame) == 0)
+            queueFrame(convertFrame, getFrameTiming(packet));
 #else
-    int numBytes = avpicture_get_size(PIX_FMT_RGB24, _videoCodecContext->width, _videoCodecContext->height);
+        int frameFinished;
+        do
+        {
+            frameFinished = 0;
+            avcodec_decode_video2(_videoCodecContext, frame, &frameFinished, &packet);
+            if (frameFinished)
+                queueFrame(convertFrame, getFrameTiming(packet));
+        } while (frameFinished && !packet.data);
 #endif
-    vector<unsigned char> buffer(numBytes);
+    };
 
-    struct SwsContext* swsContext;
-    if (!isHap)
+    // Hap frames are decoded in parallel on the thread pool, each one in its own slot of the queue,
+    // in addition to the chunks of each frame being decoded in parallel
+    struct HapJob
     {
+        AVPacket packet;
+        TimedFrame* timedFrame {nullptr};
+        uint64_t timing {0};
+        uint32_t seekIndex {0};
+        std::atomic_bool success {false};
+        unsigned int taskId {0};
+    };
+    deque<shared_ptr<HapJob>> hapJobs;
+    size_t maxHapJobs = std::max(1, std::min(SPLASH_FFMPEG_HAP_PARALLEL_FRAMES, _queueDepth - 1));
+
+    // Wait for the oldest Hap frame to be decoded, and queue it
+    // Frames which could not be decoded are still queued, with a null timing so that they are not shown
+    auto finishHapJob = [&]() {
+        auto job = hapJobs.front();
+        hapJobs.pop_front();
+
+        vector<unsigned int> threadIds {job->taskId};
+        SThread::pool.waitThreads(threadIds);
 #if HAVE_FFMPEG_3
-        swsContext = sws_getContext(_videoCodecContext->width, _videoCodecContext->height, _videoCodecContext->pix_fmt, _videoCodecContext->width, _videoCodecContext->height,
-                                    AV_PIX_FMT_RGB24, SWS_BILINEAR, nullptr, nullptr, nullptr);
-        
-        av_image_fill_arrays(rgbFrame->data,
-                             rgbFrame->linesize,
-                             buffer.data(), 
-                             AV_PIX_FMT_RGB24, 
-                             _videoCodecContext->width, 
-                             _videoCodecContext->height,
-                             1);
+        av_packet_unref(&job->packet);
 #else
-        swsContext = sws_getContext(_videoCodecContext->width, _videoCodecContext->height, _videoCodecContext->pix_fmt, _videoCodecContext->width, _videoCodecContext->height,
-                                    PIX_FMT_RGB24, SWS_BILINEAR, nullptr, nullptr, nullptr);
-    
-        avpicture_fill((AVPicture*)rgbFrame, buffer.data(), PIX_FMT_RGB24, _videoCodecContext->width, _videoCodecContext->height);
+        av_free_packet(&job->packet);
 #endif
-    }
+
+        job->timedFrame->timing = job->success ? job->timing : 0;
+        job->timedFrame->seekIndex = job->seekIndex;
+        stampFrame(*job->timedFrame->frame, Timer::getTime());
+        _timedFrames.publish(job->success ? job->timedFrame->frame->getSpec().rawSize() : 0);
+    };
+
+    auto decodeHap = [&](AVPacket& packet, ImageBufferSpec& spec, const string& textureFormat, uint64_t timing) {
+        if (hapJobs.size() >= maxHapJobs)
+            finishHapJob();
+
+        auto timedFrame = _timedFrames.acquire(hapJobs.size());
+        if (!timedFrame)
+            return;
+        reuseImage(timedFrame->frame, spec);
+
+        auto job = make_shared<HapJob>();
+        av_init_packet(&job->packet);
+#if HAVE_FFMPEG_3
+        if (av_packet_ref(&job->packet, &packet) < 0)
+#else
+        if (av_copy_packet(&job->packet, &packet) < 0)
+#endif
+            return;
+        job->timedFrame = timedFrame;
+        job->timing = timing;
+        job->seekIndex = _seekIndex;
+
+        auto output = timedFrame->frame->data();
+        unsigned long outputBufferBytes = spec.width * spec.height * spec.channels;
+        job->taskId = SThread::pool.enqueue([=]() {
+            string format;
+            job->success = hapDecodeFrame(job->packet.data, job->packet.size, output, outputBufferBytes, format) && format == textureFormat;
+        });
+        hapJobs.push_back(job);
+    };
 
     AVPacket packet;
     av_init_packet(&packet);
@@ -322,37 +563,11 @@ void Image_FFmpeg::readLoop()
             // Reading the video
             if (packet.stream_index == _videoStreamIndex && _videoSeekMutex.try_lock())
             {
-                auto img = unique_ptr<ImageBuffer>();
-                uint64_t timing;
-                bool hasFrame = false;
-
                 //
                 // If the codec is handled by FFmpeg
                 if (!isHap)
                 {
-                    int frameFinished;
-                    avcodec_decode_video2(_videoCodecContext, frame, &frameFinished, &packet);
-
-                    if (frameFinished)
-                    {
-                        sws_scale(swsContext, (const uint8_t* const*)frame->data, frame->linesize, 0, _videoCodecContext->height, rgbFrame->data, rgbFrame->linesize);
-
-                        ImageBufferSpec spec(_videoCodecContext->width, _videoCodecContext->height, 3, ImageBufferSpec::Type::UINT8);
-                        spec.format = {"R", "G", "B"};
-                        img.reset(new ImageBuffer(spec));
-
-                        unsigned char* pixels = reinterpret_cast<unsigned char*>(img->data());
-                        copy(buffer.begin(), buffer.end(), pixels);
-
-                        if (packet.pts != AV_NOPTS_VALUE)
-                            timing = static_cast<uint64_t>((double)packet.pts * _timeBase * 1e6);
-                        else
-                            timing = 0.0;
-                        // This handles repeated frames
-                        timing += frame->repeat_pict * _timeBase * 0.5;
-
-                        hasFrame = true;
-                    }
+                    decodeVideo(packet);
                 }
                 //
                 // If the codec is marked as Hap / Hap alpha / Hap Q
@@ -371,18 +586,21 @@ void Image_FFmpeg::readLoop()
                             spec = ImageBufferSpec(_videoCodecContext->width, (int)(ceil((float)_videoCodecContext->height / 2.f)), 1, ImageBufferSpec::Type::UINT8);
                             spec.format = {textureFormat};
                         }
-                        if (textureFormat == "RGBA_DXT5")
+                        else if (textureFormat == "RGBA_DXT5")
                         {
                             spec = ImageBufferSpec(_videoCodecContext->width, _videoCodecContext->height, 1, ImageBufferSpec::Type::UINT8);
                             spec.format = {textureFormat};
                         }
-                        if (textureFormat == "YCoCg_DXT5")
+                        else if (textureFormat == "YCoCg_DXT5")
                         {
                             spec = ImageBufferSpec(_videoCodecContext->width, _videoCodecContext->height, 1, ImageBufferSpec::Type::UINT8);
                             spec.format = {textureFormat};
                         }
                         else
                         {
+                            while (!hapJobs.empty())
+                                finishHapJob();
+                            _videoSeekMutex.unlock();
 #if HAVE_FFMPEG_3
                             av_packet_unref(&packet);
 #else
@@ -392,47 +610,23 @@ void Image_FFmpeg::readLoop()
                         }
 
                         spec.format = {textureFormat};
-                        img.reset(new ImageBuffer(spec));
 
-                        unsigned long outputBufferBytes = spec.width * spec.height * spec.channels;
-
-                        if (hapDecodeFrame(packet.data, packet.size, img->data(), outputBufferBytes, textureFormat))
-                        {
-                            if (packet.pts != AV_NOPTS_VALUE)
-                                timing = static_cast<uint64_t>((double)packet.pts * _timeBase * 1e6);
-                            else
-                                timing = 0.0;
+                        uint64_t timing;
+                        if (packet.pts != AV_NOPTS_VALUE)
+                            timing = static_cast<uint64_t>((double)packet.pts * _timeBase * 1e6);
+                        else
+                            timing = 0.0;
 
-                            hasFrame = true;
-                        }
+                        decodeHap(packet, spec, textureFormat, timing);
                     }
                 }
 
-                if (hasFrame)
-                {
-                    lock_guard<mutex> lockFrames(_videoQueueMutex);
-                    _timedFrames.emplace_back();
-                    std::swap(_timedFrames[_timedFrames.size() - 1].frame, img);
-                    _timedFrames[_timedFrames.size() - 1].timing = timing;
-                }
-
-                int timedFramesBuffered = _timedFrames.size();
-
                 _videoSeekMutex.unlock();
 #if HAVE_FFMPEG_3
                 av_packet_unref(&packet);
 #else
                 av_free_packet(&packet);
 #endif
-
-                // Do not store more than a few frames in memory
-                while (timedFramesBuffered > 30 && _continueRead)
-                {
-                    this_thread::sleep_for(chrono::milliseconds(5));
-                    lock_guard<mutex> lockSeek(_videoSeekMutex);
-                    lock_guard<mutex> lockQueue(_videoQueueMutex);
-                    timedFramesBuffered = _timedFrames.size();
-                }
             }
 #if HAVE_PORTAUDIO
             // Reading the audio
@@ -468,20 +662,39 @@ void Image_FFmpeg::readLoop()
             }
         }
 
+        // Get the frames still held by the decoder threads
+        while (!hapJobs.empty())
+            finishHapJob();
+
+        if (!isHap && _continueRead)
+        {
+            AVPacket flushPacket;
+            av_init_packet(&flushPacket);
+            flushPacket.data = nullptr;
+            flushPacket.size = 0;
+
+            {
+                lock_guard<mutex> lockSeek(_videoSeekMutex);
+                decodeVideo(flushPacket);
+            }
+        }
+
         seek(0); // Go back to the beginning of the file
 
     } while (_loopOnVideo && _continueRead);
 
 #if HAVE_FFMPEG_3
-    av_frame_free(&rgbFrame);
     av_frame_free(&frame);
 #else
-    av_free(rgbFrame);
     av_free(frame);
 #endif
 
+    for (auto& slice : scaleSlices)
+        sws_freeContext(slice.context);
+
     if (!isHap)
         avcodec_close(_videoCodecContext);
+    _videoCodecContext = nullptr;
     _videoStreamIndex = -1;
 
 #if HAVE_PORTAUDIO
@@ -497,6 +710,9 @@ void Image_FFmpeg::readLoop()
 /*************/
 void Image_FFmpeg::seek(float seconds)
 {
+    // Until the seek is done, the display loop drops the frames from the queue,
+    // which also unblocks the decoder if it is waiting for a free slot
+    _seeking++;
     lock_guard<mutex> lock(_videoSeekMutex);
 
     int seekFlag = 0;
@@ -511,129 +727,170 @@ void Image_FFmpeg::seek(float seconds)
         seconds = duration;
 
     int frame = static_cast<int>(floor(seconds / _timeBase));
+
+    // Drop the frames still being decoded, and get the decoder out of draining mode after the end of the file
+    if (_videoCodecContext && _videoCodecContext->codec)
+        avcodec_flush_buffers(_videoCodecContext);
+
     if (avformat_seek_file(_avContext, _videoStreamIndex, 0, frame, frame, seekFlag) < 0)
     {
         Log::get() << Log::WARNING << "Image_FFmpeg::" << __FUNCTION__ << " - Could not seek to timestamp " << seconds << Log::endl;
     }
     else
     {
-        lock_guard<mutex> lockQueue(_videoQueueMutex);
         // As seeking will no necessarily go to the desired timestamp, but to the closest i-frame,
         // we will set _startTime at the next frame in the videoDisplayLoop
+        _seekIndex++;
         _startTime = -1;
-        _timedFrames.clear();
 #if HAVE_PORTAUDIO
         if (_speaker)
             _speaker->clearQueue();
 #endif
     }
+
+    _seeking--;
 }
 
 /*************/
 void Image_FFmpeg::videoDisplayLoop()
 {
-    auto previousTime = 0;
+    bool frameShown = false; // Whether a frame has been shown since the file was opened, or since the last seek
+    bool starving = false; // Whether the queue got empty while a frame was expected
 
     while(_continueRead)
     {
-        auto localQueue = deque<TimedFrame>();
+        auto timedFrame = _timedFrames.front(chrono::milliseconds(10));
+        if (!timedFrame)
         {
-            lock_guard<mutex> lockFrames(_videoQueueMutex);
-            std::swap(localQueue, _timedFrames);
+            if (frameShown && !_paused && _startTime != -1)
+                starving = true;
+            continue;
         }
 
-        // This sets the start time after a seek
-        if (localQueue.size() > 0 && _startTime == -1)
-            _startTime = Timer::getTime() - localQueue[0].timing;
+        // Frames decoded before a seek should not be shown
+        if (_seeking > 0 || timedFrame->seekIndex != _seekIndex)
+        {
+            _timedFrames.pop();
+            continue;
+        }
 
-        while (localQueue.size() > 0 && _continueRead)
+        // This sets the start time after a seek
+        if (_startTime == -1)
         {
-            // If seek, clear the local queue as the frames should not be shown
-            if (_startTime == -1)
-            {
-                localQueue.clear();
-                continue;
-            }
+            _startTime = Timer::getTime() - timedFrame->timing;
+            frameShown = false;
+            starving = false;
+        }
 
-            //
-            // Get the current master and local clocks
-            //
-            _currentTime = Timer::getTime() - _startTime;
+        //
+        // Get the current master and local clocks
+        //
+        _currentTime = Timer::getTime() - _startTime;
 
-            float seekTiming = _intraOnly ? 1.f : 3.f; // Maximum diff for seek to happen when synced to a master clock
+        float seekTiming = _intraOnly ? 1.f : 3.f; // Maximum diff for seek to happen when synced to a master clock
 
-            int64_t clockAsMs;
-            bool clockIsPaused {false};
-            if (_useClock && Timer::get().getMasterClock<chrono::milliseconds>(clockAsMs, clockIsPaused))
+        int64_t clockAsMs;
+        bool clockIsPaused {false};
+        if (_useClock && Timer::get().getMasterClock<chrono::milliseconds>(clockAsMs, clockIsPaused))
+        {
+            float seconds = (float)clockAsMs / 1e3f + _shiftTime;
+            _clockTime = seconds * 1e6;
+        }
+
+        //
+        // Show the frame at the right timing, according to clocks
+        //
+        if (timedFrame->timing != 0ull)
+        {
+            // When paused, the first frame is still shown so that a paused video
+            // (for example a Queue source opened ahead of time) is ready to be displayed
+            bool paused = _paused || (clockIsPaused && _useClock);
+            if (paused && frameShown)
             {
-                float seconds = (float)clockAsMs / 1e3f + _shiftTime;
-                _clockTime = seconds * 1e6;
+                _startTime = Timer::getTime() - _currentTime;
+                this_thread::sleep_for(chrono::milliseconds(2));
+                continue;
             }
-
-            //
-            // Show the frame at the right timing, according to clocks
-            //
-            TimedFrame& timedFrame = localQueue[0];
-            if (timedFrame.timing != 0ull)
+            else if (!paused && _useClock && _clockTime != -1l)
             {
-                if (_paused || (clockIsPaused && _useClock))
+                auto delta = abs(_currentTime - _clockTime);
+                // If the difference between master clock and local clock is greater than 1.5 frames @30Hz, we adjust local clock
+                if (delta > 50000)
                 {
-                    _startTime = Timer::getTime() - _currentTime;
-                    this_thread::sleep_for(chrono::milliseconds(2));
-                    continue;
+                    _startTime = Timer::getTime() - _clockTime;
+                    _currentTime = _clockTime;
                 }
-                else if (_useClock && _clockTime != -1l)
+            }
+
+            // Compute the difference between next frame and the current clock
+            int64_t waitTime = timedFrame->timing - _currentTime;
+
+            // If the gap is too big, we seek through the video
+            if (abs(waitTime / 1e6) > seekTiming)
+            {
+                if (!_timeJump) // We do not want more than one jump at a time...
                 {
-                    auto delta = abs(_currentTime - _clockTime);
-                    // If the difference between master clock and local clock is greater than 1.5 frames @30Hz, we adjust local clock
-                    if (delta > 50000)
-                    {
-                        _startTime = Timer::getTime() - _clockTime;
-                        _currentTime = _clockTime;
-                    }
+                    _timeJump = true;
+                    _elapsedTime = _currentTime / 1e6;
+                    SThread::pool.enqueueWithoutId([=]() {
+                        seek(_elapsedTime);
+                        _timeJump = false;
+                    });
                 }
+                _timedFrames.pop();
+                continue;
+            }
 
-                // Compute the difference between next frame and the current clock
-                int64_t waitTime = timedFrame.timing - _currentTime;
+            if (waitTime < 0)
+            {
+                // The queue got empty and this frame arrived too late
+                if (starving)
+                    _underruns++;
 
-                // If the gap is too big, we seek through the video
-                if (abs(waitTime / 1e6) > seekTiming)
+                // Skip this frame if the next one is already due
+                auto nextFrame = _timedFrames.second();
+                if (frameShown && !paused && nextFrame && nextFrame->seekIndex == timedFrame->seekIndex && (int64_t)nextFrame->timing <= _currentTime)
                 {
-                    if (!_timeJump) // We do not want more than one jump at a time...
-                    {
-                        _timeJump = true;
-                        _elapsedTime = _currentTime / 1e6;
-                        localQueue.clear();
-                        SThread::pool.enqueueWithoutId([=]() {
-                            seek(_elapsedTime);
-                            _timeJump = false;
-                        });
-                    }
+                    _framesDropped++;
+                    _timedFrames.pop();
+                    starving = false;
                     continue;
                 }
-
-                // Otherwise, wait for the right time to display the frame
-                if (waitTime > 2e3) // we don't wait if the frame is due for the next few ms
-                    this_thread::sleep_for(chrono::microseconds(waitTime));
-
-                _elapsedTime = timedFrame.timing;
-
-                lock_guard<mutex> lock(_writeMutex);
-                if (!_bufferImage)
-                    _bufferImage = unique_ptr<ImageBuffer>(new ImageBuffer());
-                std::swap(_bufferImage, timedFrame.frame);
-                _imageUpdated = true;
-                updateTimestamp();
             }
-
-            localQueue.pop_front();
+            starving = false;
+
+            // Otherwise, wait for the right time to display the frame
+            if (waitTime > 2e3) // we don't wait if the frame is due for the next few ms
+                this_thread::sleep_for(chrono::microseconds(waitTime));
+
+            _elapsedTime = timedFrame->timing;
+
+            // The previous frame goes back to the queue, to be reused by the decoder
+            lock_guard<mutex> lock(_writeMutex);
+            if (!_bufferImage)
+                _bufferImage = unique_ptr<ImageBuffer>(new ImageBuffer());
+            std::swap(_bufferImage, timedFrame->frame);
+            _imageUpdated = true;
+            frameShown = true;
+            updateTimestamp();
         }
+
+        _timedFrames.pop();
     }
 }
 
 /*************/
 void Image_FFmpeg::registerAttributes()
 {
+    addAttribute("decodeThreads", [&](const Values& args) {
+        _decodeThreads = std::max(0, args[0].asInt());
+        return true;
+    }, [&]() -> Values {
+        return {_decodeThreads};
+    }, {'n'});
+    setAttributeParameter("decodeThreads", true, true);
+    setAttributeDescription("decodeThreads", "Number of threads used to decode the video, 0 to let FFmpeg choose. Applied when the file is (re)loaded");
+
     addAttribute("duration", [&](const Values& args) {
         return false;
     }, [&]() -> Values {
@@ -645,6 +902,14 @@ void Image_FFmpeg::registerAttributes()
     });
     setAttributeParameter("duration", false, true);
 
+    addAttribute("framesDropped", [&](const Values& args) {
+        return false;
+    }, [&]() -> Values {
+        return {(int64_t)_framesDropped};
+    });
+    setAttributeParameter("framesDropped", false, true);
+    setAttributeDescription("framesDropped", "Number of frames skipped since the file was opened, as they were decoded too late");
+
     addAttribute("loop", [&](const Values& args) {
         _loopOnVideo = (bool)args[0].asInt();
         return true;
@@ -654,6 +919,24 @@ void Image_FFmpeg::registerAttributes()
     }, {'n'});
     setAttributeParameter("loop", true, true);
 
+    addAttribute("queueDepth", [&](const Values& args) {
+        _queueDepth = std::max(2, args[0].asInt());
+        return true;
+    }, [&]() -> Values {
+        return {_queueDepth};
+    }, {'n'});
+    setAttributeParameter("queueDepth", true, true);
+    setAttributeDescription("queueDepth", "Maximum number of frames decoded ahead of display. Applied when the file is (re)loaded");
+
+    addAttribute("queueMaxSize", [&](const Values& args) {
+        _queueMaxSize = std::max(0, args[0].asInt());
+        return true;
+    }, [&]() -> Values {
+        return {_queueMaxSize};
+    }, {'n'});
+    setAttributeParameter("queueMaxSize", true, true);
+    setAttributeDescription("queueMaxSize", "Maximum size in MB of the frames decoded ahead of display, 0 for no limit. Applied when the file is (re)loaded");
+
     addAttribute("remaining", [&](const Values& args) {
         return false;
     }, [&]() -> Values {
@@ -687,6 +970,14 @@ void Image_FFmpeg::registerAttributes()
     setAttributeParameter("seek", false, true);
     setAttributeDescription("seek", "Change the read position in the video file");
 
+    addAttribute("underruns", [&](const Values& args) {
+        return false;
+    }, [&]() -> Values {
+        return {(int64_t)_underruns};
+    });
+    setAttributeParameter("underruns", false, true);
+    setAttributeDescription("underruns", "Number of frames displayed late since the file was opened, as no decoded frame was available");
+
     addAttribute("useClock", [&](const Values& args) {
         _useClock = args[0].asInt();
         if (!_useClock)
@@ -412,7 +412,7 @@ void Image_GPhoto::registerAttributes()
 
     // Actions
     addAttribute("capture", [&](const Values& args) {
-        SThread::pool.enqueue([&]() {
+        SThread::pool.enqueueWithoutId([&]() {
             capture();
         });
         return true;
@@ -420,7 +420,7 @@ void Image_GPhoto::registerAttributes()
     setAttributeDescription("capture", "Ask for the camera to shoot");
 
     addAttribute("detect", [&](const Values& args) {
-        SThread::pool.enqueue([&]() {
+        SThread::pool.enqueueWithoutId([&]() {
             detectCameras();
         });
         return true;
@@ -122,6 +122,7 @@ void Image_OpenCV::readLoop()
             Log::get() << Log::WARNING << "Image_OpenCV::" << __FUNCTION__ << " - An error occurred while reading the VideoCapture" << Log::endl;
             return;
         }
+        auto captureTime = Timer::getTime();
 
         auto spec = _readBuffer.getSpec();
         if (spec.width != capture.rows || spec.height != capture.cols || spec.channels != capture.channels())
@@ -138,6 +139,7 @@ void Image_OpenCV::readLoop()
         lock_guard<mutex> lockWrite(_writeMutex);
         if (!_bufferImage)
             _bufferImage = unique_ptr<ImageBuffer>(new ImageBuffer());
+        stampFrame(_readBuffer, captureTime);
         std::swap(*_bufferImage, _readBuffer);
         _imageUpdated = true;
         updateTimestamp();
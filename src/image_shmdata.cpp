@@ -3,19 +3,10 @@
 #include <regex>
 #include <hap.h>
 
-#ifdef HAVE_SSE2
-    #define GLM_FORCE_SSE2
-    #define GLM_FORCE_INLINE
-    #include <glm/glm.hpp>
-    #include <glm/gtx/simd_vec4.hpp>
-#else
-    #define GLM_FORCE_INLINE
-    #include <glm/glm.hpp>
-#endif
-
 #include "cgUtils.h"
 #include "log.h"
 #include "osUtils.h"
+#include "pixelConversion.h"
 #include "timer.h"
 #include "threadpool.h"
 
@@ -262,6 +253,7 @@ void Image_Shmdata::onCaps(const string& dataType, void* user_data)
 void Image_Shmdata::onData(void* data, int data_size, void* user_data)
 {
     Image_Shmdata* ctx = reinterpret_cast<Image_Shmdata*>(user_data);
+    ctx->_frameArrival = Timer::getTime();
 
     if (Timer::get().isDebug())
     {
@@ -322,6 +314,7 @@ void Image_Shmdata::readHapFrame(Image_Shmdata* ctx, void* data, int data_size)
     
     if (!ctx->_bufferImage)
         ctx->_bufferImage = unique_ptr<ImageBuffer>(new ImageBuffer());
+    ctx->stampFrame(ctx->_readerBuffer, ctx->_frameArrival);
     std::swap(*(ctx->_bufferImage), ctx->_readerBuffer);
     ctx->_imageUpdated = true;
     ctx->updateTimestamp();
@@ -332,244 +325,66 @@ void Image_Shmdata::readUncompressedFrame(Image_Shmdata* ctx, void* data, int da
 {
     lock_guard<mutex> lock(ctx->_writeMutex);
 
-    // Check if we need to resize the reader buffer
-    auto bufSpec = ctx->_readerBuffer.getSpec();
-    if (bufSpec.width != ctx->_width || bufSpec.height != ctx->_height || bufSpec.channels != ctx->_channels)
+    // YUV frames are sent as is if the GPU can convert them
+    bool keepYUV = ctx->_isYUV && ctx->_gpuYUV && ctx->_width % 2 == 0 && ctx->_height % 2 == 0;
+
+    ImageBufferSpec spec;
+    if (keepYUV && ctx->_is420)
+    {
+        spec = ImageBufferSpec(ctx->_width, ctx->_height * 3 / 2, 1, ImageBufferSpec::Type::UINT8);
+        spec.format = {"YUV_I420"};
+    }
+    else if (keepYUV && ctx->_is422)
+    {
+        spec = ImageBufferSpec(ctx->_width, ctx->_height, 2, ImageBufferSpec::Type::UINT8);
+        spec.format = {"YUV_UYVY"};
+    }
+    else
     {
-        ImageBufferSpec spec(ctx->_width, ctx->_height, ctx->_channels, ImageBufferSpec::Type::UINT8);
+        spec = ImageBufferSpec(ctx->_width, ctx->_height, ctx->_channels, ImageBufferSpec::Type::UINT8);
         if (ctx->_green < ctx->_blue)
             spec.format = {"B", "G", "R"};
         else
             spec.format = {"R", "G", "B"};
         if (ctx->_channels == 4)
             spec.format.push_back("A");
+    }
 
+    // Check if we need to resize the reader buffer
+    if (ctx->_readerBuffer.getSpec() != spec)
         ctx->_readerBuffer = ImageBuffer(spec);
-    }
 
-    if (!ctx->_isYUV && (ctx->_channels == 3 || ctx->_channels == 4))
-    {
-        char* pixels = (char*)(ctx->_readerBuffer).data();
-        vector<unsigned int> threadIds;
-        for (int block = 0; block < SPLASH_SHMDATA_THREADS; ++block)
-        {
-            int size = ctx->_width * ctx->_height * ctx->_channels * sizeof(char);
-            threadIds.push_back(SThread::pool.enqueue([=, &ctx]() {
-                int sizeOfBlock; // We compute the size of the block, to handle image size non divisible by SPLASH_SHMDATA_THREADS
-                if (size - size / SPLASH_SHMDATA_THREADS * block < 2 * size / SPLASH_SHMDATA_THREADS)
-                    sizeOfBlock = size - size / SPLASH_SHMDATA_THREADS * block;
-                else
-                    sizeOfBlock = size / SPLASH_SHMDATA_THREADS;
-                    
-                memcpy(pixels + size / SPLASH_SHMDATA_THREADS * block, (const char*)data + size / SPLASH_SHMDATA_THREADS * block, sizeOfBlock);
-            }));
-        }
-        SThread::pool.waitThreads(threadIds);
-    }
-    else if (ctx->_is420)
+    if (keepYUV || (!ctx->_isYUV && (ctx->_channels == 3 || ctx->_channels == 4)))
     {
-        const unsigned char* Y = (const unsigned char*)data;
-        const unsigned char* U = (const unsigned char*)data + ctx->_width * ctx->_height;
-        const unsigned char* V = (const unsigned char*)data + ctx->_width * ctx->_height * 5 / 4;
+        if (data_size < spec.rawSize())
+            return;
 
         char* pixels = (char*)(ctx->_readerBuffer).data();
-        vector<unsigned int> threadIds;
-#ifdef HAVE_SSE2
-        for (int block = 0; block < SPLASH_SHMDATA_THREADS; ++block)
-        {
-            int width = ctx->_width;
-            int height = ctx->_height;
-
-            threadIds.push_back(SThread::pool.enqueue([=, &ctx]() {
-                int lastLine; // We compute the last line, to handle image size non divisible by SPLASH_SHMDATA_THREADS
-                if (ctx->_height - ctx->_height / SPLASH_SHMDATA_THREADS * (block + 1) < ctx->_height / SPLASH_SHMDATA_THREADS)
-                    lastLine = ctx->_height;
-                else
-                    lastLine = ctx->_height / SPLASH_SHMDATA_THREADS * (block + 1);
-
-                auto uLine = vector<unsigned char>(width / 2);
-                auto vLine = vector<unsigned char>(width / 2);
-                auto yLine = vector<unsigned char>(width);
-                auto localPixels = vector<unsigned char>(width * 3);
-                for (int y = height / SPLASH_SHMDATA_THREADS * block; y < lastLine; ++y)
-                {
-                    memcpy(uLine.data(), &U[(y / 2) * (width / 2)], width / 2 * sizeof(unsigned char));
-                    memcpy(vLine.data(), &V[(y / 2) * (width / 2)], width / 2 * sizeof(unsigned char));
-                    memcpy(yLine.data(), &Y[y * width], width * sizeof(unsigned char));
-
-                    for (int x = 0; x < width; x += 4)
-                    {
-                        const unsigned char* uPtr = &uLine[x / 2];
-                        const unsigned char* vPtr = &vLine[x / 2];
-                        const unsigned char* yPtr = &yLine[x];
-
-                        auto uValue = glm::detail::fvec4SIMD((float)uPtr[0], (float)uPtr[0], (float)uPtr[1], (float)uPtr[1]);
-                        auto vValue = glm::detail::fvec4SIMD((float)vPtr[0], (float)vPtr[0], (float)vPtr[1], (float)vPtr[1]);
-                        auto yValue = glm::detail::fvec4SIMD((float)yPtr[0], (float)yPtr[1], (float)yPtr[2], (float)yPtr[3]);
-
-                        uValue = uValue - 128.0;
-                        vValue = vValue - 128.0;
-
-                        yValue = (yValue - 16.0) * 38142.0;
-                        auto rPart = glm::clamp((yValue + vValue * 52289) / 32768.0, 0.0, 255.0);
-                        auto gPart = glm::clamp((yValue + uValue * -12846 - vValue * 36641) / 32768.0, 0.0, 255.0);
-                        auto bPart = glm::clamp((yValue + uValue * 66094) / 32768.0, 0.0, 255.0);
-
-                        auto rPixel = glm::vec4_cast(rPart);
-                        auto gPixel = glm::vec4_cast(gPart);
-                        auto bPixel = glm::vec4_cast(bPart);
-
-                        for (int i = 0; i < 4; ++i)
-                        {
-                            localPixels[(x + i) * 3] = (unsigned char)rPixel[i];
-                            localPixels[(x + i) * 3 + 1] = (unsigned char)gPixel[i];
-                            localPixels[(x + i) * 3 + 2] = (unsigned char)bPixel[i];
-                        }
-                    }
-
-                    memcpy(&pixels[y * width * 3], localPixels.data(), width * 3 * sizeof(unsigned char));
-                }
-            }));
-        }
-#else
-        for (int block = 0; block < SPLASH_SHMDATA_THREADS; ++block)
-        {
-            threadIds.push_back(SThread::pool.enqueue([=, &ctx]() {
-                int lastLine; // We compute the last line, to handle image size non divisible by SPLASH_SHMDATA_THREADS
-                if (ctx->_height - ctx->_height / SPLASH_SHMDATA_THREADS * (block + 1) < ctx->_height / SPLASH_SHMDATA_THREADS)
-                    lastLine = ctx->_height;
-                else
-                    lastLine = ctx->_height / SPLASH_SHMDATA_THREADS * (block + 1);
-
-                for (int y = ctx->_height / SPLASH_SHMDATA_THREADS * block; y < lastLine; y++)
-                    for (int x = 0; x < ctx->_width; x+=2)
-                    {
-                        int uValue = (int)(U[(y / 2) * (ctx->_width / 2) + x / 2]) - 128;
-                        int vValue = (int)(V[(y / 2) * (ctx->_width / 2) + x / 2]) - 128;
-
-                        int rPart = 52298 * vValue;
-                        int gPart = -12846 * uValue - 36641 * vValue;
-                        int bPart = 66094 * uValue;
-                       
-                        int col = x;
-                        int row = y;
-                        int yValue = (int)(Y[row * ctx->_width + col] - 16) * 38142;
-                        pixels[(row * ctx->_width + col) * 3] = (unsigned char)clamp((yValue + rPart) / 32768, 0, 255);
-                        pixels[(row * ctx->_width + col) * 3 + 1] = (unsigned char)clamp((yValue + gPart) / 32768, 0, 255);
-                        pixels[(row * ctx->_width + col) * 3 + 2] = (unsigned char)clamp((yValue + bPart) / 32768, 0, 255);
-
-                        col++;
-                        yValue = (int)(Y[row * ctx->_width + col] - 16) * 38142;
-                        pixels[(row * ctx->_width + col) * 3] = (unsigned char)clamp((yValue + rPart) / 32768, 0, 255);
-                        pixels[(row * ctx->_width + col) * 3 + 1] = (unsigned char)clamp((yValue + gPart) / 32768, 0, 255);
-                        pixels[(row * ctx->_width + col) * 3 + 2] = (unsigned char)clamp((yValue + bPart) / 32768, 0, 255);
-                    }
-            }));
-        }
-#endif
-        SThread::pool.waitThreads(threadIds);
+        SThread::pool.parallelFor(spec.rawSize(), SPLASH_SHMDATA_THREADS, [&](size_t begin, size_t end) {
+            memcpy(pixels + begin, (const char*)data + begin, end - begin);
+        });
     }
-    else if (ctx->_is422)
+    else if (ctx->_is420 || ctx->_is422)
     {
-        const unsigned char* YUV = (const unsigned char*)data;
-
-        char* pixels = (char*)(ctx->_readerBuffer).data();
-        vector<unsigned int> threadIds;
-#ifdef HAVE_SSE2
-        for (int block = 0; block < SPLASH_SHMDATA_THREADS; ++block)
-        {
-            int width = ctx->_width;
-            int height = ctx->_height;
-
-            threadIds.push_back(SThread::pool.enqueue([=, &ctx]() {
-                int lastLine; // We compute the last line, to handle image size non divisible by SPLASH_SHMDATA_THREADS
-                if (ctx->_height - ctx->_height / SPLASH_SHMDATA_THREADS * (block + 1) < ctx->_height / SPLASH_SHMDATA_THREADS)
-                    lastLine = ctx->_height;
-                else
-                    lastLine = ctx->_height / SPLASH_SHMDATA_THREADS * (block + 1);
-
-                auto line = vector<unsigned char>(width * 2);
-                auto localPixels = vector<unsigned char>(width * 3);
-
-                for (int y = height / SPLASH_SHMDATA_THREADS * block; y < lastLine; ++y)
-                {
-                    memcpy(line.data(), &YUV[y * width * 2], width * 2 * sizeof(unsigned char));
-
-                    for (int x = 0; x < width; x += 4)
-                    {
-                        const unsigned char* block = &line[x * 2];
-
-                        auto uValue = glm::detail::fvec4SIMD((float)block[0], (float)block[0], (float)block[4], (float)block[4]);
-                        auto vValue = glm::detail::fvec4SIMD((float)block[2], (float)block[2], (float)block[6], (float)block[6]);
-                        auto yValue = glm::detail::fvec4SIMD((float)block[1], (float)block[3], (float)block[5], (float)block[7]);
-
-                        uValue = uValue - 128.0;
-                        vValue = vValue - 128.0;
-
-                        yValue = (yValue - 16.0) * 38142.0;
-                        auto rPart = glm::clamp((yValue + vValue * 52289) / 32768.0, 0.0, 255.0);
-                        auto gPart = glm::clamp((yValue + uValue * -12846 - vValue * 36641) / 32768.0, 0.0, 255.0);
-                        auto bPart = glm::clamp((yValue + uValue * 66094) / 32768.0, 0.0, 255.0);
-
-                        auto rPixel = glm::vec4_cast(rPart);
-                        auto gPixel = glm::vec4_cast(gPart);
-                        auto bPixel = glm::vec4_cast(bPart);
-
-                        for (int i = 0; i < 4; ++i)
-                        {
-                            localPixels[(x + i) * 3] = (unsigned char)rPixel[i];
-                            localPixels[(x + i) * 3 + 1] = (unsigned char)gPixel[i];
-                            localPixels[(x + i) * 3 + 2] = (unsigned char)bPixel[i];
-                        }
-                    }
-
-                    memcpy(&pixels[y * width * 3], localPixels.data(), width * 3 * sizeof(unsigned char));
-                }
-            }));
-        }
-#else
-        for (int block = 0; block < SPLASH_SHMDATA_THREADS; ++block)
-        {
-            threadIds.push_back(SThread::pool.enqueue([=, &ctx]() {
-                int lastLine; // We compute the last line, to handle image size non divisible by SPLASH_SHMDATA_THREADS
-                if (ctx->_height - ctx->_height / SPLASH_SHMDATA_THREADS * (block + 1) < ctx->_height / SPLASH_SHMDATA_THREADS)
-                    lastLine = ctx->_height;
-                else
-                    lastLine = ctx->_height / SPLASH_SHMDATA_THREADS * (block + 1);
-
-                for (int y = ctx->_height / SPLASH_SHMDATA_THREADS * block; y < lastLine; y++)
-                    for (int x = 0; x < ctx->_width; x+=2)
-                    {
-                        unsigned char block[4];
-                        memcpy(block, &YUV[y * ctx->_width * 2 + x * 2], 4 * sizeof(unsigned char));
-
-                        int uValue = (int)(block[0]) - 128;
-                        int vValue = (int)(block[2]) - 128;
-
-                        int rPart = 52298 * vValue;
-                        int gPart = -12846 * uValue - 36641 * vValue;
-                        int bPart = 66094 * uValue;
-                       
-                        int yValue = (int)(block[1] - 16) * 38142;
-                        pixels[(y * ctx->_width + x) * 3] = (unsigned char)clamp((yValue + rPart) / 32768, 0, 255);
-                        pixels[(y * ctx->_width + x) * 3 + 1] = (unsigned char)clamp((yValue + gPart) / 32768, 0, 255);
-                        pixels[(y * ctx->_width + x) * 3 + 2] = (unsigned char)clamp((yValue + bPart) / 32768, 0, 255);
-
-                        yValue = (int)(block[3] - 16) * 38142;
-                        pixels[(y * ctx->_width + x + 1) * 3] = (unsigned char)clamp((yValue + rPart) / 32768, 0, 255);
-                        pixels[(y * ctx->_width + x + 1) * 3 + 1] = (unsigned char)clamp((yValue + gPart) / 32768, 0, 255);
-                        pixels[(y * ctx->_width + x + 1) * 3 + 2] = (unsigned char)clamp((yValue + bPart) / 32768, 0, 255);
-                    }
-            }));
-        }
-#endif
-        SThread::pool.waitThreads(threadIds);
+        const uint8_t* yuv = (const uint8_t*)data;
+        uint8_t* pixels = (uint8_t*)(ctx->_readerBuffer).data();
+        int width = ctx->_width;
+        int height = ctx->_height;
+        bool is420 = ctx->_is420;
+
+        SThread::pool.parallelFor(height, SPLASH_SHMDATA_THREADS, [&](size_t firstLine, size_t lastLine) {
+            if (is420)
+                PixelConversion::i420ToRGB(yuv, yuv + width * height, yuv + width * height * 5 / 4, width, pixels, 3, firstLine, lastLine);
+            else
+                PixelConversion::uyvyToRGB(yuv, width, pixels, 3, firstLine, lastLine);
+        });
     }
     else
         return;
 
     if (!ctx->_bufferImage)
         ctx->_bufferImage = unique_ptr<ImageBuffer>(new ImageBuffer());
+    ctx->stampFrame(ctx->_readerBuffer, ctx->_frameArrival);
     std::swap(*(ctx->_bufferImage), ctx->_readerBuffer);
     ctx->_imageUpdated = true;
     ctx->updateTimestamp();
@@ -4,7 +4,9 @@
 
 #include "basetypes.h"
 #include "log.h"
+#include "serializer.h"
 #include "timer.h"
+#include "tracer.h"
 
 using namespace std;
 
@@ -156,6 +158,14 @@ bool Link::waitForBufferSending(chrono::milliseconds maximumWait)
 /*************/
 bool Link::sendBuffer(const string& name, shared_ptr<SerializedObject> buffer)
 {
+    Tracer::Scope trace("link send", name);
+
+    // Buffers going through shared memory are copied right away,
+    // so the inner Scene can use the original buffer
+    bool sentThroughSharedMemory = false;
+    if (_connectedToOuter)
+        sentThroughSharedMemory = sendSharedMemoryBuffer(name, buffer);
+
     if (_connectedToInner)
     {
         for (auto& rootObjectIt : _connectedTargetPointers)
@@ -163,7 +173,7 @@ bool Link::sendBuffer(const string& name, shared_ptr<SerializedObject> buffer)
             auto rootObject = rootObjectIt.second.lock();
             // If there is also a connection to another process,
             // we make a copy of the buffer right now
-            if (rootObject && _connectedToOuter)
+            if (rootObject && _connectedToOuter && !sentThroughSharedMemory)
             {
                 auto copiedBuffer = make_shared<SerializedObject>();
                 *copiedBuffer = *buffer;
@@ -176,7 +186,7 @@ bool Link::sendBuffer(const string& name, shared_ptr<SerializedObject> buffer)
         }
     }
 
-    if (_connectedToOuter)
+    if (_connectedToOuter && !sentThroughSharedMemory)
     {
         try
         {
@@ -206,6 +216,49 @@ bool Link::sendBuffer(const string& name, shared_ptr<SerializedObject> buffer)
     return true;
 }
 
+/*************/
+bool Link::sendSharedMemoryBuffer(const string& name, const shared_ptr<SerializedObject>& buffer)
+{
+    if (!buffer || buffer->size() == 0)
+        return false;
+
+    lock_guard<mutex> lock(_bufferSendMutex);
+    if (!_shmBufferOut)
+        return false;
+
+    SharedMemoryRing::Notification notification;
+    try
+    {
+        if (!_shmBufferOut->write(buffer->data(), buffer->size(), _connectedTargets.size(), notification))
+            return false;
+
+        zmq::message_t msg(name.size() + 1);
+        memcpy(msg.data(), (void*)name.c_str(), name.size() + 1);
+        _socketBufferOut->send(msg, ZMQ_SNDMORE);
+
+        // An empty frame followed by another one marks a shared memory notification
+        msg.rebuild(0);
+        _socketBufferOut->send(msg, ZMQ_SNDMORE);
+
+        const auto& shmName = _shmBufferOut->getName();
+        msg.rebuild(sizeof(notification) + shmName.size());
+        memcpy(msg.data(), (void*)&notification, sizeof(notification));
+        memcpy(static_cast<char*>(msg.data()) + sizeof(notification), (void*)shmName.c_str(), shmName.size());
+        _socketBufferOut->send(msg);
+    }
+    catch (const zmq::error_t& e)
+    {
+        if (errno != ETERM)
+            Log::get() << Log::WARNING << "Link::" << __FUNCTION__ << " - Exception: " << e.what() << Log::endl;
+
+        // No reader will ever release this slot
+        _shmBufferOut->release(notification);
+        return false;
+    }
+
+    return true;
+}
+
 /*************/
 bool Link::sendBuffer(const string& name, const shared_ptr<BufferObject>& object)
 {
@@ -232,57 +285,10 @@ bool Link::sendMessage(const string& name, const string& attribute, const Values
         {
             lock_guard<mutex> lock(_msgSendMutex);
 
-            // First we send the name of the target
-            zmq::message_t msg(name.size() + 1);
-            memcpy(msg.data(), (void*)name.c_str(), name.size() + 1);
-            _socketMessageOut->send(msg, ZMQ_SNDMORE);
-
-            // And the target's attribute
-            msg.rebuild(attribute.size() + 1);
-            memcpy(msg.data(), (void*)attribute.c_str(), attribute.size() + 1);
-            _socketMessageOut->send(msg, ZMQ_SNDMORE);
-
-            // Helper function to send messages
-            std::function<void(const Values& message)> sendMessage;
-            sendMessage = [&](const Values& message) {
-                // Size of the message
-                int size = message.size();
-                msg.rebuild(sizeof(size));
-                memcpy(msg.data(), (void*)&size, sizeof(size));
-
-                if (message.size() == 0)
-                    _socketMessageOut->send(msg);
-                else
-                    _socketMessageOut->send(msg, ZMQ_SNDMORE);
-
-                for (int i = 0; i < message.size(); ++i)
-                {
-                    auto v = message[i];
-                    Value::Type valueType = v.getType();
-
-                    msg.rebuild(sizeof(valueType));
-                    memcpy(msg.data(), (void*)&valueType, sizeof(valueType));
-                    _socketMessageOut->send(msg, ZMQ_SNDMORE);
-
-                    if (valueType == Value::Type::v)
-                        sendMessage(v.asValues());
-                    else
-                    {
-                        int valueSize = (valueType == Value::Type::s) ? v.size() + 1 : v.size();
-                        void* value = v.data();
-                        msg.rebuild(valueSize);
-                        memcpy(msg.data(), value, valueSize);
-
-                        if (i != message.size() - 1)
-                            _socketMessageOut->send(msg, ZMQ_SNDMORE);
-                        else
-                            _socketMessageOut->send(msg);
-                    }
-                }
-            };
-
-            // Send the message
-            sendMessage(message);
+            // The whole message is packed in a single frame
+            zmq::message_t msg(Serializer::getMessageSize(name, attribute, message));
+            Serializer::serializeMessage(name, attribute, message, static_cast<char*>(msg.data()));
+            _socketMessageOut->send(msg);
         }
         catch (const zmq::error_t& e)
         {
@@ -300,6 +306,29 @@ bool Link::sendMessage(const string& name, const string& attribute, const Values
     return true;
 }
 
+/*************/
+void Link::setSharedMemoryTransport(bool active, size_t slotSize)
+{
+    lock_guard<mutex> lock(_bufferSendMutex);
+    if (!active)
+    {
+        _shmBufferOut.reset();
+        return;
+    }
+
+    if (_shmBufferOut && _shmBufferOut->getSlotSize() >= slotSize)
+        return;
+
+    // The previous segment has to be released first, as they share the same name
+    _shmBufferOut.reset();
+    _shmBufferOut = unique_ptr<SharedMemoryRing>(new SharedMemoryRing("/splash_shm_" + _name, slotSize, SPLASH_SHM_DEFAULT_SLOT_COUNT));
+    if (!*_shmBufferOut)
+    {
+        Log::get() << Log::WARNING << "Link::" << __FUNCTION__ << " - Unable to set up shared memory transport, falling back to sockets" << Log::endl;
+        _shmBufferOut.reset();
+    }
+}
+
 /*************/
 void Link::freeOlderBuffer(void* data, void* hint)
 {
@@ -331,44 +360,19 @@ void Link::handleInputMessages()
         _socketMessageIn->bind((string("ipc:///tmp/splash_msg_") + _name).c_str());
         _socketMessageIn->setsockopt(ZMQ_SUBSCRIBE, NULL, 0); // We subscribe to all incoming messages
 
-        // Helper function to receive messages
         zmq::message_t msg;
-        std::function<Values(void)> recvMessage;
-        recvMessage = [&]()->Values {
-            _socketMessageIn->recv(&msg); // size of the message
-            int size = *(int*)msg.data();
-
-            Values values;
-            for (int i = 0; i < size; ++i)
-            {
-                _socketMessageIn->recv(&msg);
-                Value::Type valueType = *(Value::Type*)msg.data();
-                if (valueType == Value::Type::v)
-                    values.push_back(recvMessage());
-                else
-                {
-                    _socketMessageIn->recv(&msg);
-                    if (valueType == Value::Type::i)
-                        values.push_back(*(int*)msg.data());
-                    else if (valueType == Value::Type::l)
-                        values.push_back(*(int64_t*)msg.data());
-                    else if (valueType == Value::Type::f)
-                        values.push_back(*(float*)msg.data());
-                    else if (valueType == Value::Type::s)
-                        values.push_back(string((char*)msg.data()));
-                }
-            }
-            return values;
-        };
+        string name;
+        string attribute;
+        Values values;
 
         while (true)
         {
-            _socketMessageIn->recv(&msg); // name of the target
-            string name((char*)msg.data());
-            _socketMessageIn->recv(&msg); // target's attribute
-            string attribute((char*)msg.data());
-
-            Values values = recvMessage();
+            _socketMessageIn->recv(&msg);
+            if (!Serializer::deserializeMessage(static_cast<const char*>(msg.data()), msg.size(), name, attribute, values))
+            {
+                Log::get() << Log::WARNING << "Link::" << __FUNCTION__ << " - Received a malformed message" << Log::endl;
+                continue;
+            }
 
             auto root = _rootObject.lock();
             if (root)
@@ -410,11 +414,29 @@ void Link::handleInputBuffers()
             string name((char*)msg.data());
 
             _socketBufferIn->recv(&msg);
-            shared_ptr<SerializedObject> buffer = make_shared<SerializedObject>((char*)msg.data(), (char*)msg.data() + msg.size());
-            
+            shared_ptr<SerializedObject> buffer;
+
+            int more = 0;
+            size_t moreSize = sizeof(more);
+            _socketBufferIn->getsockopt(ZMQ_RCVMORE, &more, &moreSize);
+            if (msg.size() == 0 && more)
+            {
+                _socketBufferIn->recv(&msg);
+                buffer = readSharedMemoryBuffer(msg);
+                if (!buffer)
+                    continue;
+            }
+            else
+            {
+                buffer = make_shared<SerializedObject>((char*)msg.data(), (char*)msg.data() + msg.size());
+            }
+
             auto root = _rootObject.lock();
             if (root)
+            {
+                Tracer::Scope trace("link receive", name);
                 root->setFromSerializedObject(name, std::move(buffer));
+            }
         }
     }
     catch (const zmq::error_t& e)
@@ -426,4 +448,37 @@ void Link::handleInputBuffers()
     _socketBufferIn.reset();
 }
 
+/*************/
+shared_ptr<SerializedObject> Link::readSharedMemoryBuffer(const zmq::message_t& msg)
+{
+    SharedMemoryRing::Notification notification;
+    if (msg.size() < sizeof(notification))
+        return {};
+
+    auto data = static_cast<const char*>(msg.data());
+    memcpy((void*)&notification, data, sizeof(notification));
+    if (msg.size() < sizeof(notification) + notification.nameSize)
+        return {};
+
+    // The segment is opened on first use, and again if the sender recreated it
+    string shmName(data + sizeof(notification), notification.nameSize);
+    auto ringIt = _shmBuffersIn.find(shmName);
+    if (ringIt == _shmBuffersIn.end() || ringIt->second->getId() != notification.ringId)
+    {
+        auto ring = unique_ptr<SharedMemoryRing>(new SharedMemoryRing(shmName));
+        if (!*ring)
+            return {};
+        _shmBuffersIn[shmName] = std::move(ring);
+        ringIt = _shmBuffersIn.find(shmName);
+    }
+
+    auto buffer = ringIt->second->read(notification);
+#ifdef DEBUG
+    if (!buffer)
+        Log::get() << Log::DEBUGGING << "Link::" << __FUNCTION__ << " - Shared memory slot " << notification.slot << " was overwritten before being read" << Log::endl;
+#endif
+
+    return buffer;
+}
+
 } // end of namespace
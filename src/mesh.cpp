@@ -1,14 +1,102 @@
 #include "mesh.h"
 
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "log.h"
 #include "meshLoader.h"
 #include "osUtils.h"
 #include "timer.h"
 
+#define SPLASH_MESH_CACHE_EXTENSION ".splm"
+#define SPLASH_MESH_CACHE_MAGIC 0x4d4c5053 // "SPLM"
+#define SPLASH_MESH_CACHE_VERSION 2
+
 using namespace std;
 
 namespace Splash {
 
+namespace {
+/*************/
+// Header of the binary mesh cache, followed by the vertices (4 floats each), uvs (2), normals (3) and indices
+struct MeshCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceSize;
+    int64_t sourceTime; // In nanoseconds
+    uint64_t sourceHash;
+    uint32_t verticesNumber;
+    uint32_t indicesNumber;
+};
+
+/*************/
+// Map the given file in memory, returns nullptr on failure
+const char* mapFile(const string& filepath, size_t& size)
+{
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    size = fileStat.st_size;
+    void* ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED)
+        return nullptr;
+
+    return static_cast<const char*>(ptr);
+}
+
+/*************/
+// Hash of the content of a file, read eight bytes at a time
+uint64_t hashFile(const string& filepath)
+{
+    size_t size = 0;
+    const char* data = mapFile(filepath, size);
+    if (!data)
+        return 0;
+    madvise(const_cast<char*>(data), size, MADV_SEQUENTIAL);
+
+    uint64_t hash = 0xcbf29ce484222325ull ^ size;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+        hash ^= hash >> 32;
+    }
+    for (; i < size; ++i)
+        hash = (hash ^ static_cast<uint8_t>(data[i])) * 0x100000001b3ull;
+
+    munmap(const_cast<char*>(data), size);
+    return hash;
+}
+
+/*************/
+// Modification time of a file, in nanoseconds
+int64_t getModificationTime(const struct stat& fileStat)
+{
+#if HAVE_OSX
+    return (int64_t)fileStat.st_mtimespec.tv_sec * 1000000000ll + fileStat.st_mtimespec.tv_nsec;
+#else
+    return (int64_t)fileStat.st_mtim.tv_sec * 1000000000ll + fileStat.st_mtim.tv_nsec;
+#endif
+}
+}
+
 /*************/
 Mesh::Mesh()
 {
@@ -113,6 +201,13 @@ vector<float> Mesh::getAnnexe() const
     return annexe;
 }
 
+/*************/
+vector<unsigned int> Mesh::getIndices() const
+{
+    lock_guard<mutex> lock(_readMutex);
+    return _mesh.indices;
+}
+
 /*************/
 bool Mesh::read(const string& filename)
 {
@@ -124,18 +219,29 @@ bool Mesh::read(const string& filename)
 
     if (!_isConnectedToRemote)
     {
-        Loader::Obj objLoader;
-        if (!objLoader.load(filepath))
+        MeshContainer mesh;
+        if (!readCache(filepath, mesh))
         {
-            Log::get() << Log::WARNING << "Mesh::" << __FUNCTION__ << " - Unable to read the specified mesh file: " << filename << Log::endl;
-            return false;
+            // The source is checked before parsing, so that a file modified meanwhile is not cached
+            struct stat sourceStat;
+            bool hasSourceStat = stat(filepath.c_str(), &sourceStat) == 0;
+
+            Loader::Obj objLoader;
+            if (!objLoader.load(filepath))
+            {
+                Log::get() << Log::WARNING << "Mesh::" << __FUNCTION__ << " - Unable to read the specified mesh file: " << filename << Log::endl;
+                return false;
+            }
+
+            mesh.vertices = objLoader.getVertices();
+            mesh.uvs = objLoader.getUVs();
+            mesh.normals = objLoader.getNormals();
+            mesh.indices = objLoader.getIndices();
+            if (hasSourceStat)
+                writeCache(filepath, sourceStat, mesh);
         }
 
         _filepath = filepath;
-        MeshContainer mesh;
-        mesh.vertices = objLoader.getVertices();
-        mesh.uvs = objLoader.getUVs();
-        mesh.normals = objLoader.getNormals();
 
         lock_guard<mutex> lock(_writeMutex);
         _mesh = mesh;
@@ -145,6 +251,116 @@ bool Mesh::read(const string& filename)
     return true;
 }
 
+/*************/
+bool Mesh::readCache(const string& filepath, MeshContainer& mesh) const
+{
+    struct stat sourceStat;
+    if (stat(filepath.c_str(), &sourceStat) != 0)
+        return false;
+
+    auto cachePath = filepath + SPLASH_MESH_CACHE_EXTENSION;
+    size_t cacheSize = 0;
+    const char* cache = mapFile(cachePath, cacheSize);
+    if (!cache)
+        return false;
+
+    MeshCacheHeader header;
+    bool isValid = cacheSize >= sizeof(header);
+    if (isValid)
+    {
+        memcpy(&header, cache, sizeof(header));
+        uint64_t expectedSize = sizeof(header) + (uint64_t)header.verticesNumber * 9 * sizeof(float) + (uint64_t)header.indicesNumber * sizeof(unsigned int);
+        isValid = header.magic == SPLASH_MESH_CACHE_MAGIC && header.version == SPLASH_MESH_CACHE_VERSION && expectedSize == cacheSize
+            && header.sourceSize == (uint64_t)sourceStat.st_size;
+    }
+
+    // A different modification time does not mean a different content, as when copying a configuration around
+    if (isValid && header.sourceTime != getModificationTime(sourceStat))
+        isValid = header.sourceHash == hashFile(filepath);
+
+    if (!isValid)
+    {
+        munmap(const_cast<char*>(cache), cacheSize);
+        return false;
+    }
+
+    auto ptr = cache + sizeof(header);
+    mesh.vertices.resize(header.verticesNumber);
+    mesh.uvs.resize(header.verticesNumber);
+    mesh.normals.resize(header.verticesNumber);
+    mesh.indices.resize(header.indicesNumber);
+    for (unsigned int i = 0; i < header.verticesNumber; ++i, ptr += 4 * sizeof(float))
+        memcpy(&mesh.vertices[i][0], ptr, 4 * sizeof(float));
+    for (unsigned int i = 0; i < header.verticesNumber; ++i, ptr += 2 * sizeof(float))
+        memcpy(&mesh.uvs[i][0], ptr, 2 * sizeof(float));
+    for (unsigned int i = 0; i < header.verticesNumber; ++i, ptr += 3 * sizeof(float))
+        memcpy(&mesh.normals[i][0], ptr, 3 * sizeof(float));
+    memcpy(mesh.indices.data(), ptr, header.indicesNumber * sizeof(unsigned int));
+
+    munmap(const_cast<char*>(cache), cacheSize);
+
+    for (auto index : mesh.indices)
+    {
+        if (index >= header.verticesNumber)
+        {
+            Log::get() << Log::WARNING << "Mesh::" << __FUNCTION__ << " - Mesh cache " << cachePath << " is corrupted, ignoring it" << Log::endl;
+            mesh = MeshContainer();
+            return false;
+        }
+    }
+
+    Log::get() << Log::MESSAGE << "Mesh::" << __FUNCTION__ << " - Loaded mesh from cache " << cachePath << Log::endl;
+    return true;
+}
+
+/*************/
+void Mesh::writeCache(const string& filepath, const struct stat& sourceStat, const MeshContainer& mesh) const
+{
+    if (mesh.uvs.size() != mesh.vertices.size() || mesh.normals.size() != mesh.vertices.size())
+        return;
+
+    MeshCacheHeader header;
+    header.magic = SPLASH_MESH_CACHE_MAGIC;
+    header.version = SPLASH_MESH_CACHE_VERSION;
+    header.sourceSize = sourceStat.st_size;
+    header.sourceTime = getModificationTime(sourceStat);
+    header.sourceHash = hashFile(filepath);
+
+    // The source must not have changed since it has been parsed, hash included
+    struct stat currentStat;
+    if (stat(filepath.c_str(), &currentStat) != 0 || currentStat.st_size != sourceStat.st_size || getModificationTime(currentStat) != header.sourceTime)
+        return;
+    header.verticesNumber = mesh.vertices.size();
+    header.indicesNumber = mesh.indices.size();
+
+    // Write to a temporary file first, so that a concurrent read never sees a partial cache
+    auto cachePath = filepath + SPLASH_MESH_CACHE_EXTENSION;
+    auto tmpPath = cachePath + ".tmp";
+    FILE* file = fopen(tmpPath.c_str(), "wb");
+    if (!file)
+    {
+        Log::get() << Log::DEBUGGING << "Mesh::" << __FUNCTION__ << " - Unable to write mesh cache " << cachePath << Log::endl;
+        return;
+    }
+
+    bool isWritten = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (auto& v : mesh.vertices)
+        isWritten = isWritten && fwrite(&v[0], sizeof(float), 4, file) == 4;
+    for (auto& u : mesh.uvs)
+        isWritten = isWritten && fwrite(&u[0], sizeof(float), 2, file) == 2;
+    for (auto& n : mesh.normals)
+        isWritten = isWritten && fwrite(&n[0], sizeof(float), 3, file) == 3;
+    if (mesh.indices.size() != 0)
+        isWritten = isWritten && fwrite(mesh.indices.data(), sizeof(unsigned int), mesh.indices.size(), file) == mesh.indices.size();
+    isWritten = (fclose(file) == 0) && isWritten;
+
+    if (!isWritten || rename(tmpPath.c_str(), cachePath.c_str()) != 0)
+    {
+        Log::get() << Log::DEBUGGING << "Mesh::" << __FUNCTION__ << " - Unable to write mesh cache " << cachePath << Log::endl;
+        unlink(tmpPath.c_str());
+    }
+}
+
 /*************/
 shared_ptr<SerializedObject> Mesh::serialize() const
 {
@@ -159,12 +375,15 @@ shared_ptr<SerializedObject> Mesh::serialize() const
     data.push_back(getUVCoords());
     data.push_back(getNormals());
     data.push_back(getAnnexe());    
+    vector<unsigned int> indices = getIndices();
 
     lock_guard<mutex> lock(_readMutex);
     int nbrVertices = data[0].size() / 4;
-    int totalSize = sizeof(nbrVertices); // We add to all this the total number of vertices
+    int nbrIndices = indices.size();
+    int totalSize = sizeof(nbrVertices) + sizeof(nbrIndices); // We add to all this the total number of vertices and indices
     for (auto& d : data)
         totalSize += d.size() * sizeof(d[0]);
+    totalSize += nbrIndices * sizeof(unsigned int);
     obj->resize(totalSize);
 
     auto currentObjPtr = obj->data();
@@ -172,12 +391,20 @@ shared_ptr<SerializedObject> Mesh::serialize() const
     copy(ptr, ptr + sizeof(nbrVertices), currentObjPtr);
     currentObjPtr += sizeof(nbrVertices);
 
+    ptr = reinterpret_cast<const char*>(&nbrIndices);
+    copy(ptr, ptr + sizeof(nbrIndices), currentObjPtr);
+    currentObjPtr += sizeof(nbrIndices);
+
     for (auto& d : data)
     {
         ptr = reinterpret_cast<const char*>(d.data());
         copy(ptr, ptr + d.size() * sizeof(float), currentObjPtr);
         currentObjPtr += d.size() * sizeof(float);
     }
+
+    // Indices come last
+    ptr = reinterpret_cast<const char*>(indices.data());
+    copy(ptr, ptr + nbrIndices * sizeof(unsigned int), currentObjPtr);
     
     if (Timer::get().isDebug())
         Timer::get() >> "serialize " + _name;
@@ -194,15 +421,26 @@ bool Mesh::deserialize(const shared_ptr<SerializedObject>& obj)
     if (Timer::get().isDebug())
         Timer::get() << "deserialize " + _name;
 
-    // First, we get the number of vertices
-    int nbrVertices;
-    char* ptr = reinterpret_cast<char*>(&nbrVertices);
+    // First, we get the number of vertices and indices
+    int nbrVertices, nbrIndices;
+    if (obj->size() < sizeof(nbrVertices) + sizeof(nbrIndices))
+    {
+        Log::get() << Log::WARNING << "Mesh::" << __FUNCTION__ << " - Bad buffer received, discarding" << Log::endl;
+        return false;
+    }
 
+    char* ptr = reinterpret_cast<char*>(&nbrVertices);
     auto currentObjPtr = obj->data();
     copy(currentObjPtr, currentObjPtr + sizeof(nbrVertices), ptr); // This will fail if float have different size between sender and receiver
     currentObjPtr += sizeof(nbrVertices);
 
-    if (nbrVertices < 0 || nbrVertices > obj->size())
+    ptr = reinterpret_cast<char*>(&nbrIndices);
+    copy(currentObjPtr, currentObjPtr + sizeof(nbrIndices), ptr);
+    currentObjPtr += sizeof(nbrIndices);
+
+    size_t headerSize = sizeof(nbrVertices) + sizeof(nbrIndices);
+    size_t baseSize = headerSize + (size_t)nbrVertices * 10 * sizeof(float) + (size_t)nbrIndices * sizeof(unsigned int);
+    if (nbrVertices < 0 || nbrIndices < 0 || baseSize > obj->size())
     {
         Log::get() << Log::WARNING << "Mesh::" << __FUNCTION__ << " - Bad buffer received, discarding" << Log::endl;
         return false;
@@ -214,7 +452,7 @@ bool Mesh::deserialize(const shared_ptr<SerializedObject>& obj)
     data.push_back(vector<float>(nbrVertices * 4));
 
     bool hasAnnexe = false;
-    if (obj->size() > nbrVertices * 4 * 14) // Check whether there is an annexe buffer in all this
+    if (nbrVertices > 0 && obj->size() >= baseSize + nbrVertices * 4 * sizeof(float)) // Check whether there is an annexe buffer in all this
     {
         hasAnnexe = true;
         data.push_back(vector<float>(nbrVertices * 4));
@@ -230,6 +468,19 @@ bool Mesh::deserialize(const shared_ptr<SerializedObject>& obj)
             currentObjPtr += d.size() * sizeof(float);
         }
 
+        vector<unsigned int> indices(nbrIndices);
+        ptr = reinterpret_cast<char*>(indices.data());
+        copy(currentObjPtr, currentObjPtr + nbrIndices * sizeof(unsigned int), ptr);
+
+        for (auto index : indices)
+        {
+            if (index >= nbrVertices)
+            {
+                Log::get() << Log::WARNING << "Mesh::" << __FUNCTION__ << " - Bad buffer received, discarding" << Log::endl;
+                return false;
+            }
+        }
+
         // Next step: use these values to reset the vertices of _mesh
         MeshContainer mesh;
 
@@ -269,6 +520,8 @@ bool Mesh::deserialize(const shared_ptr<SerializedObject>& obj)
             }
         }
 
+        mesh.indices = std::move(indices);
+
         _bufferMesh = mesh;
         _meshUpdated = true;
 
@@ -310,9 +563,6 @@ void Mesh::createDefaultMesh(int subdiv)
 
     MeshContainer mesh;
 
-    vector<glm::vec2> positions;
-    vector<glm::vec2> uvs;
-
     for (int v = 0; v < subdiv + 2; ++v)
     {
         glm::vec2 position;
@@ -326,8 +576,9 @@ void Mesh::createDefaultMesh(int subdiv)
             uv.x = (float)u / ((float)(subdiv + 1));
             position.x = uv.x * 2.f - 1.f;
 
-            positions.push_back(position);
-            uvs.push_back(uv);
+            mesh.vertices.push_back(glm::vec4(position, 0.0, 1.0));
+            mesh.uvs.push_back(uv);
+            mesh.normals.push_back(glm::vec3(0.0, 0.0, 1.0));
         }
     }
 
@@ -335,28 +586,13 @@ void Mesh::createDefaultMesh(int subdiv)
     {
         for (int u = 0; u < subdiv + 1; ++u)
         {
-            mesh.vertices.push_back(glm::vec4(positions[u + v * (subdiv + 2)], 0.0, 1.0));
-            mesh.vertices.push_back(glm::vec4(positions[u + 1 + v * (subdiv + 2)], 0.0, 1.0));
-            mesh.vertices.push_back(glm::vec4(positions[u + (v + 1) * (subdiv + 2)], 0.0, 1.0));
-
-            mesh.vertices.push_back(glm::vec4(positions[u + 1 + v * (subdiv + 2)], 0.0, 1.0));
-            mesh.vertices.push_back(glm::vec4(positions[u + 1 + (v + 1) * (subdiv + 2)], 0.0, 1.0));
-            mesh.vertices.push_back(glm::vec4(positions[u + (v + 1) * (subdiv + 2)], 0.0, 1.0));
-
-            mesh.uvs.push_back(uvs[u + v * (subdiv + 2)]);
-            mesh.uvs.push_back(uvs[u + 1 + v * (subdiv + 2)]);
-            mesh.uvs.push_back(uvs[u + (v + 1) * (subdiv + 2)]);
-
-            mesh.uvs.push_back(uvs[u + 1 + v * (subdiv + 2)]);
-            mesh.uvs.push_back(uvs[u + 1 + (v + 1) * (subdiv + 2)]);
-            mesh.uvs.push_back(uvs[u + (v + 1) * (subdiv + 2)]);
+            mesh.indices.push_back(u + v * (subdiv + 2));
+            mesh.indices.push_back(u + 1 + v * (subdiv + 2));
+            mesh.indices.push_back(u + (v + 1) * (subdiv + 2));
 
-            mesh.normals.push_back(glm::vec3(0.0, 0.0, 1.0));
-            mesh.normals.push_back(glm::vec3(0.0, 0.0, 1.0));
-            mesh.normals.push_back(glm::vec3(0.0, 0.0, 1.0));
-            mesh.normals.push_back(glm::vec3(0.0, 0.0, 1.0));
-            mesh.normals.push_back(glm::vec3(0.0, 0.0, 1.0));
-            mesh.normals.push_back(glm::vec3(0.0, 0.0, 1.0));
+            mesh.indices.push_back(u + 1 + v * (subdiv + 2));
+            mesh.indices.push_back(u + 1 + (v + 1) * (subdiv + 2));
+            mesh.indices.push_back(u + (v + 1) * (subdiv + 2));
         }
     }
 
@@ -374,7 +610,7 @@ void Mesh::registerAttributes()
     }, [&]() -> Values {
         return {_filepath};
     }, {'s'});
-    setAttributeDescription("file", "Mesh file to load");
+    setAttributeDescription("file", "Mesh file to load. A binary cache (" SPLASH_MESH_CACHE_EXTENSION ") is written next to it to speed up the next loads");
     
     addAttribute("benchmark", [&](const Values& args) {
         if (args[0].asInt() > 0)
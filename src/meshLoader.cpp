@@ -0,0 +1,569 @@
+#include "meshLoader.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+#include "log.h"
+#include "threadpool.h"
+
+#define SPLASH_OBJ_MIN_CHUNK_SIZE (1 << 20) // Files smaller than this are parsed in a single chunk
+
+using namespace std;
+
+namespace Splash
+{
+namespace Loader
+{
+
+namespace
+{
+/*************/
+enum LineType
+{
+    otherLine = 0,
+    vertexLine,
+    uvLine,
+    normalLine,
+    faceLine
+};
+
+/*************/
+struct Chunk
+{
+    const char* begin {nullptr};
+    const char* end {nullptr};
+    int vertexOffset {0};
+    int uvOffset {0};
+    int normalOffset {0};
+    int vertexCount {0};
+    int uvCount {0};
+    int normalCount {0};
+    vector<Obj::FaceVertex> corners {};
+};
+
+/*************/
+inline bool isBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/*************/
+inline bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+/*************/
+inline const char* skipBlanks(const char* ptr, const char* end)
+{
+    while (ptr < end && isBlank(*ptr))
+        ++ptr;
+    return ptr;
+}
+
+/*************/
+inline const char* getLineEnd(const char* ptr, const char* end)
+{
+    auto eol = static_cast<const char*>(memchr(ptr, '\n', end - ptr));
+    return eol ? eol : end;
+}
+
+/*************/
+// Get the type of the line starting at ptr, and move ptr after its keyword
+inline LineType getLineType(const char*& ptr, const char* end)
+{
+    ptr = skipBlanks(ptr, end);
+    if (end - ptr < 2)
+        return otherLine;
+
+    if (ptr[0] == 'v')
+    {
+        if (isBlank(ptr[1]))
+        {
+            ptr += 2;
+            return vertexLine;
+        }
+        else if (end - ptr >= 3 && isBlank(ptr[2]))
+        {
+            ptr += 3;
+            if (ptr[-2] == 't')
+                return uvLine;
+            else if (ptr[-2] == 'n')
+                return normalLine;
+        }
+    }
+    else if (ptr[0] == 'f' && isBlank(ptr[1]))
+    {
+        ptr += 2;
+        return faceLine;
+    }
+
+    return otherLine;
+}
+
+/*************/
+// Parse an integer at ptr, without any allocation
+inline bool parseInt(const char*& ptr, const char* end, int& value)
+{
+    bool negative = false;
+    if (ptr < end && (*ptr == '-' || *ptr == '+'))
+    {
+        negative = (*ptr == '-');
+        ++ptr;
+    }
+
+    if (ptr >= end || !isDigit(*ptr))
+        return false;
+
+    int result = 0;
+    while (ptr < end && isDigit(*ptr))
+        result = result * 10 + (*ptr++ - '0');
+
+    value = negative ? -result : result;
+    return true;
+}
+
+/*************/
+// Parse a float at ptr, without any allocation
+// Numbers with up to 15 significant digits and a small exponent are computed exactly in double precision,
+// which covers what exporters write. Others go through strtod.
+inline bool parseFloat(const char*& ptr, const char* end, float& value)
+{
+    static const double powersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                         1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+    const char* start = ptr;
+    bool negative = false;
+    if (ptr < end && (*ptr == '-' || *ptr == '+'))
+    {
+        negative = (*ptr == '-');
+        ++ptr;
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool hasDigits = false;
+
+    for (; ptr < end && isDigit(*ptr); ++ptr)
+    {
+        hasDigits = true;
+        if (digits < 19)
+        {
+            mantissa = mantissa * 10 + (*ptr - '0');
+            if (mantissa != 0)
+                ++digits;
+        }
+        else
+        {
+            ++exponent;
+        }
+    }
+
+    if (ptr < end && *ptr == '.')
+    {
+        for (++ptr; ptr < end && isDigit(*ptr); ++ptr)
+        {
+            hasDigits = true;
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (*ptr - '0');
+                if (mantissa != 0)
+                    ++digits;
+                --exponent;
+            }
+        }
+    }
+
+    if (!hasDigits)
+    {
+        ptr = start;
+        return false;
+    }
+
+    if (ptr < end && (*ptr == 'e' || *ptr == 'E'))
+    {
+        const char* exponentPtr = ptr + 1;
+        int explicitExponent;
+        if (parseInt(exponentPtr, end, explicitExponent))
+        {
+            exponent += explicitExponent;
+            ptr = exponentPtr;
+        }
+    }
+
+    double result;
+    if (digits <= 15 && exponent >= -22 && exponent <= 22)
+    {
+        result = static_cast<double>(mantissa);
+        if (exponent < 0)
+            result /= powersOfTen[-exponent];
+        else
+            result *= powersOfTen[exponent];
+    }
+    else
+    {
+        char buffer[64];
+        size_t length = ptr - start;
+        if (length < sizeof(buffer))
+        {
+            memcpy(buffer, start, length);
+            buffer[length] = '\0';
+            value = static_cast<float>(strtod(buffer, nullptr));
+            return true;
+        }
+        result = static_cast<double>(mantissa) * pow(10.0, exponent);
+    }
+
+    value = static_cast<float>(negative ? -result : result);
+    return true;
+}
+
+/*************/
+// Convert an OBJ index (1-based, or negative for relative ones) to a 0-based one, -1 if invalid
+inline int resolveIndex(int index, int count)
+{
+    if (index > 0)
+        return index - 1;
+    else if (index < 0)
+        return count + index;
+    else
+        return -1;
+}
+
+/*************/
+// First pass over a chunk, counting the vertices, uvs and normals it holds
+void countElements(Chunk& chunk)
+{
+    for (const char* line = chunk.begin; line < chunk.end;)
+    {
+        const char* lineEnd = getLineEnd(line, chunk.end);
+        switch (getLineType(line, lineEnd))
+        {
+        default:
+            break;
+        case vertexLine:
+            ++chunk.vertexCount;
+            break;
+        case uvLine:
+            ++chunk.uvCount;
+            break;
+        case normalLine:
+            ++chunk.normalCount;
+            break;
+        }
+        line = (lineEnd == chunk.end) ? chunk.end : lineEnd + 1;
+    }
+}
+
+/*************/
+// Second pass over a chunk, writing vertices, uvs and normals at their final place, and the triangulated faces in the chunk
+void parseElements(Chunk& chunk, Obj::Content& content)
+{
+    int vertexId = chunk.vertexOffset;
+    int uvId = chunk.uvOffset;
+    int normalId = chunk.normalOffset;
+    vector<Obj::FaceVertex> polygon;
+
+    for (const char* line = chunk.begin; line < chunk.end;)
+    {
+        const char* lineEnd = getLineEnd(line, chunk.end);
+        const char* ptr = line;
+
+        switch (getLineType(ptr, lineEnd))
+        {
+        default:
+            break;
+        case vertexLine:
+        {
+            glm::vec4 vertex(0.f, 0.f, 0.f, 1.f);
+            for (int i = 0; i < 4; ++i)
+            {
+                ptr = skipBlanks(ptr, lineEnd);
+                if (!parseFloat(ptr, lineEnd, vertex[i]))
+                    break;
+            }
+            content.vertices[vertexId++] = vertex;
+            break;
+        }
+        case uvLine:
+        {
+            glm::vec2 uv(0.f, 0.f);
+            for (int i = 0; i < 2; ++i)
+            {
+                ptr = skipBlanks(ptr, lineEnd);
+                if (!parseFloat(ptr, lineEnd, uv[i]))
+                    break;
+            }
+            content.uvs[uvId++] = uv;
+            break;
+        }
+        case normalLine:
+        {
+            glm::vec3 normal(0.f, 0.f, 0.f);
+            for (int i = 0; i < 3; ++i)
+            {
+                ptr = skipBlanks(ptr, lineEnd);
+                if (!parseFloat(ptr, lineEnd, normal[i]))
+                    break;
+            }
+            content.normals[normalId++] = normal;
+            break;
+        }
+        case faceLine:
+        {
+            polygon.clear();
+            while (true)
+            {
+                ptr = skipBlanks(ptr, lineEnd);
+                int index;
+                if (!parseInt(ptr, lineEnd, index))
+                    break;
+
+                Obj::FaceVertex faceVertex;
+                faceVertex.vertexId = resolveIndex(index, vertexId);
+                if (ptr < lineEnd && *ptr == '/')
+                {
+                    ++ptr;
+                    if (parseInt(ptr, lineEnd, index))
+                        faceVertex.uvId = resolveIndex(index, uvId);
+                    if (ptr < lineEnd && *ptr == '/')
+                    {
+                        ++ptr;
+                        if (parseInt(ptr, lineEnd, index))
+                            faceVertex.normalId = resolveIndex(index, normalId);
+                    }
+                }
+                polygon.push_back(faceVertex);
+
+                while (ptr < lineEnd && !isBlank(*ptr))
+                    ++ptr;
+            }
+
+            // Faces are triangulated as fans, which is exact for convex polygons
+            for (size_t i = 2; i < polygon.size(); ++i)
+            {
+                chunk.corners.push_back(polygon[0]);
+                chunk.corners.push_back(polygon[i - 1]);
+                chunk.corners.push_back(polygon[i]);
+            }
+            break;
+        }
+        }
+
+        line = (lineEnd == chunk.end) ? chunk.end : lineEnd + 1;
+    }
+}
+
+/*************/
+// Run the given function on each chunk, through the global thread pool
+template<typename F>
+void runOnChunks(vector<Chunk>& chunks, F f)
+{
+    TaskGroup group;
+    for (auto& chunk : chunks)
+    {
+        Chunk* chunkPtr = &chunk;
+        group.run([=]() {
+            f(*chunkPtr);
+        });
+    }
+    group.wait();
+}
+
+/*************/
+struct IndexedVertex
+{
+    glm::vec4 vertex;
+    glm::vec2 uv;
+    glm::vec3 normal;
+
+    bool operator==(const IndexedVertex& v) const
+    {
+        return vertex == v.vertex && uv == v.uv && normal == v.normal;
+    }
+};
+
+/*************/
+struct IndexedVertexHash
+{
+    size_t operator()(const IndexedVertex& v) const
+    {
+        std::hash<float> hasher;
+        size_t seed = 0;
+        auto combine = [&](float value) {
+            seed ^= hasher(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+        };
+        for (int i = 0; i < 3; ++i)
+            combine(v.vertex[i]);
+        combine(v.uv[0]);
+        combine(v.uv[1]);
+        return seed;
+    }
+};
+} // end of anonymous namespace
+
+/*************/
+bool Obj::load(string filename)
+{
+    _indexedVertices.clear();
+    _indexedUVs.clear();
+    _indexedNormals.clear();
+    _indices.clear();
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    size_t fileSize = fileStat.st_size;
+    void* mappedFile = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mappedFile == MAP_FAILED)
+        return false;
+    madvise(mappedFile, fileSize, MADV_WILLNEED);
+
+    const char* fileBegin = static_cast<const char*>(mappedFile);
+    const char* fileEnd = fileBegin + fileSize;
+
+    // Split the file in chunks, cut at line ends
+    size_t chunkNbr = std::min<size_t>(SPLASH_MAX_THREAD, fileSize / SPLASH_OBJ_MIN_CHUNK_SIZE + 1);
+    vector<Chunk> chunks;
+    const char* chunkBegin = fileBegin;
+    for (size_t i = 1; i <= chunkNbr && chunkBegin < fileEnd; ++i)
+    {
+        const char* chunkEnd = fileEnd;
+        if (i != chunkNbr)
+        {
+            chunkEnd = getLineEnd(std::max(chunkBegin, fileBegin + fileSize * i / chunkNbr), fileEnd);
+            if (chunkEnd != fileEnd)
+                ++chunkEnd;
+        }
+
+        Chunk chunk;
+        chunk.begin = chunkBegin;
+        chunk.end = chunkEnd;
+        chunks.push_back(chunk);
+        chunkBegin = chunkEnd;
+    }
+
+    // Count the elements in each chunk, to know where they go in the flat arrays
+    runOnChunks(chunks, [](Chunk& chunk) {
+        countElements(chunk);
+    });
+
+    Content content;
+    int vertexNbr = 0, uvNbr = 0, normalNbr = 0;
+    for (auto& chunk : chunks)
+    {
+        chunk.vertexOffset = vertexNbr;
+        chunk.uvOffset = uvNbr;
+        chunk.normalOffset = normalNbr;
+        vertexNbr += chunk.vertexCount;
+        uvNbr += chunk.uvCount;
+        normalNbr += chunk.normalCount;
+    }
+    content.vertices.resize(vertexNbr);
+    content.uvs.resize(uvNbr);
+    content.normals.resize(normalNbr);
+
+    // Parse the elements, then gather the faces
+    runOnChunks(chunks, [&](Chunk& chunk) {
+        parseElements(chunk, content);
+    });
+
+    munmap(mappedFile, fileSize);
+
+    size_t cornerNbr = 0;
+    for (auto& chunk : chunks)
+        cornerNbr += chunk.corners.size();
+    content.corners.reserve(cornerNbr);
+    for (auto& chunk : chunks)
+    {
+        content.corners.insert(content.corners.end(), chunk.corners.begin(), chunk.corners.end());
+        vector<FaceVertex>().swap(chunk.corners);
+    }
+
+    // Check that we have faces and vertices
+    if (content.vertices.size() == 0 || content.corners.size() == 0)
+        return false;
+
+    return buildIndexedMesh(content);
+}
+
+/*************/
+bool Obj::buildIndexedMesh(const Content& content)
+{
+    int vertexNbr = content.vertices.size();
+    int uvNbr = content.uvs.size();
+    int normalNbr = content.normals.size();
+
+    unordered_map<IndexedVertex, unsigned int, IndexedVertexHash> vertexIds;
+    vertexIds.reserve(content.vertices.size());
+    _indices.reserve(content.corners.size());
+
+    for (size_t face = 0; face < content.corners.size(); face += 3)
+    {
+        const FaceVertex* corners = &content.corners[face];
+
+        for (int i = 0; i < 3; ++i)
+        {
+            if (corners[i].vertexId < 0 || corners[i].vertexId >= vertexNbr || corners[i].uvId >= uvNbr || corners[i].normalId >= normalNbr
+                || (corners[0].uvId != -1 && corners[i].uvId < 0) || (corners[0].normalId != -1 && corners[i].normalId < 0))
+            {
+                Log::get() << Log::WARNING << "Loader::Obj::" << __FUNCTION__ << " - A face refers to a missing vertex, uv or normal" << Log::endl;
+                _indices.clear();
+                _indexedVertices.clear();
+                _indexedUVs.clear();
+                _indexedNormals.clear();
+                return false;
+            }
+        }
+
+        // Faces without normals get a flat one
+        glm::vec3 faceNormal;
+        if (corners[0].normalId == -1)
+        {
+            auto edge1 = glm::vec3(content.vertices[corners[1].vertexId] - content.vertices[corners[0].vertexId]);
+            auto edge2 = glm::vec3(content.vertices[corners[2].vertexId] - content.vertices[corners[0].vertexId]);
+            faceNormal = glm::normalize(glm::cross(edge1, edge2));
+        }
+
+        for (int i = 0; i < 3; ++i)
+        {
+            IndexedVertex corner;
+            corner.vertex = content.vertices[corners[i].vertexId];
+            corner.uv = (corners[0].uvId == -1) ? glm::vec2(0.f, 0.f) : content.uvs[corners[i].uvId];
+            corner.normal = (corners[0].normalId == -1) ? faceNormal : content.normals[corners[i].normalId];
+
+            auto it = vertexIds.find(corner);
+            if (it == vertexIds.end())
+            {
+                it = vertexIds.emplace(corner, static_cast<unsigned int>(_indexedVertices.size())).first;
+                _indexedVertices.push_back(corner.vertex);
+                _indexedUVs.push_back(corner.uv);
+                _indexedNormals.push_back(corner.normal);
+            }
+            _indices.push_back(it->second);
+        }
+    }
+
+    return true;
+}
+
+} // end of namespace
+} // end of namespace
@@ -118,32 +118,27 @@ void Mesh_BezierPatch::createPatch(Patch& patch)
     _patchUpdated = true;
 
     MeshContainer mesh;
-    for (int v = 0; v < height - 1; ++v)
+    for (int v = 0; v < height; ++v)
     {
-        for (int u = 0; u < width - 1; ++u)
+        for (int u = 0; u < width; ++u)
         {
             mesh.vertices.push_back(glm::vec4(patch.vertices[u + v * width], 0.0, 1.0));
-            mesh.vertices.push_back(glm::vec4(patch.vertices[u + 1 + v * width], 0.0, 1.0));
-            mesh.vertices.push_back(glm::vec4(patch.vertices[u + (v + 1) * width], 0.0, 1.0));
-
-            mesh.vertices.push_back(glm::vec4(patch.vertices[u + 1 + (v + 1) * width], 0.0, 1.0));
-            mesh.vertices.push_back(glm::vec4(patch.vertices[u + (v + 1) * width], 0.0, 1.0));
-            mesh.vertices.push_back(glm::vec4(patch.vertices[u + 1 + v * width], 0.0, 1.0));
-
             mesh.uvs.push_back(patch.uvs[u + v * width]);
-            mesh.uvs.push_back(patch.uvs[u + 1 + v * width]);
-            mesh.uvs.push_back(patch.uvs[u + (v + 1) * width]);
+            mesh.normals.push_back(glm::vec3(0.0, 0.0, 1.0));
+        }
+    }
 
-            mesh.uvs.push_back(patch.uvs[u + 1 + (v + 1) * width]);
-            mesh.uvs.push_back(patch.uvs[u + (v + 1) * width]);
-            mesh.uvs.push_back(patch.uvs[u + 1 + v * width]);
+    for (int v = 0; v < height - 1; ++v)
+    {
+        for (int u = 0; u < width - 1; ++u)
+        {
+            mesh.indices.push_back(u + v * width);
+            mesh.indices.push_back(u + 1 + v * width);
+            mesh.indices.push_back(u + (v + 1) * width);
 
-            mesh.normals.push_back(glm::vec3(0.0, 0.0, 1.0));
-            mesh.normals.push_back(glm::vec3(0.0, 0.0, 1.0));
-            mesh.normals.push_back(glm::vec3(0.0, 0.0, 1.0));
-            mesh.normals.push_back(glm::vec3(0.0, 0.0, 1.0));
-            mesh.normals.push_back(glm::vec3(0.0, 0.0, 1.0));
-            mesh.normals.push_back(glm::vec3(0.0, 0.0, 1.0));
+            mesh.indices.push_back(u + 1 + (v + 1) * width);
+            mesh.indices.push_back(u + (v + 1) * width);
+            mesh.indices.push_back(u + 1 + v * width);
         }
     }
     _bezierControl = mesh;
@@ -154,9 +149,6 @@ void Mesh_BezierPatch::createPatch(Patch& patch)
 /*************/
 void Mesh_BezierPatch::updatePatch()
 {
-    vector<glm::vec2> vertices;
-    vector<glm::vec2> uvs;
-
     // Update the binomial coefficients if needed
     if (_patch.size != _binomialDimensions)
     {
@@ -173,6 +165,7 @@ void Mesh_BezierPatch::updatePatch()
     }
 
     // Compute the vertices positions
+    MeshContainer mesh;
     for (int v = 0; v < _patchResolution; ++v)
     {
         glm::vec2 uv;
@@ -194,39 +187,24 @@ void Mesh_BezierPatch::updatePatch()
                 }
             }
 
-            vertices.push_back(vertex);
-            uvs.push_back(uv);
+            mesh.vertices.push_back(glm::vec4(vertex, 0.0, 1.0));
+            mesh.uvs.push_back(uv);
+            mesh.normals.push_back(glm::vec3(0.0, 0.0, 1.0));
         }
     }
 
-    // Create the mesh
-    MeshContainer mesh;
+    // Create the triangles
     for (int v = 0; v < _patchResolution - 1; ++v)
     {
         for (int u = 0; u < _patchResolution - 1; ++u)
         {
-            mesh.vertices.push_back(glm::vec4(vertices[u + v * _patchResolution], 0.0, 1.0));
-            mesh.vertices.push_back(glm::vec4(vertices[u + 1 + v * _patchResolution], 0.0, 1.0));
-            mesh.vertices.push_back(glm::vec4(vertices[u + (v + 1) * _patchResolution], 0.0, 1.0));
-
-            mesh.vertices.push_back(glm::vec4(vertices[u + 1 + v * _patchResolution], 0.0, 1.0));
-            mesh.vertices.push_back(glm::vec4(vertices[u + 1 + (v + 1) * _patchResolution], 0.0, 1.0));
-            mesh.vertices.push_back(glm::vec4(vertices[u + (v + 1) * _patchResolution], 0.0, 1.0));
+            mesh.indices.push_back(u + v * _patchResolution);
+            mesh.indices.push_back(u + 1 + v * _patchResolution);
+            mesh.indices.push_back(u + (v + 1) * _patchResolution);
 
-            mesh.uvs.push_back(uvs[u + v * _patchResolution]);
-            mesh.uvs.push_back(uvs[u + 1 + v * _patchResolution]);
-            mesh.uvs.push_back(uvs[u + (v + 1) * _patchResolution]);
-
-            mesh.uvs.push_back(uvs[u + 1 + v * _patchResolution]);
-            mesh.uvs.push_back(uvs[u + 1 + (v + 1) * _patchResolution]);
-            mesh.uvs.push_back(uvs[u + (v + 1) * _patchResolution]);
-
-            mesh.normals.push_back(glm::vec3(0.0, 0.0, 1.0));
-            mesh.normals.push_back(glm::vec3(0.0, 0.0, 1.0));
-            mesh.normals.push_back(glm::vec3(0.0, 0.0, 1.0));
-            mesh.normals.push_back(glm::vec3(0.0, 0.0, 1.0));
-            mesh.normals.push_back(glm::vec3(0.0, 0.0, 1.0));
-            mesh.normals.push_back(glm::vec3(0.0, 0.0, 1.0));
+            mesh.indices.push_back(u + 1 + v * _patchResolution);
+            mesh.indices.push_back(u + 1 + (v + 1) * _patchResolution);
+            mesh.indices.push_back(u + (v + 1) * _patchResolution);
         }
     }
 
@@ -71,23 +71,23 @@ void Mesh_Shmdata::onData(void* data, int data_size, void* user_data)
     int verticeNbr = *(intPtr++);
     int polyNbr = *(intPtr++);
 
-    vector<glm::vec4> vertices(verticeNbr);
-    vector<glm::vec2> uvs(verticeNbr);
-    vector<glm::vec3> normals(verticeNbr);
+    MeshContainer newMesh;
+    newMesh.vertices.resize(verticeNbr);
+    newMesh.uvs.resize(verticeNbr);
+    newMesh.normals.resize(verticeNbr);
 
     floatPtr += 2;
     // First, create the vertices with no UV, normals or faces
     for (int v = 0; v < verticeNbr; ++v)
     {
-        vertices[v] = glm::vec4(floatPtr[0], floatPtr[1], floatPtr[2], 1.f);
-        uvs[v] = glm::vec2(floatPtr[3], floatPtr[4]);
-        normals[v] = glm::vec3(floatPtr[5], floatPtr[6], floatPtr[7]);
+        newMesh.vertices[v] = glm::vec4(floatPtr[0], floatPtr[1], floatPtr[2], 1.f);
+        newMesh.uvs[v] = glm::vec2(floatPtr[3], floatPtr[4]);
+        newMesh.normals[v] = glm::vec3(floatPtr[5], floatPtr[6], floatPtr[7]);
         floatPtr += 8;
     }
 
     intPtr += 8 * verticeNbr;
-    // Then create the faces
-    MeshContainer newMesh;
+    // Then create the faces, as indices to the vertices
     for (int p = 0; p < polyNbr; ++p)
     {
         int size = *(intPtr++);
@@ -96,20 +96,12 @@ void Mesh_Shmdata::onData(void* data, int data_size, void* user_data)
         if (size >= 3)
         {
             for (int vert = 0; vert < 3; ++vert)
-            {
-                newMesh.vertices.push_back(vertices[*(intPtr + vert)]);
-                newMesh.uvs.push_back(uvs[*(intPtr + vert)]);
-                newMesh.normals.push_back(normals[*(intPtr + vert)]);
-            }
+                newMesh.indices.push_back(*(intPtr + vert));
         }
         if (size == 4)
         {
             for (int vert = 2; vert < 5; ++vert)
-            {
-                newMesh.vertices.push_back(vertices[*(intPtr + (vert % 4))]);
-                newMesh.uvs.push_back(uvs[*(intPtr + (vert % 4))]);
-                newMesh.normals.push_back(normals[*(intPtr + (vert % 4))]);
-            }
+                newMesh.indices.push_back(*(intPtr + (vert % 4)));
         }
 
         intPtr += size;
@@ -66,6 +66,9 @@ void Object::activate()
 
     _mutex.lock(); 
 
+    static auto colorHandle = Shader::getUniformHandle("_color");
+    static auto scaleHandle = Shader::getUniformHandle("_scale");
+
     for (auto& m : _blendMaps)
         m->update();
 
@@ -78,11 +81,13 @@ void Object::activate()
     }
 
     // Create and store the shader depending on its type
-    auto shaderIt = _graphicsShaders.find(_fill);
-    if (shaderIt == _graphicsShaders.end())
+    // Uniforms are part of the program state, so each context drawing this object gets its own shaders
+    auto& graphicsShaders = _graphicsShaders[glfwGetCurrentContext()];
+    auto shaderIt = graphicsShaders.find(_fill);
+    if (shaderIt == graphicsShaders.end())
     {
         _shader = make_shared<Shader>();
-        _graphicsShaders[_fill] = _shader;
+        graphicsShaders[_fill] = _shader;
     }
     else
     {
@@ -129,13 +134,12 @@ void Object::activate()
     else
     {
         _shader->setAttribute("fill", {_fill});
-        _shader->setAttribute("uniform", {"_color", _color.r, _color.g, _color.b, _color.a});
+        _shader->setUniform(colorHandle, glm::vec4(_color));
     }
 
     // Set some uniforms
     _shader->setAttribute("sideness", {_sideness});
-    _shader->setAttribute("uniform", {"_scale", _scale.x, _scale.y, _scale.z});
-    _shader->setAttribute("uniform", {"_normalExp", _normalExponent});
+    _shader->setUniform(scaleHandle, glm::vec3(_scale));
 
     if (_geometries.size() > 0)
     {
@@ -152,14 +156,8 @@ void Object::activate()
 
         // Get texture specific uniforms and send them to the shader
         auto texUniforms = t->getShaderUniforms();
-        for (auto u : texUniforms)
-        {
-            Values parameters;
-            parameters.push_back(Value(t->getPrefix() + to_string(texUnit) + "_" + u.first));
-            for (auto value : u.second)
-                parameters.push_back(value);
-            _shader->setAttribute("uniform", parameters);
-        }
+        for (auto& u : texUniforms)
+            _shader->setUniform(t->getPrefix() + to_string(texUnit) + "_" + u.first, u.second);
 
         texUnit++;
     }
@@ -229,7 +227,10 @@ void Object::draw()
         return;
 
     _shader->updateUniforms();
-    glDrawArrays(GL_TRIANGLES, 0, _geometries[0]->getVerticesNumber());
+    if (_geometries[0]->isIndexed())
+        glDrawElements(GL_TRIANGLES, _geometries[0]->getIndicesNumber(), GL_UNSIGNED_INT, (GLvoid*)_geometries[0]->getIndicesOffset());
+    else
+        glDrawArrays(GL_TRIANGLES, 0, _geometries[0]->getVerticesNumber());
 }
 
 /*************/
@@ -448,7 +449,7 @@ void Object::resetTessellation()
 
     for (auto& geom : _geometries)
     {
-        geom->useAlternativeBuffers(false);
+        geom->resetAlternativeBuffers();
     }
 }
 
@@ -576,6 +577,19 @@ void Object::setViewProjectionMatrix(const glm::dmat4& mv, const glm::dmat4& mp)
     _shader->setModelViewProjectionMatrix(mv * computeModelMatrix(), mp);
 }
 
+/*************/
+Object::UniformBlock Object::getUniformBlock(const glm::dmat4& mv, const glm::dmat4& mp) const
+{
+    auto modelView = mv * computeModelMatrix();
+
+    UniformBlock block;
+    block.modelViewProjectionMatrix = (glm::mat4)(mp * modelView);
+    block.normalMatrix = glm::transpose(glm::inverse((glm::mat4)modelView));
+    block.scale = (glm::vec3)_scale;
+    block.normalExp = _normalExponent;
+    return block;
+}
+
 /*************/
 void Object::registerAttributes()
 {
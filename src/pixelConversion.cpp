@@ -0,0 +1,394 @@
+#include "pixelConversion.h"
+
+#include <atomic>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+    #define SPLASH_PIXEL_CONVERSION_X86 1
+    #include <immintrin.h>
+#else
+    #define SPLASH_PIXEL_CONVERSION_X86 0
+#endif
+
+// BT.601 limited range coefficients, scaled by 2^15
+#define SPLASH_YUV_Y 38142
+#define SPLASH_YUV_RV 52298
+#define SPLASH_YUV_GU -12846
+#define SPLASH_YUV_GV -36641
+#define SPLASH_YUV_BU 66094
+
+using namespace std;
+
+namespace Splash
+{
+namespace PixelConversion
+{
+
+namespace
+{
+/*************/
+// Line kernels convert pixels from the start of a line, and return the number of pixels converted
+// The remaining pixels are converted by the scalar implementation
+typedef int (*I420LineKernel)(const uint8_t* y, const uint8_t* u, const uint8_t* v, int width, uint8_t* dst, int dstChannels);
+typedef int (*UyvyLineKernel)(const uint8_t* src, int width, uint8_t* dst, int dstChannels);
+typedef size_t (*RgbaKernel)(const uint8_t* src, size_t pixels, uint8_t* dst);
+
+atomic<int> currentIsa {-1};
+
+/*************/
+inline uint8_t clampComponent(int value)
+{
+    value >>= 15;
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+/*************/
+inline void yuvToPixel(int y, int u, int v, uint8_t* dst, int dstChannels)
+{
+    int yValue = (y - 16) * SPLASH_YUV_Y;
+    u -= 128;
+    v -= 128;
+    dst[0] = clampComponent(yValue + SPLASH_YUV_RV * v);
+    dst[1] = clampComponent(yValue + SPLASH_YUV_GU * u + SPLASH_YUV_GV * v);
+    dst[2] = clampComponent(yValue + SPLASH_YUV_BU * u);
+    if (dstChannels == 4)
+        dst[3] = 255;
+}
+
+/*************/
+void i420LineScalar(const uint8_t* y, const uint8_t* u, const uint8_t* v, int firstPixel, int width, uint8_t* dst, int dstChannels)
+{
+    for (int x = firstPixel; x < width; ++x)
+        yuvToPixel(y[x], u[x / 2], v[x / 2], dst + x * dstChannels, dstChannels);
+}
+
+/*************/
+void uyvyLineScalar(const uint8_t* src, int firstPixel, int width, uint8_t* dst, int dstChannels)
+{
+    for (int x = firstPixel; x < width; ++x)
+    {
+        const uint8_t* macropixel = src + (x / 2) * 4;
+        yuvToPixel(macropixel[1 + (x % 2) * 2], macropixel[0], macropixel[2], dst + x * dstChannels, dstChannels);
+    }
+}
+
+/*************/
+void rgbToRGBAScalar(const uint8_t* src, size_t firstPixel, size_t pixels, uint8_t* dst)
+{
+    for (size_t i = firstPixel; i < pixels; ++i)
+    {
+        dst[i * 4] = src[i * 3];
+        dst[i * 4 + 1] = src[i * 3 + 1];
+        dst[i * 4 + 2] = src[i * 3 + 2];
+        dst[i * 4 + 3] = 255;
+    }
+}
+
+#if SPLASH_PIXEL_CONVERSION_X86
+/*************/
+// SSE4.1 implementation, converting 4 pixels at once in 32 bits lanes
+__attribute__((target("sse4.1"))) inline __m128i yuvToRGBA4(__m128i y, __m128i u, __m128i v)
+{
+    y = _mm_mullo_epi32(_mm_sub_epi32(y, _mm_set1_epi32(16)), _mm_set1_epi32(SPLASH_YUV_Y));
+    u = _mm_sub_epi32(u, _mm_set1_epi32(128));
+    v = _mm_sub_epi32(v, _mm_set1_epi32(128));
+
+    auto r = _mm_add_epi32(y, _mm_mullo_epi32(v, _mm_set1_epi32(SPLASH_YUV_RV)));
+    auto g = _mm_add_epi32(y, _mm_add_epi32(_mm_mullo_epi32(u, _mm_set1_epi32(SPLASH_YUV_GU)), _mm_mullo_epi32(v, _mm_set1_epi32(SPLASH_YUV_GV))));
+    auto b = _mm_add_epi32(y, _mm_mullo_epi32(u, _mm_set1_epi32(SPLASH_YUV_BU)));
+
+    auto zero = _mm_setzero_si128();
+    auto max = _mm_set1_epi32(255);
+    r = _mm_min_epi32(_mm_max_epi32(_mm_srai_epi32(r, 15), zero), max);
+    g = _mm_min_epi32(_mm_max_epi32(_mm_srai_epi32(g, 15), zero), max);
+    b = _mm_min_epi32(_mm_max_epi32(_mm_srai_epi32(b, 15), zero), max);
+
+    return _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)), _mm_or_si128(_mm_slli_epi32(b, 16), _mm_set1_epi32(0xFF000000)));
+}
+
+/*************/
+__attribute__((target("sse4.1"))) inline void storePixels4(__m128i pixels, uint8_t* dst, int dstChannels)
+{
+    if (dstChannels == 4)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), pixels);
+    }
+    else
+    {
+        // Drop the alpha, and write exactly 12 bytes
+        pixels = _mm_shuffle_epi8(pixels, _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst), pixels);
+        auto last = _mm_cvtsi128_si32(_mm_srli_si128(pixels, 8));
+        memcpy(dst + 8, &last, 4);
+    }
+}
+
+/*************/
+__attribute__((target("sse4.1"))) int i420LineSSE41(const uint8_t* y, const uint8_t* u, const uint8_t* v, int width, uint8_t* dst, int dstChannels)
+{
+    int x = 0;
+    for (; x + 4 <= width; x += 4)
+    {
+        int32_t yBytes;
+        uint16_t uBytes, vBytes;
+        memcpy(&yBytes, y + x, 4);
+        memcpy(&uBytes, u + x / 2, 2);
+        memcpy(&vBytes, v + x / 2, 2);
+
+        // Chroma samples are duplicated for each pair of pixels
+        auto yValues = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(yBytes));
+        auto uValues = _mm_cvtsi32_si128(uBytes);
+        uValues = _mm_cvtepu8_epi32(_mm_unpacklo_epi8(uValues, uValues));
+        auto vValues = _mm_cvtsi32_si128(vBytes);
+        vValues = _mm_cvtepu8_epi32(_mm_unpacklo_epi8(vValues, vValues));
+
+        storePixels4(yuvToRGBA4(yValues, uValues, vValues), dst + x * dstChannels, dstChannels);
+    }
+    return x;
+}
+
+/*************/
+__attribute__((target("sse4.1"))) int uyvyLineSSE41(const uint8_t* src, int width, uint8_t* dst, int dstChannels)
+{
+    auto yMask = _mm_setr_epi8(1, -1, -1, -1, 3, -1, -1, -1, 5, -1, -1, -1, 7, -1, -1, -1);
+    auto uMask = _mm_setr_epi8(0, -1, -1, -1, 0, -1, -1, -1, 4, -1, -1, -1, 4, -1, -1, -1);
+    auto vMask = _mm_setr_epi8(2, -1, -1, -1, 2, -1, -1, -1, 6, -1, -1, -1, 6, -1, -1, -1);
+
+    int x = 0;
+    for (; x + 4 <= width; x += 4)
+    {
+        auto macropixels = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + x * 2));
+        auto pixels = yuvToRGBA4(_mm_shuffle_epi8(macropixels, yMask), _mm_shuffle_epi8(macropixels, uMask), _mm_shuffle_epi8(macropixels, vMask));
+        storePixels4(pixels, dst + x * dstChannels, dstChannels);
+    }
+    return x;
+}
+
+/*************/
+__attribute__((target("sse4.1"))) size_t rgbToRGBASSE41(const uint8_t* src, size_t pixels, uint8_t* dst)
+{
+    auto mask = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    auto alpha = _mm_set1_epi32(0xFF000000);
+
+    // Loads are 16 bytes wide for 12 bytes used, so the last pixels are left to the scalar implementation
+    size_t i = 0;
+    for (; i + 6 <= pixels; i += 4)
+    {
+        auto rgb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(rgb, mask), alpha));
+    }
+    return i;
+}
+
+/*************/
+// AVX2 implementation, converting 8 pixels at once
+__attribute__((target("avx2"))) inline __m256i yuvToRGBA8(__m256i y, __m256i u, __m256i v)
+{
+    y = _mm256_mullo_epi32(_mm256_sub_epi32(y, _mm256_set1_epi32(16)), _mm256_set1_epi32(SPLASH_YUV_Y));
+    u = _mm256_sub_epi32(u, _mm256_set1_epi32(128));
+    v = _mm256_sub_epi32(v, _mm256_set1_epi32(128));
+
+    auto r = _mm256_add_epi32(y, _mm256_mullo_epi32(v, _mm256_set1_epi32(SPLASH_YUV_RV)));
+    auto g = _mm256_add_epi32(y, _mm256_add_epi32(_mm256_mullo_epi32(u, _mm256_set1_epi32(SPLASH_YUV_GU)), _mm256_mullo_epi32(v, _mm256_set1_epi32(SPLASH_YUV_GV))));
+    auto b = _mm256_add_epi32(y, _mm256_mullo_epi32(u, _mm256_set1_epi32(SPLASH_YUV_BU)));
+
+    auto zero = _mm256_setzero_si256();
+    auto max = _mm256_set1_epi32(255);
+    r = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(r, 15), zero), max);
+    g = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(g, 15), zero), max);
+    b = _mm256_min_epi32(_mm256_max_epi32(_mm256_srai_epi32(b, 15), zero), max);
+
+    return _mm256_or_si256(_mm256_or_si256(r, _mm256_slli_epi32(g, 8)), _mm256_or_si256(_mm256_slli_epi32(b, 16), _mm256_set1_epi32(0xFF000000)));
+}
+
+/*************/
+__attribute__((target("avx2"))) inline void storePixels8(__m256i pixels, uint8_t* dst, int dstChannels)
+{
+    if (dstChannels == 4)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), pixels);
+    }
+    else
+    {
+        storePixels4(_mm256_castsi256_si128(pixels), dst, 3);
+        storePixels4(_mm256_extracti128_si256(pixels, 1), dst + 12, 3);
+    }
+}
+
+/*************/
+__attribute__((target("avx2"))) int i420LineAVX2(const uint8_t* y, const uint8_t* u, const uint8_t* v, int width, uint8_t* dst, int dstChannels)
+{
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        int32_t uBytes, vBytes;
+        memcpy(&uBytes, u + x / 2, 4);
+        memcpy(&vBytes, v + x / 2, 4);
+
+        auto yValues = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(y + x)));
+        auto uValues = _mm_cvtsi32_si128(uBytes);
+        auto vValues = _mm_cvtsi32_si128(vBytes);
+
+        auto pixels = yuvToRGBA8(yValues, _mm256_cvtepu8_epi32(_mm_unpacklo_epi8(uValues, uValues)), _mm256_cvtepu8_epi32(_mm_unpacklo_epi8(vValues, vValues)));
+        storePixels8(pixels, dst + x * dstChannels, dstChannels);
+    }
+    return x + i420LineSSE41(y + x, u + x / 2, v + x / 2, width - x, dst + x * dstChannels, dstChannels);
+}
+
+/*************/
+__attribute__((target("avx2"))) int uyvyLineAVX2(const uint8_t* src, int width, uint8_t* dst, int dstChannels)
+{
+    // Shuffles are done in each 128 bits lane, holding 4 pixels each
+    auto yMask = _mm256_broadcastsi128_si256(_mm_setr_epi8(1, -1, -1, -1, 3, -1, -1, -1, 5, -1, -1, -1, 7, -1, -1, -1));
+    auto uMask = _mm256_broadcastsi128_si256(_mm_setr_epi8(0, -1, -1, -1, 0, -1, -1, -1, 4, -1, -1, -1, 4, -1, -1, -1));
+    auto vMask = _mm256_broadcastsi128_si256(_mm_setr_epi8(2, -1, -1, -1, 2, -1, -1, -1, 6, -1, -1, -1, 6, -1, -1, -1));
+
+    int x = 0;
+    for (; x + 8 <= width; x += 8)
+    {
+        auto macropixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 2));
+        auto lanes = _mm256_inserti128_si256(_mm256_castsi128_si256(macropixels), _mm_srli_si128(macropixels, 8), 1);
+        auto pixels = yuvToRGBA8(_mm256_shuffle_epi8(lanes, yMask), _mm256_shuffle_epi8(lanes, uMask), _mm256_shuffle_epi8(lanes, vMask));
+        storePixels8(pixels, dst + x * dstChannels, dstChannels);
+    }
+    return x + uyvyLineSSE41(src + x * 2, width - x, dst + x * dstChannels, dstChannels);
+}
+
+/*************/
+__attribute__((target("avx2"))) size_t rgbToRGBAAVX2(const uint8_t* src, size_t pixels, uint8_t* dst)
+{
+    auto mask = _mm256_broadcastsi128_si256(_mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1));
+    auto alpha = _mm256_set1_epi32(0xFF000000);
+
+    size_t i = 0;
+    for (; i + 10 <= pixels; i += 8)
+    {
+        auto low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+        auto high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3 + 12));
+        auto rgb = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(rgb, mask), alpha));
+    }
+    return i + rgbToRGBASSE41(src + i * 3, pixels - i, dst + i * 4);
+}
+#endif
+
+/*************/
+Isa detectIsa()
+{
+#if SPLASH_PIXEL_CONVERSION_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return Isa::AVX2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return Isa::SSE41;
+#endif
+    return Isa::Scalar;
+}
+
+/*************/
+bool isSupported(Isa isa)
+{
+    return static_cast<int>(isa) <= static_cast<int>(detectIsa());
+}
+} // end of anonymous namespace
+
+/*************/
+Isa getIsa()
+{
+    auto isa = currentIsa.load(memory_order_relaxed);
+    if (isa < 0)
+    {
+        isa = static_cast<int>(detectIsa());
+        currentIsa.store(isa, memory_order_relaxed);
+    }
+    return static_cast<Isa>(isa);
+}
+
+/*************/
+bool setIsa(Isa isa)
+{
+    if (!isSupported(isa))
+        return false;
+    currentIsa.store(static_cast<int>(isa), memory_order_relaxed);
+    return true;
+}
+
+/*************/
+string getIsaName(Isa isa)
+{
+    switch (isa)
+    {
+    default:
+    case Isa::Scalar:
+        return "scalar";
+    case Isa::SSE41:
+        return "SSE4.1";
+    case Isa::AVX2:
+        return "AVX2";
+    }
+}
+
+/*************/
+void i420ToRGB(const uint8_t* y, const uint8_t* u, const uint8_t* v, int width, uint8_t* dst, int dstChannels, int firstLine, int lastLine)
+{
+    I420LineKernel kernel = nullptr;
+#if SPLASH_PIXEL_CONVERSION_X86
+    auto isa = getIsa();
+    if (isa == Isa::AVX2)
+        kernel = i420LineAVX2;
+    else if (isa == Isa::SSE41)
+        kernel = i420LineSSE41;
+#endif
+
+    for (int line = firstLine; line < lastLine; ++line)
+    {
+        auto yLine = y + line * width;
+        auto uLine = u + (line / 2) * (width / 2);
+        auto vLine = v + (line / 2) * (width / 2);
+        auto dstLine = dst + line * width * dstChannels;
+
+        int x = kernel ? kernel(yLine, uLine, vLine, width, dstLine, dstChannels) : 0;
+        i420LineScalar(yLine, uLine, vLine, x, width, dstLine, dstChannels);
+    }
+}
+
+/*************/
+void uyvyToRGB(const uint8_t* src, int width, uint8_t* dst, int dstChannels, int firstLine, int lastLine)
+{
+    UyvyLineKernel kernel = nullptr;
+#if SPLASH_PIXEL_CONVERSION_X86
+    auto isa = getIsa();
+    if (isa == Isa::AVX2)
+        kernel = uyvyLineAVX2;
+    else if (isa == Isa::SSE41)
+        kernel = uyvyLineSSE41;
+#endif
+
+    for (int line = firstLine; line < lastLine; ++line)
+    {
+        auto srcLine = src + line * width * 2;
+        auto dstLine = dst + line * width * dstChannels;
+
+        int x = kernel ? kernel(srcLine, width, dstLine, dstChannels) : 0;
+        uyvyLineScalar(srcLine, x, width, dstLine, dstChannels);
+    }
+}
+
+/*************/
+void rgbToRGBA(const uint8_t* src, size_t pixels, uint8_t* dst)
+{
+    RgbaKernel kernel = nullptr;
+#if SPLASH_PIXEL_CONVERSION_X86
+    auto isa = getIsa();
+    if (isa == Isa::AVX2)
+        kernel = rgbToRGBAAVX2;
+    else if (isa == Isa::SSE41)
+        kernel = rgbToRGBASSE41;
+#endif
+
+    size_t i = kernel ? kernel(src, pixels, dst) : 0;
+    rgbToRGBAScalar(src, i, pixels, dst);
+}
+
+} // end of namespace
+} // end of namespace
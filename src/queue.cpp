@@ -10,10 +10,12 @@
     #include "image_shmdata.h"
 #endif
 #include "log.h"
+#include "threadpool.h"
 #include "timer.h"
 #include "world.h"
 
 #define DISTANT_NAME_SUFFIX "_source"
+#define NEXT_SOURCE_NAME_SUFFIX "_nextSource"
 
 using namespace std;
 
@@ -39,6 +41,11 @@ Queue::Queue(RootObjectWeakPtr root)
 /*************/
 Queue::~Queue()
 {
+    dropNextSource();
+
+    // Opening tasks use this object until they are done
+    unique_lock<mutex> lock(_openingMutex);
+    _openingCondition.wait(lock, [&]() {return _openingCount == 0;});
 }
 
 /*************/
@@ -117,7 +124,7 @@ void Queue::update()
         }
 
         _currentSourceIndex = sourceIndex;
-        _currentSource.reset();
+        releaseSource(_currentSource);
         
         if (sourceIndex >= _playlist.size())
         {
@@ -126,26 +133,89 @@ void Queue::update()
         }
         else
         {
-            _currentSource = createSource(_playlist[_currentSourceIndex].type);
+            // Use the source opened ahead of time if it is the right one
+            if (_nextSourceIndex == _currentSourceIndex && _nextSource)
+            {
+                {
+                    unique_lock<mutex> lock(_nextSource->mutex);
+                    _nextSource->condition.wait(lock, [&]() {return _nextSource->isDone;});
+                    _currentSource = _nextSource->source;
+                }
+                _nextSource.reset();
+                _nextSourceIndex = -1;
+
+                // The source name is the one looked up for direct uploads
+                if (_currentSource)
+                    _currentSource->setName(_name + DISTANT_NAME_SUFFIX);
+            }
+            else
+            {
+                _currentSource = openSource(_playlist[_currentSourceIndex], _name + DISTANT_NAME_SUFFIX, _useClock, false);
+            }
 
             if (_currentSource)
                 _playing = true;
             else
                 _currentSource = make_shared<Image>(_root);
 
-            _currentSource->setAttribute("file", {_playlist[_currentSourceIndex].filename});
+            _currentSource->setAttribute("pause", {(int)_paused});
+
+            _world.lock()->sendMessage(_name, "source", {_playlist[_currentSourceIndex].type});
+
+            Log::get() << Log::MESSAGE << "Queue::" << __FUNCTION__ << " - Playing file: " << _playlist[_currentSourceIndex].filename << Log::endl;
+        }
+    }
+
+    // Open the next source ahead of time, so that it is decoded and paused
+    // on its first frame when its start time is reached
+    if (_preloadTime > 0.f && _currentSourceIndex < (int32_t)_playlist.size())
+    {
+        int32_t nextIndex = _currentSourceIndex + 1;
+        int64_t nextStart = 0;
+        if (nextIndex < (int32_t)_playlist.size())
+            nextStart = _playlist[nextIndex].start;
+        else if (!_useClock && _loop)
+        {
+            nextIndex = 0;
+            nextStart = _playlist.back().stop;
+        }
+        else
+            nextIndex = -1;
+
+        if (nextIndex != -1 && nextIndex != _currentSourceIndex && nextIndex != _nextSourceIndex && nextStart - _currentTime <= (int64_t)(_preloadTime * 1e6))
+        {
+            dropNextSource();
+
+            _nextSourceIndex = nextIndex;
+            auto source = _playlist[nextIndex];
+            auto name = _name + NEXT_SOURCE_NAME_SUFFIX;
+            auto useClock = _useClock;
+            auto nextSource = make_shared<PreparedSource>();
+            _nextSource = nextSource;
 
-            if (_useClock)
             {
-                // If we use the master clock, set a timeshift to be correctly placed in the video
-                // (as the source gets its clock from the same Timer)
-                _currentSource->setAttribute("timeShift", {-(float)_playlist[_currentSourceIndex].start / 1e6});
-                _currentSource->setAttribute("useClock", {1});
+                lock_guard<mutex> lock(_openingMutex);
+                ++_openingCount;
             }
 
-            _world.lock()->sendMessage(_name, "source", {_playlist[_currentSourceIndex].type});
+            SThread::pool.enqueueWithoutId([=]() {
+                auto object = openSource(source, name, useClock, true);
 
-            Log::get() << Log::MESSAGE << "Queue::" << __FUNCTION__ << " - Playing file: " << _playlist[_currentSourceIndex].filename << Log::endl;
+                {
+                    lock_guard<mutex> lock(nextSource->mutex);
+                    if (!nextSource->isCancelled)
+                        nextSource->source = object;
+                    nextSource->isDone = true;
+                    nextSource->condition.notify_all();
+                }
+
+                // A dropped source is released here, as nobody waits for it
+                object.reset();
+
+                lock_guard<mutex> lock(_openingMutex);
+                --_openingCount;
+                _openingCondition.notify_all();
+            });
         }
     }
 
@@ -265,7 +335,7 @@ void Queue::cleanPlaylist(vector<Source>& playlist)
 }
 
 /*************/
-shared_ptr<BufferObject> Queue::createSource(string type)
+shared_ptr<BufferObject> Queue::createSource(string type, const string& name)
 {
     auto source = shared_ptr<BufferObject>();
 
@@ -293,10 +363,65 @@ shared_ptr<BufferObject> Queue::createSource(string type)
         return {};
     }
 
-    source->setName(_name + "_source");
+    source->setName(name);
     return source;
 }
 
+/*************/
+shared_ptr<BufferObject> Queue::openSource(const Source& source, const string& name, bool useClock, bool paused)
+{
+    auto object = createSource(source.type, name);
+    if (!object)
+        return {};
+
+    if (paused)
+        object->setAttribute("pause", {1});
+
+    object->setAttribute("file", {source.filename});
+
+    if (useClock)
+    {
+        // If we use the master clock, set a timeshift to be correctly placed in the video
+        // (as the source gets its clock from the same Timer)
+        object->setAttribute("timeShift", {-(float)source.start / 1e6});
+        object->setAttribute("useClock", {1});
+    }
+
+    return object;
+}
+
+/*************/
+void Queue::dropNextSource()
+{
+    _nextSourceIndex = -1;
+    if (!_nextSource)
+        return;
+
+    // If the source is still opening, its task releases it once done
+    shared_ptr<BufferObject> source;
+    {
+        lock_guard<mutex> lock(_nextSource->mutex);
+        _nextSource->isCancelled = true;
+        std::swap(source, _nextSource->source);
+    }
+    _nextSource.reset();
+    releaseSource(source);
+}
+
+/*************/
+void Queue::releaseSource(shared_ptr<BufferObject>& source)
+{
+    if (!source)
+        return;
+
+    // Destroying a video source joins its threads, which would stall the update loop
+    auto previousSource = make_shared<shared_ptr<BufferObject>>();
+    std::swap(*previousSource, source);
+    SThread::pool.enqueueWithoutId([=]() {
+        previousSource->reset();
+    });
+}
+
 /*************/
 void Queue::registerAttributes()
 {
@@ -342,6 +467,7 @@ void Queue::registerAttributes()
         }
 
         cleanPlaylist(_playlist);
+        dropNextSource();
 
         return true;
     }, [&]() -> Values {
@@ -366,6 +492,15 @@ void Queue::registerAttributes()
     setAttributeParameter("playlist", true, true);
     setAttributeDescription("playlist", "Set the playlist as an array of [type, filename, start, end, (args)]");
 
+    addAttribute("preloadTime", [&](const Values& args) {
+        _preloadTime = std::max(0.f, args[0].asFloat());
+        return true;
+    }, [&]() -> Values {
+        return {_preloadTime};
+    }, {'n'});
+    setAttributeParameter("preloadTime", true, true);
+    setAttributeDescription("preloadTime", "Time (in seconds) before its start at which the next source is opened and decoded, 0 to disable");
+
     addAttribute("seek", [&](const Values& args) {
         int64_t seekTime = args[0].asFloat() * 1e6;
         _startTime = Timer::getTime() - seekTime;
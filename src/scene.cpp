@@ -1,5 +1,6 @@
 #include "scene.h"
 
+#include <unordered_set>
 #include <utility>
 
 #include "./camera.h"
@@ -16,6 +17,7 @@
 #include "./texture_image.h"
 #include "./threadpool.h"
 #include "./timer.h"
+#include "./tracer.h"
 #include "./warp.h"
 #include "./window.h"
 
@@ -48,6 +50,8 @@ Scene::Scene(std::string name, bool autoRun)
     _type = "scene";
     _isRunning = true;
     _name = name;
+    // A Scene not run right away is the inner Scene of a World, which counts the frames of the tracer
+    _isTraceFrameCounter = autoRun;
     _factory = unique_ptr<Factory>(new Factory(_self));
 
     registerAttributes();
@@ -490,9 +494,16 @@ void Scene::render()
     bool isError {false};
     vector<unsigned int> threadIds;
 
+    if (_isTraceFrameCounter)
+        Tracer::get().nextFrame();
+    Tracer::Scope traceRender("render");
+
     // Compute the blending
     Timer::get() << "blending";
-    renderBlending();
+    {
+        Tracer::Scope trace("blending");
+        renderBlending();
+    }
     Timer::get() >> "blending";
 
     unique_lock<mutex> lockTexture(_textureUploadMutex);
@@ -516,46 +527,265 @@ void Scene::render()
     glWaitSync(_textureUploadFence, 0, GL_TIMEOUT_IGNORED);
     glDeleteSync(_textureUploadFence);
 
+    // Uploads are prevented, so the frames in the textures are those the cameras render
+    // Each frame with a known provenance is measured the first time it is rendered
+    _latencyFrames.clear();
+    if (_measureLatency)
+    {
+        for (auto& obj : _objects)
+        {
+            auto texImage = dynamic_pointer_cast<Texture_Image>(obj.second);
+            if (!texImage || texImage->getFrameTimestamp() < 0)
+                continue;
+
+            auto source = texImage->getFrameSource();
+            auto& lastIndex = _latencyFrameIndices[source];
+            if (texImage->getFrameIndex() == lastIndex)
+                continue;
+            lastIndex = texImage->getFrameIndex();
+            _latencyFrames.push_back(make_pair(source, texImage->getFrameTimestamp()));
+        }
+    }
+
+    // When rendering windows in parallel, the cameras and warps used by a single window are rendered along with it
+    vector<WindowRenderJob> windowJobs;
+    if (_parallelWindows)
+        windowJobs = getWindowRenderJobs();
+
+    auto isRenderedByWindow = [&](const BaseObjectPtr& obj) -> bool {
+        for (auto& job : windowJobs)
+            if (find(job.cameras.begin(), job.cameras.end(), obj) != job.cameras.end() || find(job.warps.begin(), job.warps.end(), obj) != job.warps.end())
+                return true;
+        return false;
+    };
+
     for (auto& obj : _objects)
-        if (obj.second->getType() == "camera")
+        if (obj.second->getType() == "camera" && !isRenderedByWindow(obj.second))
+        {
+            Tracer::Scope trace("camera render", obj.second->getTraceName());
             isError |= dynamic_pointer_cast<Camera>(obj.second)->render();
+        }
     Timer::get() >> "cameras";
 
-    _cameraDrawnFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    if (windowJobs.empty())
+        _cameraDrawnFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
 
     Timer::get() << "warps";
     for (auto& obj : _objects)
-        if (obj.second->getType() == "warp")
+        if (obj.second->getType() == "warp" && !isRenderedByWindow(obj.second))
+        {
+            Tracer::Scope trace("warp", obj.second->getTraceName());
             dynamic_pointer_cast<Warp>(obj.second)->update();
+        }
     Timer::get() >> "warps";
 
-    lockTexture.unlock(); // Unlock _textureUploadMutex
+    if (windowJobs.empty())
+        lockTexture.unlock(); // Unlock _textureUploadMutex
 
     // Update the gui
     Timer::get() << "gui";
     if (_gui != nullptr)
+    {
+        Tracer::Scope trace("gui");
         isError |= _gui->render();
+    }
     Timer::get() >> "gui";
 
     // Update the windows
     Timer::get() << "windows";
-    glFinish();
-    for (auto& obj : _objects)
-        if (obj.second->getType() == "window")
-            isError |= dynamic_pointer_cast<Window>(obj.second)->render();
+    if (windowJobs.empty())
+    {
+        {
+            Tracer::Scope trace("finish");
+            glFinish();
+        }
+        for (auto& obj : _objects)
+            if (obj.second->getType() == "window")
+            {
+                Tracer::Scope trace("window blit", obj.second->getTraceName());
+                isError |= dynamic_pointer_cast<Window>(obj.second)->render();
+            }
+    }
+    else
+    {
+        // Geometries drawn by the windows are uploaded to beforehand, and are left untouched until all windows are rendered
+        for (auto& job : windowJobs)
+            for (auto& geometry : job.geometries)
+            {
+                geometry->update();
+                geometry->setUploadLocked(true);
+            }
+
+        // Each window waits for what has been rendered in the main context, instead of a glFinish
+        auto mainFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+
+        TaskGroup windowTasks;
+        for (auto& job : windowJobs)
+        {
+            auto jobPtr = &job;
+            windowTasks.run([=]() {
+                Tracer::Scope trace("window render", jobPtr->window->getTraceName());
+                jobPtr->window->setAsCurrentContext();
+                glWaitSync(mainFence, 0, GL_TIMEOUT_IGNORED);
+
+                for (auto& camera : jobPtr->cameras)
+                    jobPtr->isError |= camera->render();
+                for (auto& warp : jobPtr->warps)
+                    warp->update();
+                jobPtr->isError |= jobPtr->window->render();
+
+                jobPtr->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                glFlush();
+                jobPtr->window->releaseContext();
+            });
+        }
+        windowTasks.wait();
+        glDeleteSync(mainFence);
+
+        for (auto& job : windowJobs)
+            for (auto& geometry : job.geometries)
+                geometry->setUploadLocked(false);
+
+        // The texture upload waits for all windows to be rendered, through the main context
+        for (auto& job : windowJobs)
+        {
+            glWaitSync(job.fence, 0, GL_TIMEOUT_IGNORED);
+            glDeleteSync(job.fence);
+            isError |= job.isError;
+        }
+        _cameraDrawnFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        lockTexture.unlock(); // Unlock _textureUploadMutex
+    }
     Timer::get() >> "windows";
 
     // Swap all buffers at once
     Timer::get() << "swap";
     for (auto& obj : _objects)
         if (obj.second->getType() == "window")
+        {
+            Tracer::Scope trace("swap", obj.second->getTraceName());
             dynamic_pointer_cast<Window>(obj.second)->swapBuffers();
+        }
     Timer::get() >> "swap";
+
+    // The latency goes from the capture or decoding of the frame to the swap of the windows showing it
+    // The delay of the display itself is not included
+    if (!_latencyFrames.empty())
+    {
+        auto swapTime = Timer::getTime();
+        for (auto& frame : _latencyFrames)
+            Timer::get().setDuration("latency " + frame.first, swapTime - frame.second);
+        _latencyFrames.clear();
+    }
+}
+
+/*************/
+vector<Scene::WindowRenderJob> Scene::getWindowRenderJobs()
+{
+    vector<WindowRenderJob> jobs;
+    unordered_map<BaseObjectPtr, int> users;
+    for (auto& obj : _objects)
+    {
+        if (obj.second->getType() != "window")
+            continue;
+
+        WindowRenderJob job;
+        job.window = dynamic_pointer_cast<Window>(obj.second);
+        for (auto& linked : job.window->getLinkedObjects())
+        {
+            if (linked->getType() == "camera")
+                job.cameras.push_back(dynamic_pointer_cast<Camera>(linked));
+            else if (linked->getType() == "warp")
+                job.warps.push_back(dynamic_pointer_cast<Warp>(linked));
+            else
+                continue;
+            users[linked]++;
+        }
+        jobs.push_back(job);
+    }
+
+    // Parallel rendering is only worth it with more than one window
+    if (jobs.size() < 2)
+        return {};
+
+    // Objects shown in more than one window are rendered beforehand in the main context, as well as
+    // the warps shown in no window. Cameras read by those warps have to be rendered there too
+    unordered_set<BaseObjectPtr> sharedObjects;
+    for (auto& obj : _objects)
+    {
+        auto type = obj.second->getType();
+        if (type != "camera" && type != "warp")
+            continue;
+
+        auto userIt = users.find(obj.second);
+        if (userIt != users.end() && userIt->second < 2)
+            continue;
+
+        sharedObjects.insert(obj.second);
+        if (type == "warp")
+            for (auto& linked : obj.second->getLinkedObjects())
+                sharedObjects.insert(linked);
+    }
+
+    // A warp is rendered by its window only along with the cameras it reads from. Otherwise it is
+    // rendered in the main context, and so must be its cameras, which may in turn move other warps
+    bool hasChanged = true;
+    while (hasChanged)
+    {
+        hasChanged = false;
+        for (auto& job : jobs)
+        {
+            job.cameras.erase(remove_if(job.cameras.begin(), job.cameras.end(), [&](const CameraPtr& camera) {
+                return sharedObjects.find(camera) != sharedObjects.end();
+            }), job.cameras.end());
+
+            for (auto warpIt = job.warps.begin(); warpIt != job.warps.end();)
+            {
+                auto linkedObjects = (*warpIt)->getLinkedObjects();
+                bool isShared = sharedObjects.find(*warpIt) != sharedObjects.end();
+                for (auto& linked : linkedObjects)
+                    isShared |= find(job.cameras.begin(), job.cameras.end(), linked) == job.cameras.end();
+
+                if (!isShared)
+                {
+                    ++warpIt;
+                    continue;
+                }
+
+                sharedObjects.insert(*warpIt);
+                for (auto& linked : linkedObjects)
+                    hasChanged |= sharedObjects.insert(linked).second;
+                warpIt = job.warps.erase(warpIt);
+            }
+        }
+    }
+
+    // Objects are drawn from as many contexts as needed, but the buffers of their geometries are only
+    // uploaded to from the main context, where their streamed buffers are fenced
+    for (auto& job : jobs)
+        for (auto& camera : job.cameras)
+            for (auto& object : camera->getLinkedObjects())
+            {
+                if (object->getType() != "object")
+                    continue;
+                for (auto& linked : object->getLinkedObjects())
+                {
+                    auto geometry = dynamic_pointer_cast<Geometry>(linked);
+                    if (geometry)
+                        job.geometries.push_back(geometry);
+                }
+            }
+
+    return jobs;
 }
 
 /*************/
 void Scene::run()
 {
+    Tracer::get().setThreadName("Scene " + _name + " render");
+
     while (_isRunning)
     {
         {
@@ -583,6 +813,13 @@ void Scene::run()
         }
 
         Timer::get() >> "sceneLoop";
+
+        // Log the tail latencies once in a while, as a single slow frame is lost in the last durations
+        if (_timingLogPeriod > 0 && Timer::getTime() - _lastTimingLog > (int64_t)_timingLogPeriod * 1000000)
+        {
+            _lastTimingLog = Timer::getTime();
+            Log::get() << Log::MESSAGE << "Scene::" << __FUNCTION__ << " - " << _name << " timings (ms): " << Timer::get().getStatisticsSummary() << Log::endl;
+        }
     }
 }
 
@@ -705,6 +942,8 @@ void Scene::updateInputs()
 /*************/
 void Scene::textureUploadRun()
 {
+    Tracer::get().setThreadName("Scene " + _name + " texture upload");
+
     while (_isRunning)
     {
         if (!_started)
@@ -725,9 +964,13 @@ void Scene::textureUploadRun()
         glDeleteSync(_cameraDrawnFence);
 
         Timer::get() << "textureUpload";
+        Tracer::Scope traceUpload("texture upload");
         for (auto& obj : _objects)
             if (obj.second->getType().find("texture") != string::npos)
+            {
+                Tracer::Scope trace("texture update", obj.second->getTraceName());
                 dynamic_pointer_cast<Texture>(obj.second)->update();
+            }
         _textureUploadFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
         lockTexture.unlock();
 
@@ -1504,6 +1747,51 @@ void Scene::registerAttributes()
     });
     setAttributeDescription("quit", "Ask the Scene to quit");
    
+    addAttribute("tracing", [&](const Values& args) {
+        Tracer::get().setEnabled(args[0].asInt() != 0);
+        return true;
+    }, {'n'});
+    setAttributeDescription("tracing", "Record the timings of each step of the rendering if set to 1, to be exported with exportTrace");
+
+    addAttribute("parallelWindows", [&](const Values& args) {
+        addTask([=]() {
+            _parallelWindows = args[0].asInt() != 0;
+        });
+        return true;
+    }, [&]() -> Values {
+        return {_parallelWindows};
+    }, {'n'});
+    setAttributeDescription("parallelWindows", "If set to 1, render each window from its own thread and context, along with the cameras it is the only one to show");
+
+    addAttribute("measureLatency", [&](const Values& args) {
+        addTask([=]() {
+            _measureLatency = args[0].asInt() != 0;
+            _latencyFrameIndices.clear();
+        });
+        return true;
+    }, [&]() -> Values {
+        return {_measureLatency};
+    }, {'n'});
+    setAttributeDescription("measureLatency", "If set to 1, measure the latency of each source, from the capture or decoding of its frames to the swap of the windows. Available as the \"latency [source]\" timings");
+
+    addAttribute("timingLogPeriod", [&](const Values& args) {
+        _timingLogPeriod = std::max(0, args[0].asInt());
+        return true;
+    }, [&]() -> Values {
+        return {_timingLogPeriod};
+    }, {'n'});
+    setAttributeDescription("timingLogPeriod", "Period, in seconds, at which the percentiles of all timings are logged. 0 to disable");
+
+    addAttribute("exportTrace", [&](const Values& args) {
+        // Without a path, the World is asked to export the traces of all processes
+        if (args.size() == 0)
+            sendMessageToWorld("exportTrace", {});
+        else
+            Tracer::get().exportChromeTrace(args[0].asString() + "_" + _name + ".json", "Scene " + _name);
+        return true;
+    });
+    setAttributeDescription("exportTrace", "Export the recorded timings to [path]_[scene name].json, in the Chrome trace format. Without a path, the traces of all processes are exported");
+
     addAttribute("unlink", [&](const Values& args) {
         addTask([=]() {
             string src = args[0].asString();
@@ -1549,7 +1837,7 @@ void Scene::registerAttributes()
             return false;
         // This needs to be launched in another thread, as the set mutex is already locked
         // (and we will need it later)
-        SThread::pool.enqueue([&]() {
+        SThread::pool.enqueueWithoutId([&]() {
             _colorCalibrator->update();
         });
         return true;
@@ -1561,7 +1849,7 @@ void Scene::registerAttributes()
             return false;
         // This needs to be launched in another thread, as the set mutex is already locked
         // (and we will need it later)
-        SThread::pool.enqueue([&]() {
+        SThread::pool.enqueueWithoutId([&]() {
             _colorCalibrator->updateCRF();
         });
         return true;
@@ -14,6 +14,61 @@ using namespace std;
 
 namespace Splash {
 
+namespace {
+// Uniform names are shared by all shaders, and each of them is given a handle
+struct UniformRegistry
+{
+    mutex lock;
+    unordered_map<string, int> handles;
+    vector<string> names;
+};
+
+UniformRegistry& getUniformRegistry()
+{
+    static UniformRegistry registry;
+    return registry;
+}
+
+// Uniform blocks filled by other objects, bound to a dedicated binding point
+const unordered_map<string, GLuint> externalBlockBindings {{"_cameraBlock", Shader::cameraBlockBinding}, {"_objectBlock", Shader::objectBlockBinding}};
+
+/*************/
+GLenum getUniformTypeFromString(const string& type)
+{
+    static const unordered_map<string, GLenum> types {{"int", GL_INT}, {"float", GL_FLOAT}, {"vec2", GL_FLOAT_VEC2}, {"vec3", GL_FLOAT_VEC3}, {"vec4", GL_FLOAT_VEC4},
+        {"ivec2", GL_INT_VEC2}, {"ivec3", GL_INT_VEC3}, {"ivec4", GL_INT_VEC4}, {"mat3", GL_FLOAT_MAT3}, {"mat4", GL_FLOAT_MAT4},
+        {"sampler2D", GL_SAMPLER_2D}, {"sampler2DRect", GL_SAMPLER_2D_RECT}};
+
+    auto typeIt = types.find(type);
+    if (typeIt == types.end())
+        return 0;
+    return typeIt->second;
+}
+
+/*************/
+int getUniformTypeComponents(GLenum type)
+{
+    switch (type)
+    {
+    default:
+        return 1;
+    case GL_FLOAT_VEC2:
+    case GL_INT_VEC2:
+        return 2;
+    case GL_FLOAT_VEC3:
+    case GL_INT_VEC3:
+        return 3;
+    case GL_FLOAT_VEC4:
+    case GL_INT_VEC4:
+        return 4;
+    case GL_FLOAT_MAT3:
+        return 9;
+    case GL_FLOAT_MAT4:
+        return 16;
+    }
+}
+}
+
 /*************/
 Shader::Shader(ProgramType type)
 {
@@ -82,13 +137,6 @@ void Shader::activate()
         }
 
         _activated = true;
-
-        for (auto& u : _uniforms)
-        {
-            if (u.second.type == "buffer")
-                glUniformBlockBinding(_program, u.second.glIndex, 1);
-        }
-
         glUseProgram(_program);
 
         if (_sideness == singleSided)
@@ -233,28 +281,208 @@ void Shader::setTexture(const TexturePtr texture, const GLuint textureUnit, cons
         glUniform1i(uniform.glIndex, textureUnit);
 
         _textures.push_back(texture);
-        if ((uniformIt = _uniforms.find("_textureNbr")) != _uniforms.end())
-            if (uniformIt->second.glIndex != -1)
-            {
-                uniformIt->second.values = {(int)_textures.size()};
-                _uniformsToUpdate.push_back("_textureNbr");
-            }
+
+        static auto textureNbrHandle = getUniformHandle("_textureNbr");
+        setUniform(textureNbrHandle, static_cast<int>(_textures.size()));
     }
 }
 
 /*************/
 void Shader::setModelViewProjectionMatrix(const glm::dmat4& mv, const glm::dmat4& mp)
 {
+    static auto mvpHandle = getUniformHandle("_modelViewProjectionMatrix");
+    static auto normalMatrixHandle = getUniformHandle("_normalMatrix");
+
+    // These are part of the object uniform block for textured objects
+    auto& mvpUniform = getUniform(mvpHandle);
+    auto& normalMatrixUniform = getUniform(normalMatrixHandle);
+    if (mvpUniform.glIndex == -1 && normalMatrixUniform.glIndex == -1)
+        return;
+
     glm::mat4 floatMv = (glm::mat4)mv;
     glm::mat4 floatMvp = (glm::mat4)(mp * mv);
 
-    auto uniformIt = _uniforms.find("_modelViewProjectionMatrix");
-    if (uniformIt != _uniforms.end())
-        if (uniformIt->second.glIndex != -1)
-            glUniformMatrix4fv(uniformIt->second.glIndex, 1, GL_FALSE, glm::value_ptr(floatMvp));
-    if ((uniformIt = _uniforms.find("_normalMatrix")) != _uniforms.end())
-        if (uniformIt->second.glIndex != -1)
-            glUniformMatrix4fv(uniformIt->second.glIndex, 1, GL_FALSE, glm::value_ptr(glm::transpose(glm::inverse(floatMv))));
+    if (mvpUniform.glIndex != -1)
+        glUniformMatrix4fv(mvpUniform.glIndex, 1, GL_FALSE, glm::value_ptr(floatMvp));
+    if (normalMatrixUniform.glIndex != -1)
+        glUniformMatrix4fv(normalMatrixUniform.glIndex, 1, GL_FALSE, glm::value_ptr(glm::transpose(glm::inverse(floatMv))));
+}
+
+/*************/
+Shader::UniformHandle Shader::getUniformHandle(const string& name)
+{
+    auto& registry = getUniformRegistry();
+    lock_guard<mutex> lock(registry.lock);
+
+    UniformHandle handle;
+    auto handleIt = registry.handles.find(name);
+    if (handleIt != registry.handles.end())
+    {
+        handle.id = handleIt->second;
+    }
+    else
+    {
+        handle.id = registry.names.size();
+        registry.handles[name] = handle.id;
+        registry.names.push_back(name);
+    }
+
+    return handle;
+}
+
+/*************/
+Shader::Uniform& Shader::getUniform(UniformHandle handle)
+{
+    if (handle.id >= _uniformsByHandle.size())
+        _uniformsByHandle.resize(handle.id + 1, nullptr);
+
+    auto& uniform = _uniformsByHandle[handle.id];
+    if (!uniform)
+    {
+        auto& registry = getUniformRegistry();
+        unique_lock<mutex> lock(registry.lock);
+        auto name = registry.names[handle.id];
+        lock.unlock();
+        uniform = &_uniforms[name];
+    }
+
+    return *uniform;
+}
+
+/*************/
+void Shader::setUniformData(Uniform& uniform, const GLint* values, size_t count)
+{
+    if (uniform.isInt && uniform.ints.size() == count && equal(values, values + count, uniform.ints.begin()))
+        return;
+
+    uniform.isInt = true;
+    uniform.ints.assign(values, values + count);
+    uniform.floats.clear();
+    if (!uniform.toUpdate)
+    {
+        uniform.toUpdate = true;
+        _uniformsToUpdate.push_back(&uniform);
+    }
+}
+
+/*************/
+void Shader::setUniformData(Uniform& uniform, const GLfloat* values, size_t count)
+{
+    if (!uniform.isInt && uniform.floats.size() == count && equal(values, values + count, uniform.floats.begin()))
+        return;
+
+    uniform.isInt = false;
+    uniform.floats.assign(values, values + count);
+    uniform.ints.clear();
+    if (!uniform.toUpdate)
+    {
+        uniform.toUpdate = true;
+        _uniformsToUpdate.push_back(&uniform);
+    }
+}
+
+/*************/
+void Shader::setUniform(UniformHandle handle, int value)
+{
+    if (handle)
+        setUniformData(getUniform(handle), &value, 1);
+}
+
+/*************/
+void Shader::setUniform(UniformHandle handle, float value)
+{
+    if (handle)
+        setUniformData(getUniform(handle), &value, 1);
+}
+
+/*************/
+void Shader::setUniform(UniformHandle handle, const glm::vec2& value)
+{
+    if (handle)
+        setUniformData(getUniform(handle), glm::value_ptr(value), 2);
+}
+
+/*************/
+void Shader::setUniform(UniformHandle handle, const glm::vec3& value)
+{
+    if (handle)
+        setUniformData(getUniform(handle), glm::value_ptr(value), 3);
+}
+
+/*************/
+void Shader::setUniform(UniformHandle handle, const glm::vec4& value)
+{
+    if (handle)
+        setUniformData(getUniform(handle), glm::value_ptr(value), 4);
+}
+
+/*************/
+void Shader::setUniform(UniformHandle handle, const glm::ivec4& value)
+{
+    if (handle)
+        setUniformData(getUniform(handle), glm::value_ptr(value), 4);
+}
+
+/*************/
+void Shader::setUniform(UniformHandle handle, const glm::mat3& value)
+{
+    if (handle)
+        setUniformData(getUniform(handle), glm::value_ptr(value), 9);
+}
+
+/*************/
+void Shader::setUniform(UniformHandle handle, const glm::mat4& value)
+{
+    if (handle)
+        setUniformData(getUniform(handle), glm::value_ptr(value), 16);
+}
+
+/*************/
+void Shader::setUniform(UniformHandle handle, const int* values, size_t count)
+{
+    if (handle)
+        setUniformData(getUniform(handle), values, count);
+}
+
+/*************/
+void Shader::setUniform(UniformHandle handle, const float* values, size_t count)
+{
+    if (handle)
+        setUniformData(getUniform(handle), values, count);
+}
+
+/*************/
+bool Shader::setUniform(const string& name, const Values& values)
+{
+    if (values.size() == 0)
+        return false;
+
+    // Arrays and uniform blocks are given as a single nested Values
+    const Values& flatValues = values[0].getType() == Value::Type::v ? values[0].getValues() : values;
+    if (flatValues.size() == 0)
+        return false;
+
+    auto& uniform = getUniform(getUniformHandle(name));
+    if (flatValues[0].getType() == Value::Type::i || flatValues[0].getType() == Value::Type::l)
+    {
+        vector<GLint> data(flatValues.size());
+        for (size_t i = 0; i < flatValues.size(); ++i)
+            data[i] = flatValues[i].asInt();
+        setUniformData(uniform, data.data(), data.size());
+    }
+    else if (flatValues[0].getType() == Value::Type::f)
+    {
+        vector<GLfloat> data(flatValues.size());
+        for (size_t i = 0; i < flatValues.size(); ++i)
+            data[i] = flatValues[i].asFloat();
+        setUniformData(uniform, data.data(), data.size());
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
 }
 
 /*************/
@@ -296,6 +524,10 @@ bool Shader::linkProgram()
         for (auto src : _shadersSource)
             parseUniforms(src.second);
 
+        for (auto& u : _uniforms)
+            if (u.second.type == GL_UNIFORM_BUFFER && u.second.glIndex != -1)
+                glUniformBlockBinding(_program, u.second.glIndex, u.second.binding);
+
         _isLinked = true;
         return true;
     }
@@ -370,10 +602,26 @@ void Shader::parseUniforms(const std::string& src)
             string next = line.substr(position + 23, string::npos);
             string name = next.substr(0, next.find(" "));
 
-            _uniforms[name].type = "buffer";
-            _uniforms[name].glIndex = glGetUniformBlockIndex(_program, name.c_str());
-            glGenBuffers(1, &_uniforms[name].glBuffer);
-            _uniforms[name].glBufferReady = false;
+            auto& uniform = _uniforms[name];
+            uniform.type = GL_UNIFORM_BUFFER;
+            uniform.glIndex = glGetUniformBlockIndex(_program, name.c_str());
+
+            // Camera and object blocks are filled and bound by their owners
+            auto bindingIt = externalBlockBindings.find(name);
+            if (bindingIt != externalBlockBindings.end())
+            {
+                uniform.binding = bindingIt->second;
+                continue;
+            }
+
+            if (uniform.glBuffer == 0)
+                glGenBuffers(1, &uniform.glBuffer);
+            uniform.glBufferReady = false;
+            if (uniform.size() != 0 && !uniform.toUpdate)
+            {
+                uniform.toUpdate = true;
+                _uniformsToUpdate.push_back(&uniform);
+            }
         }
         else
         {
@@ -391,98 +639,46 @@ void Shader::parseUniforms(const std::string& src)
             if (name.find("[") != string::npos)
                 name = name.substr(0, name.find("["));
 
-            Values values;
-            if (_uniforms.find(name) != _uniforms.end())
-                values = _uniforms[name].values;
-
-            _uniforms[name].type = type;
+            auto& uniform = _uniforms[name];
+            uniform.type = getUniformTypeFromString(type);
 
             // Get the location
-            _uniforms[name].glIndex = glGetUniformLocation(_program, name.c_str());
-
-            if (type == "int")
-                _uniforms[name].values = {0};
-            else if (type == "float")
-                _uniforms[name].values = {0.f};
-            else if (type == "vec2")
-                _uniforms[name].values = {0.f, 0.f};
-            else if (type == "vec3")
-                _uniforms[name].values = {0.f, 0.f, 0.f};
-            else if (type == "vec4")
-                _uniforms[name].values = {0.f, 0.f, 0.f, 0.f};
-            else if (type == "ivec2")
-                _uniforms[name].values = {0, 0};
-            else if (type == "ivec3")
-                _uniforms[name].values = {0, 0, 0};
-            else if (type == "ivec4")
-                _uniforms[name].values = {0, 0, 0, 0};
-            else if (type == "mat3")
-                _uniforms[name].values = {0, 0, 0, 0, 0, 0, 0, 0, 0};
-            else if (type == "mat4")
-                _uniforms[name].values = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-            else if (type == "sampler2D" || type == "sampler2DRect")
-                _uniforms[name].values = {};
-            else
+            uniform.glIndex = glGetUniformLocation(_program, name.c_str());
+
+            if (uniform.type == 0)
             {
-                _uniforms[name].glIndex = -1;
+                uniform.glIndex = -1;
                 Log::get() << Log::WARNING << "Shader::" << __FUNCTION__ << " - Error while parsing uniforms: " << name << " is of unhandled type " << type << Log::endl;
+                continue;
             }
 
-            if (values.size() != 0)
+            if (uniform.type == GL_SAMPLER_2D || uniform.type == GL_SAMPLER_2D_RECT)
+                continue;
+
+            if (uniform.size() != 0)
             {
-                _uniforms[name].values = values;
-                _uniformsToUpdate.push_back(name);
+                // Values set before this program was compiled are sent again
+                if (!uniform.toUpdate)
+                {
+                    uniform.toUpdate = true;
+                    _uniformsToUpdate.push_back(&uniform);
+                }
             }
-            else
+            else if (uniform.glIndex != -1 && uniform.type != GL_FLOAT_MAT3 && uniform.type != GL_FLOAT_MAT4)
             {
                 // Save the default value
-                if (type == "int")
-                {
-                    int v;
-                    glGetUniformiv(_program, _uniforms[name].glIndex, &v);
-                    _uniforms[name].values = {v};
-                }
-                else if (type == "float")
+                auto components = getUniformTypeComponents(uniform.type);
+                if (uniform.type == GL_INT || uniform.type == GL_INT_VEC2 || uniform.type == GL_INT_VEC3 || uniform.type == GL_INT_VEC4)
                 {
-                    float v;
-                    glGetUniformfv(_program, _uniforms[name].glIndex, &v);
-                    _uniforms[name].values = {v};
+                    uniform.isInt = true;
+                    uniform.ints.resize(components);
+                    glGetUniformiv(_program, uniform.glIndex, uniform.ints.data());
                 }
-                else if (type == "vec2")
+                else
                 {
-                    float v[2];
-                    glGetUniformfv(_program, _uniforms[name].glIndex, v);
-                    _uniforms[name].values = {v[0], v[1]};
-                }
-                else if (type == "vec3")
-                {
-                    float v[3];
-                    glGetUniformfv(_program, _uniforms[name].glIndex, v);
-                    _uniforms[name].values = {v[0], v[1], v[2]};
-                }
-                else if (type == "vec4")
-                {
-                    float v[4];
-                    glGetUniformfv(_program, _uniforms[name].glIndex, v);
-                    _uniforms[name].values = {v[0], v[1], v[2], v[3]};
-                }
-                else if (type == "ivec2")
-                {
-                    int v[2];
-                    glGetUniformiv(_program, _uniforms[name].glIndex, v);
-                    _uniforms[name].values = {v[0], v[1]};
-                }
-                else if (type == "ivec3")
-                {
-                    int v[3];
-                    glGetUniformiv(_program, _uniforms[name].glIndex, v);
-                    _uniforms[name].values = {v[0], v[1], v[2]};
-                }
-                else if (type == "ivec4")
-                {
-                    int v[4];
-                    glGetUniformiv(_program, _uniforms[name].glIndex, v);
-                    _uniforms[name].values = {v[0], v[1], v[2], v[3]};
+                    uniform.isInt = false;
+                    uniform.floats.resize(components);
+                    glGetUniformfv(_program, uniform.glIndex, uniform.floats.data());
                 }
             }
         }
@@ -492,7 +688,7 @@ void Shader::parseUniforms(const std::string& src)
     for (auto& u : _uniforms)
     {
         string name = u.first;
-        if (u.second.type != "buffer")
+        if (u.second.type != GL_UNIFORM_BUFFER)
         {
             if (glGetUniformLocation(_program, name.c_str()) == -1)
                 u.second.glIndex = -1;
@@ -532,131 +728,66 @@ void Shader::updateUniforms()
 {
     if (_activated)
     {
-        for (int i = 0; i < _uniformsToUpdate.size(); ++i)
+        for (auto uniformPtr : _uniformsToUpdate)
         {
-            string u = _uniformsToUpdate[i];
+            auto& uniform = *uniformPtr;
+            uniform.toUpdate = false;
 
-            auto uniformIt = _uniforms.find(u);
-            if (uniformIt == _uniforms.end())
+            // Values are kept and queued again if the uniform appears in a newly linked program
+            auto size = uniform.size();
+            if (uniform.glIndex == -1 || size == 0 || (uniform.type == GL_UNIFORM_BUFFER && uniform.glBuffer == 0))
                 continue;
 
-            auto tmpName = uniformIt->first;
-
-            auto& uniform = uniformIt->second;
-            if (uniform.glIndex == -1)
+            if (uniform.type == GL_UNIFORM_BUFFER)
             {
-                uniform.values.clear(); // To make sure it is sent next time if the index is correctly set
+                auto data = uniform.isInt ? static_cast<const void*>(uniform.ints.data()) : static_cast<const void*>(uniform.floats.data());
+                auto dataSize = size * (uniform.isInt ? sizeof(GLint) : sizeof(GLfloat));
+
+                glBindBuffer(GL_UNIFORM_BUFFER, uniform.glBuffer);
+                if (!uniform.glBufferReady)
+                {
+                    glBufferData(GL_UNIFORM_BUFFER, dataSize, NULL, GL_STATIC_DRAW);
+                    uniform.glBufferReady = true;
+                }
+                glBufferSubData(GL_UNIFORM_BUFFER, 0, dataSize, data);
+                glBindBuffer(GL_UNIFORM_BUFFER, 0);
+                glBindBufferRange(GL_UNIFORM_BUFFER, uniform.binding, uniform.glBuffer, 0, dataSize);
                 continue;
             }
 
-            int size = uniform.values.size();
-            int type = uniform.values[0].getType();
+            // The upload function depends on the uniform type, arrays being sent as a whole
+            auto components = getUniformTypeComponents(uniform.type);
+            GLsizei count = size / components;
+            if (count == 0)
+                continue;
 
-            if (type == Value::Type::i)
+            if (uniform.isInt)
             {
-                if (size == 1)
-                    glUniform1i(uniform.glIndex, uniform.values[0].asInt());
-                else if (size == 2)
-                    glUniform2i(uniform.glIndex, uniform.values[0].asInt(), uniform.values[1].asInt());
-                else if (size == 3)
-                    glUniform3i(uniform.glIndex, uniform.values[0].asInt(), uniform.values[1].asInt(), uniform.values[2].asInt());
-                else if (size == 4)
-                    glUniform4i(uniform.glIndex, uniform.values[0].asInt(), uniform.values[1].asInt(), uniform.values[2].asInt(), uniform.values[3].asInt());
+                auto data = uniform.ints.data();
+                if (components == 1)
+                    glUniform1iv(uniform.glIndex, count, data);
+                else if (components == 2)
+                    glUniform2iv(uniform.glIndex, count, data);
+                else if (components == 3)
+                    glUniform3iv(uniform.glIndex, count, data);
+                else if (components == 4)
+                    glUniform4iv(uniform.glIndex, count, data);
             }
-            else if (type == Value::Type::f)
-            {
-                if (size == 1)
-                    glUniform1f(uniform.glIndex, uniform.values[0].asFloat());
-                else if (size == 2)
-                    glUniform2f(uniform.glIndex, uniform.values[0].asFloat(), uniform.values[1].asFloat());
-                else if (size == 3)
-                    glUniform3f(uniform.glIndex, uniform.values[0].asFloat(), uniform.values[1].asFloat(), uniform.values[2].asFloat());
-                else if (size == 4)
-                    glUniform4f(uniform.glIndex, uniform.values[0].asFloat(), uniform.values[1].asFloat(), uniform.values[2].asFloat(), uniform.values[3].asFloat());
-                else if (size == 9)
-                {
-                    vector<float> m(9);
-                    for (unsigned int i = 0; i < 9; ++i)
-                        m[i] = uniform.values[i].asFloat();
-                    glUniformMatrix3fv(uniform.glIndex, 1, GL_FALSE, m.data());
-                }
-                else if (size == 16)
-                {
-                    vector<float> m(16);
-                    for (unsigned int i = 0; i < 16; ++i)
-                        m[i] = uniform.values[i].asFloat();
-                    glUniformMatrix4fv(uniform.glIndex, 1, GL_FALSE, m.data());
-                }
-            }
-            else if (type == Value::Type::v && uniform.values[0].asValues().size() > 0)
+            else
             {
-                type = uniform.values[0].asValues()[0].getType();
-                if (type == Value::Type::i)
-                {
-                    vector<int> data;
-                    if (uniform.type == "buffer")
-                    {
-                        for (auto& v : uniform.values[0].asValues())
-                            data.push_back(v.asInt());
-
-                        glBindBuffer(GL_UNIFORM_BUFFER, uniform.glBuffer);
-                        if (!uniform.glBufferReady)
-                        {
-                            glBufferData(GL_UNIFORM_BUFFER, data.size() * sizeof(int), NULL, GL_STATIC_DRAW);
-                            uniform.glBufferReady = true;
-                        }
-                        glBufferSubData(GL_UNIFORM_BUFFER, 0, data.size() * sizeof(int), data.data());
-                        glBindBuffer(GL_UNIFORM_BUFFER, 0);
-                        glBindBufferRange(GL_UNIFORM_BUFFER, 1, uniform.glBuffer, 0, data.size() * sizeof(int));
-                    }
-                    else
-                    {
-                        for (auto& v : uniform.values[0].asValues())
-                            data.push_back(v.asInt());
-
-                        if (uniform.type == "int")
-                            glUniform1iv(uniform.glIndex, data.size(), data.data());
-                        else if (uniform.type == "ivec2")
-                            glUniform2iv(uniform.glIndex, data.size() / 2, data.data());
-                        else if (uniform.type == "ivec3")
-                            glUniform3iv(uniform.glIndex, data.size() / 3, data.data());
-                        else if (uniform.type == "ivec4")
-                            glUniform4iv(uniform.glIndex, data.size() / 4, data.data());
-                    }
-                }
-                else if (type == Value::Type::f)
-                {
-                    vector<float> data;
-                    if (uniform.type == "buffer")
-                    {
-                        for (auto& v : uniform.values[0].asValues())
-                            data.push_back(v.asFloat());
-
-                        glBindBuffer(GL_UNIFORM_BUFFER, uniform.glBuffer);
-                        if (!uniform.glBufferReady)
-                        {
-                            glBufferData(GL_UNIFORM_BUFFER, data.size() * sizeof(float), NULL, GL_STATIC_DRAW);
-                            uniform.glBufferReady = true;
-                        }
-                        glBufferSubData(GL_UNIFORM_BUFFER, 0, data.size() * sizeof(float), data.data());
-                        glBindBuffer(GL_UNIFORM_BUFFER, 0);
-                        glBindBufferRange(GL_UNIFORM_BUFFER, 1, uniform.glBuffer, 0, data.size() * sizeof(float));
-                    }
-                    else
-                    {
-                        for (auto& v : uniform.values[0].asValues())
-                            data.push_back(v.asFloat());
-
-                        if (uniform.type == "float")
-                            glUniform1fv(uniform.glIndex, data.size(), data.data());
-                        else if (uniform.type == "vec2")
-                            glUniform2fv(uniform.glIndex, data.size() / 2, data.data());
-                        else if (uniform.type == "vec3")
-                            glUniform3fv(uniform.glIndex, data.size() / 3, data.data());
-                        else if (uniform.type == "vec4")
-                            glUniform4fv(uniform.glIndex, data.size() / 4, data.data());
-                    }
-                }
+                auto data = uniform.floats.data();
+                if (components == 1)
+                    glUniform1fv(uniform.glIndex, count, data);
+                else if (components == 2)
+                    glUniform2fv(uniform.glIndex, count, data);
+                else if (components == 3)
+                    glUniform3fv(uniform.glIndex, count, data);
+                else if (components == 4)
+                    glUniform4fv(uniform.glIndex, count, data);
+                else if (components == 9)
+                    glUniformMatrix3fv(uniform.glIndex, count, GL_FALSE, data);
+                else if (components == 16)
+                    glUniformMatrix4fv(uniform.glIndex, count, GL_FALSE, data);
             }
         }
 
@@ -685,27 +816,9 @@ void Shader::registerAttributes()
         if (args.size() < 2)
             return false;
 
-        string uniformName = args[0].asString();
-        Values uniformArgs;
-        if (args[1].getType() != Value::Type::v)
-        {
-            for (int i = 1; i < args.size(); ++i)
-                uniformArgs.push_back(args[i]);
-        }
-        else
-        {
-            uniformArgs = args[1].asValues();
-        }
-
-        // Check if the values changed from previous use
-        auto uniformIt = _uniforms.find(uniformName);
-        if (uniformIt != _uniforms.end() && Value(uniformArgs) == Value(uniformIt->second.values))
-            return true;
-        else if (uniformIt == _uniforms.end())
-            uniformIt = (_uniforms.emplace(make_pair(uniformName, Uniform()))).first;
-
-        uniformIt->second.values = uniformArgs;
-        _uniformsToUpdate.push_back(uniformName);
+        Values uniformArgs = args;
+        uniformArgs.pop_front();
+        setUniform(args[0].asString(), uniformArgs);
 
         return true;
     });
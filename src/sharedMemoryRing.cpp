@@ -0,0 +1,272 @@
+#include "sharedMemoryRing.h"
+
+#include <chrono>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "log.h"
+
+#define SPLASH_SHM_MAGIC 0x53504c53 // "SPLS"
+#define SPLASH_SHM_VERSION 1
+#define SPLASH_SHM_PAGE_SIZE 4096
+#define SPLASH_SHM_WRITING 0xFFFFFFFF
+
+using namespace std;
+
+namespace Splash {
+
+/*************/
+struct SharedMemoryRing::RingHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t padding;
+    uint64_t slotSize;
+    uint64_t ringId;
+};
+
+/*************/
+struct SharedMemoryRing::SlotHeader
+{
+    std::atomic<uint32_t> readers; // Number of readers still expected, or SPLASH_SHM_WRITING
+    std::atomic<uint64_t> sequence; // Odd while the slot is being written
+    std::atomic<int64_t> writeTime; // Monotonic time of the last write, in us
+    uint64_t size;
+};
+
+namespace {
+/*************/
+inline int64_t getMonotonicTime()
+{
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*************/
+inline size_t alignToPage(size_t size)
+{
+    return (size + SPLASH_SHM_PAGE_SIZE - 1) / SPLASH_SHM_PAGE_SIZE * SPLASH_SHM_PAGE_SIZE;
+}
+}
+
+/*************/
+SharedMemoryRing::SharedMemoryRing(const string& name, size_t slotSize, unsigned int slotCount)
+{
+    _name = name;
+    _owner = true;
+
+    slotSize = alignToPage(slotSize);
+    size_t headerSize = alignToPage(sizeof(RingHeader) + slotCount * sizeof(SlotHeader));
+    size_t totalSize = headerSize + slotSize * slotCount;
+
+    shm_unlink(_name.c_str()); // Remove any leftover from a previous run
+    int fd = shm_open(_name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+    if (fd < 0)
+    {
+        Log::get() << Log::WARNING << "SharedMemoryRing::" << __FUNCTION__ << " - Unable to create shared memory segment " << _name << Log::endl;
+        return;
+    }
+
+    // The space is reserved upfront: writing to a sparse segment bigger than what is left
+    // in the shared memory filesystem would raise a SIGBUS
+    if (ftruncate(fd, totalSize) != 0 || posix_fallocate(fd, 0, totalSize) != 0 || !map(fd, totalSize))
+    {
+        Log::get() << Log::WARNING << "SharedMemoryRing::" << __FUNCTION__ << " - Unable to allocate shared memory segment " << _name << Log::endl;
+        close(fd);
+        shm_unlink(_name.c_str());
+        return;
+    }
+    close(fd);
+
+    for (unsigned int i = 0; i < slotCount; ++i)
+    {
+        auto slotHeader = reinterpret_cast<SlotHeader*>(reinterpret_cast<char*>(_header) + sizeof(RingHeader)) + i;
+        new (slotHeader) SlotHeader();
+        slotHeader->readers = 0;
+        slotHeader->sequence = 0;
+        slotHeader->writeTime = 0;
+        slotHeader->size = 0;
+    }
+
+    _header->magic = SPLASH_SHM_MAGIC;
+    _header->version = SPLASH_SHM_VERSION;
+    _header->slotCount = slotCount;
+    _header->slotSize = slotSize;
+    _header->ringId = (static_cast<uint64_t>(getpid()) << 32) ^ static_cast<uint64_t>(getMonotonicTime());
+}
+
+/*************/
+SharedMemoryRing::SharedMemoryRing(const string& name)
+{
+    _name = name;
+    _owner = false;
+
+    int fd = shm_open(_name.c_str(), O_RDWR, S_IRUSR | S_IWUSR);
+    if (fd < 0)
+    {
+        Log::get() << Log::WARNING << "SharedMemoryRing::" << __FUNCTION__ << " - Unable to open shared memory segment " << _name << Log::endl;
+        return;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || static_cast<size_t>(fileStat.st_size) < sizeof(RingHeader) || !map(fd, fileStat.st_size))
+    {
+        Log::get() << Log::WARNING << "SharedMemoryRing::" << __FUNCTION__ << " - Unable to map shared memory segment " << _name << Log::endl;
+        close(fd);
+        return;
+    }
+    close(fd);
+
+    if (_header->magic != SPLASH_SHM_MAGIC || _header->version != SPLASH_SHM_VERSION)
+    {
+        Log::get() << Log::WARNING << "SharedMemoryRing::" << __FUNCTION__ << " - Shared memory segment " << _name << " has an unknown format" << Log::endl;
+        munmap(_header, _mappedSize);
+        _header = nullptr;
+    }
+}
+
+/*************/
+SharedMemoryRing::~SharedMemoryRing()
+{
+    if (_header)
+        munmap(_header, _mappedSize);
+
+    if (_owner)
+        shm_unlink(_name.c_str());
+}
+
+/*************/
+uint64_t SharedMemoryRing::getId() const
+{
+    if (!_header)
+        return 0;
+    return _header->ringId;
+}
+
+/*************/
+size_t SharedMemoryRing::getSlotSize() const
+{
+    if (!_header)
+        return 0;
+    return _header->slotSize;
+}
+
+/*************/
+bool SharedMemoryRing::write(const char* data, size_t size, unsigned int readers, Notification& notification)
+{
+    if (!_header || !_owner || size > _header->slotSize || readers == 0)
+        return false;
+
+    // Look for a slot which has been read by everyone, or which has been waiting for too long
+    auto now = getMonotonicTime();
+    SlotHeader* slotHeader = nullptr;
+    unsigned int slot = 0;
+    for (unsigned int i = 0; i < _header->slotCount; ++i)
+    {
+        slot = (_nextSlot + i) % _header->slotCount;
+        auto candidate = getSlotHeader(slot);
+
+        uint32_t expected = candidate->readers.load(memory_order_acquire);
+        if (expected == SPLASH_SHM_WRITING)
+            continue;
+        if (expected != 0 && now - candidate->writeTime.load(memory_order_relaxed) < SPLASH_SHM_SLOT_TIMEOUT)
+            continue;
+
+        if (candidate->readers.compare_exchange_strong(expected, SPLASH_SHM_WRITING, memory_order_acq_rel))
+        {
+            slotHeader = candidate;
+            break;
+        }
+    }
+
+    if (!slotHeader)
+        return false;
+
+    // The sequence number is odd while writing, so that a late reader can detect the overwrite
+    auto sequence = slotHeader->sequence.fetch_add(1, memory_order_acq_rel) + 1;
+    memcpy(getSlotData(slot), data, size);
+    slotHeader->size = size;
+    slotHeader->sequence.store(sequence + 1, memory_order_release);
+    slotHeader->writeTime.store(getMonotonicTime(), memory_order_relaxed);
+    slotHeader->readers.store(readers, memory_order_release);
+
+    _nextSlot = (slot + 1) % _header->slotCount;
+
+    notification.ringId = _header->ringId;
+    notification.sequence = sequence + 1;
+    notification.size = size;
+    notification.slot = slot;
+    notification.nameSize = _name.size();
+
+    return true;
+}
+
+/*************/
+shared_ptr<SerializedObject> SharedMemoryRing::read(const Notification& notification)
+{
+    if (!_header || notification.ringId != _header->ringId || notification.slot >= _header->slotCount || notification.size > _header->slotSize)
+        return {};
+
+    auto slotHeader = getSlotHeader(notification.slot);
+    if (slotHeader->sequence.load(memory_order_acquire) != notification.sequence)
+        return {};
+
+    auto data = getSlotData(notification.slot);
+    auto buffer = make_shared<SerializedObject>(data, data + notification.size);
+
+    // If the writer reclaimed the slot while we were copying, the buffer is garbage
+    if (slotHeader->sequence.load(memory_order_acquire) != notification.sequence)
+        return {};
+
+    uint32_t readers = slotHeader->readers.load(memory_order_acquire);
+    while (readers != 0 && readers != SPLASH_SHM_WRITING)
+        if (slotHeader->readers.compare_exchange_weak(readers, readers - 1, memory_order_acq_rel))
+            break;
+
+    return buffer;
+}
+
+/*************/
+void SharedMemoryRing::release(const Notification& notification)
+{
+    if (!_header || !_owner || notification.ringId != _header->ringId || notification.slot >= _header->slotCount)
+        return;
+
+    auto slotHeader = getSlotHeader(notification.slot);
+    if (slotHeader->sequence.load(memory_order_acquire) != notification.sequence)
+        return;
+
+    uint32_t readers = slotHeader->readers.load(memory_order_acquire);
+    if (readers != SPLASH_SHM_WRITING)
+        slotHeader->readers.compare_exchange_strong(readers, 0, memory_order_acq_rel);
+}
+
+/*************/
+bool SharedMemoryRing::map(int fd, size_t size)
+{
+    void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED)
+        return false;
+
+    _header = reinterpret_cast<RingHeader*>(ptr);
+    _mappedSize = size;
+    return true;
+}
+
+/*************/
+SharedMemoryRing::SlotHeader* SharedMemoryRing::getSlotHeader(unsigned int slot) const
+{
+    return reinterpret_cast<SlotHeader*>(reinterpret_cast<char*>(_header) + sizeof(RingHeader)) + slot;
+}
+
+/*************/
+char* SharedMemoryRing::getSlotData(unsigned int slot) const
+{
+    size_t headerSize = alignToPage(sizeof(RingHeader) + _header->slotCount * sizeof(SlotHeader));
+    return reinterpret_cast<char*>(_header) + headerSize + slot * _header->slotSize;
+}
+
+} // end of namespace
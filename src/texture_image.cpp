@@ -1,11 +1,13 @@
 #include "texture_image.h"
 
+#include "directUpload.h"
 #include "image.h"
 #include "log.h"
 #include "threadpool.h"
 #include "timer.h"
 
 #include <string>
+#include <thread>
 
 #define SPLASH_TEXTURE_COPY_THREADS 2
 
@@ -39,12 +41,19 @@ Texture_Image::Texture_Image(RootObjectWeakPtr root, GLenum target, GLint level,
 /*************/
 Texture_Image::~Texture_Image()
 {
+    // The copy threads may still be writing to the PBOs
+    while (_pboPendingCopies != 0)
+        this_thread::sleep_for(chrono::microseconds(100));
+    finishPboCopy();
+
     if (_root.expired())
         return;
 
 #ifdef DEBUG
     Log::get() << Log::DEBUGGING << "Texture_Image::~Texture_Image - Destructor" << Log::endl;
 #endif
+    releaseDirectTarget();
+    releasePbos();
     glDeleteTextures(1, &_glTex);
 }
 
@@ -137,18 +146,20 @@ void Texture_Image::reset(GLenum target, GLint level, GLint internalFormat, GLsi
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
             }
-
-            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
         }
 
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
         glTexImage2D(target, level, internalFormat, width, height, border, format, type, data);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
         glBindTexture(target, 0);
     }
     else
     {
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(target, _glTex);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
         glTexImage2D(target, level, internalFormat, width, height, border, format, type, data);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
         glBindTexture(target, 0);
     }
 
@@ -248,11 +259,21 @@ void Texture_Image::update()
         return;
     auto img = _img.lock();
 
+    // Frames written directly by the Image of the World do not go through the Image of the Scene
+    if (uploadDirectFrame())
+        return;
+
+    // The image stays locked while the copy to a PBO is running
+    if (!finishPboCopy())
+        return;
+    uploadPbo();
+
     if (img->getTimestamp() == _timestamp)
         return;
     img->update();
 
     auto spec = img->getSpec();
+    auto imageSpec = spec;
     Values srgb, flip, flop;
     img->getAttribute("srgb", srgb);
     img->getAttribute("flip", flip);
@@ -283,12 +304,42 @@ void Texture_Image::update()
         isCompressed = true;
     }
 
+    // YUV images are uploaded as is, and converted to RGB by the filter shader
+    // The texture size then differs from the image size, see the "yuv" shader include
+    int yuvFormat = 0;
+    int texWidth = spec.width;
+    int texHeight = spec.height;
+    if (spec.format == vector<string>({"YUV_I420"}))
+    {
+        yuvFormat = 1;
+        spec.height = spec.height * 2 / 3;
+        spec.channels = 3;
+    }
+    else if (spec.format == vector<string>({"YUV_UYVY"}))
+    {
+        yuvFormat = 2;
+        texWidth = spec.width / 2;
+        spec.channels = 3;
+    }
+
     // Get GL parameters
     GLenum internalFormat;
     GLenum dataFormat;
     if (!isCompressed)
     {
-        if (spec.channels == 4 && spec.type == ImageBufferSpec::Type::UINT8)
+        if (yuvFormat == 1)
+        {
+            dataFormat = GL_UNSIGNED_BYTE;
+            internalFormat = GL_R8;
+            glChannelOrder = GL_RED;
+        }
+        else if (yuvFormat == 2)
+        {
+            dataFormat = GL_UNSIGNED_BYTE;
+            internalFormat = GL_RGBA8;
+            glChannelOrder = GL_RGBA;
+        }
+        else if (spec.channels == 4 && spec.type == ImageBufferSpec::Type::UINT8)
         {
             dataFormat = GL_UNSIGNED_INT_8_8_8_8_REV;
             if (srgb[0].asInt() > 0)
@@ -337,8 +388,9 @@ void Texture_Image::update()
         return;
     }
 
-    // Update the textures if the format changed
-    if (spec != _spec)
+    // Update the textures if the format changed, or if the PBO ring has to be resized
+    bool textureCreated = false;
+    if (spec != _spec || static_cast<int>(_pbos.size()) != _pboCount)
     {
         // glTexStorage2D is immutable, so we have to delete the texture first
         if (_glVersionMajor >= 4 && _glVersionMinor >= 2)
@@ -351,7 +403,13 @@ void Texture_Image::update()
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, _glTextureWrap);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, _glTextureWrap);
 
-        if (_filtering)
+        if (yuvFormat != 0)
+        {
+            // The shader fetches texels directly
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        }
+        else if (_filtering)
         {
             if (isCompressed)
                 glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -372,15 +430,18 @@ void Texture_Image::update()
             Log::get() << Log::DEBUGGING << "Texture_Image::" <<  __FUNCTION__ << " - Creating a new texture" << Log::endl;
 #endif
             img->lock();
+            // Rows of YUV planes and of RGB images are not always aligned on 4 bytes
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
             if (_glVersionMajor >= 4 && _glVersionMinor >= 2)
             {
-                glTexStorage2D(GL_TEXTURE_2D, 3, internalFormat, spec.width, spec.height);
-                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, spec.width, spec.height, glChannelOrder, dataFormat, img->data());
+                glTexStorage2D(GL_TEXTURE_2D, yuvFormat != 0 ? 1 : 3, internalFormat, texWidth, texHeight);
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, texWidth, texHeight, glChannelOrder, dataFormat, img->data());
             }
             else
             {
-                glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, spec.width, spec.height, 0, glChannelOrder, dataFormat, img->data());
+                glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, texWidth, texHeight, 0, glChannelOrder, dataFormat, img->data());
             }
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
             img->unlock();
         }
         else if (isCompressed)
@@ -393,72 +454,22 @@ void Texture_Image::update()
             glCompressedTexImage2D(GL_TEXTURE_2D, 0, internalFormat, spec.width, spec.height, 0, imageDataSize, img->data());
             img->unlock();
         }
-        updatePbos(spec.width, spec.height, spec.pixelBytes());
-
-        // Fill one of the PBOs right now
-        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbos[0]);
-        GLubyte* pixels = (GLubyte*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, imageDataSize, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
-        if (pixels != NULL)
-        {
-            img->lock();
-            memcpy((void*)pixels, img->data(), imageDataSize);
-            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
-            img->unlock();
-        }
-        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
-
-        // And copy it to the second PBO
-        glBindBuffer(GL_COPY_READ_BUFFER, _pbos[0]);
-        glBindBuffer(GL_COPY_WRITE_BUFFER, _pbos[1]);
-        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, imageDataSize);
-        glBindBuffer(GL_COPY_READ_BUFFER, 0);
-        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        updatePbos(imageDataSize);
 
 #ifdef DEBUG
         glBindTexture(GL_TEXTURE_2D, 0);
 #endif
 
         _spec = spec;
+        _frameTimestamp = imageSpec.timestamp;
+        _frameIndex = imageSpec.frameIndex;
+        textureCreated = true;
     }
-    // Update the content of the texture, i.e the image
-    else
+    // Copy the image to the next PBO, it is uploaded to the texture once the copy is done
+    else if (!copyToPbo(img, imageDataSize))
     {
-        glBindTexture(GL_TEXTURE_2D, _glTex);
-
-        // Copy the pixels from the current PBO to the texture
-        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbos[_pboReadIndex]);
-        if (!isCompressed)
-            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, spec.width, spec.height, glChannelOrder, dataFormat, 0);
-        else
-            glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, spec.width, spec.height, internalFormat, imageDataSize, 0);
-        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
-#ifdef DEBUG
-        glBindTexture(GL_TEXTURE_2D, 0);
-#endif
-
-        _pboReadIndex = (_pboReadIndex + 1) % 2;
-        
-        // Fill the next PBO with the image pixels
-        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbos[_pboReadIndex]);
-        GLubyte* pixels = (GLubyte*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, imageDataSize, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
-        if (pixels != NULL)
-        {
-            img->lock();
-
-            _pboCopyThreadIds.clear();
-            int stride = SPLASH_TEXTURE_COPY_THREADS;
-            int size = imageDataSize;
-            for (int i = 0; i < stride - 1; ++i)
-            {
-                _pboCopyThreadIds.push_back(SThread::pool.enqueue([=]() {
-                    copy((char*)img->data() + size / stride * i, (char*)img->data() + size / stride * (i + 1), (char*)pixels + size / stride * i);
-                }));
-            }
-            _pboCopyThreadIds.push_back(SThread::pool.enqueue([=]() {
-                copy((char*)img->data() + size / stride * (stride - 1), (char*)img->data() + size, (char*)pixels + size / stride * (stride - 1));
-            }));
-        }
-        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        // No PBO is free yet, this frame will be copied at the next update
+        return;
     }
 
     // If needed, specify some uniforms for the shader which will use this texture
@@ -467,31 +478,33 @@ void Texture_Image::update()
         _shaderUniforms["YCoCg"] = {1};
     else
         _shaderUniforms["YCoCg"] = {0};
+    _shaderUniforms["YUV"] = {yuvFormat};
+    _shaderUniforms["srgb"] = {yuvFormat != 0 && srgb[0].asInt() > 0 ? 1 : 0};
 
     _shaderUniforms["flip"] = flip;
     _shaderUniforms["flop"] = flop;
 
     _timestamp = img->getTimestamp();
+    _frameSource = img->getName();
 
-    if (_filtering && !isCompressed)
+    if (textureCreated && _filtering && !isCompressed && yuvFormat == 0)
         generateMipmap();
+
+    _uploadParameters.width = isCompressed ? spec.width : texWidth;
+    _uploadParameters.height = isCompressed ? spec.height : texHeight;
+    _uploadParameters.channelOrder = glChannelOrder;
+    _uploadParameters.dataFormat = dataFormat;
+    _uploadParameters.internalFormat = internalFormat;
+    _uploadParameters.isCompressed = isCompressed;
+    _uploadParameters.imageDataSize = imageDataSize;
+    _uploadParameters.mipmaps = _filtering && !isCompressed && yuvFormat == 0;
+    updateDirectTarget(img->getName(), imageSpec, imageDataSize);
 }
 
 /*************/
 void Texture_Image::flushPbo()
 {
-    if (_pboCopyThreadIds.size() != 0)
-    {
-        SThread::pool.waitThreads(_pboCopyThreadIds);
-        _pboCopyThreadIds.clear();
-
-        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbos[_pboReadIndex]);
-        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
-
-        if (!_img.expired())
-            _img.lock()->unlock();
-        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
-    }
+    finishPboCopy();
 }
 
 /*************/
@@ -513,17 +526,267 @@ void Texture_Image::init()
 
     _texTarget = GL_TEXTURE_2D;
 
-    glGenBuffers(2, _pbos);
+    // Persistent mapping needs glBufferStorage, from OpenGL 4.4
+    _hasBufferStorage = _glVersionMajor > 4 || (_glVersionMajor == 4 && _glVersionMinor >= 4);
 }
 
 /*************/
-void Texture_Image::updatePbos(int width, int height, int bytes)
+void Texture_Image::updatePbos(int size)
 {
-    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbos[0]);
-    glBufferData(GL_PIXEL_UNPACK_BUFFER, width * height * bytes, 0, GL_STREAM_DRAW);
-    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbos[1]);
-    glBufferData(GL_PIXEL_UNPACK_BUFFER, width * height * bytes, 0, GL_STREAM_DRAW);
+    releasePbos();
+
+    _pbos.resize(_pboCount);
+    for (auto& slot : _pbos)
+    {
+        glGenBuffers(1, &slot.pbo);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+        if (_hasBufferStorage)
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+            slot.pixels = (char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+        }
+        else
+        {
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, size, 0, GL_STREAM_DRAW);
+        }
+    }
     glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    _pboWriteIndex = 0;
+    _pboReadyIndex = -1;
+}
+
+/*************/
+void Texture_Image::releasePbos()
+{
+    for (auto& slot : _pbos)
+    {
+        if (slot.fence)
+            glDeleteSync(slot.fence);
+        // Persistently mapped buffers are unmapped when deleted
+        glDeleteBuffers(1, &slot.pbo);
+    }
+    _pbos.clear();
+}
+
+/*************/
+bool Texture_Image::copyToPbo(const shared_ptr<Image>& img, int size)
+{
+    if (_pbos.empty())
+        return true;
+
+    auto index = (_pboWriteIndex + 1) % _pbos.size();
+    auto& slot = _pbos[index];
+    if (slot.fence)
+    {
+        if (glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED)
+            return false;
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+    }
+
+    char* pixels = slot.pixels;
+    if (!_hasBufferStorage)
+    {
+        // The fence guarantees that the GL does not read this buffer anymore
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+        pixels = (char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    if (pixels == nullptr)
+        return true;
+
+    img->lock();
+    _pboCopyImage = img;
+    _pboWriteIndex = index;
+    _pboCopying = true;
+
+    auto spec = img->getSpec();
+    slot.timestamp = spec.timestamp;
+    slot.frameIndex = spec.frameIndex;
+
+    const char* imgPtr = (const char*)img->data();
+    int stride = SPLASH_TEXTURE_COPY_THREADS;
+    _pboPendingCopies = stride;
+    for (int i = 0; i < stride; ++i)
+    {
+        SThread::pool.enqueueWithoutId([=]() {
+            int end = (i == stride - 1) ? size : size / stride * (i + 1);
+            copy(imgPtr + size / stride * i, imgPtr + end, pixels + size / stride * i);
+            _pboPendingCopies--;
+        });
+    }
+
+    return true;
+}
+
+/*************/
+bool Texture_Image::finishPboCopy()
+{
+    if (!_pboCopying)
+        return true;
+    if (_pboPendingCopies != 0)
+        return false;
+
+    if (!_hasBufferStorage && !_root.expired())
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _pbos[_pboWriteIndex].pbo);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    _pboCopyImage->unlock();
+    _pboCopyImage.reset();
+    _pboCopying = false;
+    _pboReadyIndex = _pboWriteIndex;
+
+    return true;
+}
+
+/*************/
+void Texture_Image::uploadPbo()
+{
+    if (_pboReadyIndex < 0)
+        return;
+
+    auto& slot = _pbos[_pboReadyIndex];
+    _pboReadyIndex = -1;
+
+    const auto& params = _uploadParameters;
+    glBindTexture(GL_TEXTURE_2D, _glTex);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.pbo);
+    if (!params.isCompressed)
+    {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, params.width, params.height, params.channelOrder, params.dataFormat, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+    else
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, params.width, params.height, params.internalFormat, params.imageDataSize, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+#ifdef DEBUG
+    glBindTexture(GL_TEXTURE_2D, 0);
+#endif
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _frameTimestamp = slot.timestamp;
+    _frameIndex = slot.frameIndex;
+
+    if (params.mipmaps)
+        generateMipmap();
+}
+
+/*************/
+void Texture_Image::updateDirectTarget(const string& name, const ImageBufferSpec& spec, int size)
+{
+    bool usable = DirectUpload::get().isActive() && size > 0 && _hasBufferStorage;
+    if (_directTarget && usable && name == _directTargetName && _directTarget->getSpec() == spec)
+        return;
+
+    releaseDirectTarget();
+    if (!usable)
+        return;
+
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(SPLASH_DIRECT_UPLOAD_SLOTS, _directPbos);
+    vector<char*> buffers;
+    for (int i = 0; i < SPLASH_DIRECT_UPLOAD_SLOTS; ++i)
+    {
+        _directFences[i] = nullptr;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _directPbos[i]);
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, size, nullptr, flags);
+        auto pixels = (char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, flags);
+        if (pixels)
+            buffers.push_back(pixels);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (buffers.size() != SPLASH_DIRECT_UPLOAD_SLOTS)
+    {
+        Log::get() << Log::WARNING << "Texture_Image::" << __FUNCTION__ << " - Unable to map the buffers for direct upload, using the default path" << Log::endl;
+        glDeleteBuffers(SPLASH_DIRECT_UPLOAD_SLOTS, _directPbos);
+        return;
+    }
+
+    _directTarget = make_shared<DirectUploadTarget>(spec, buffers);
+    _directTargetName = name;
+    DirectUpload::get().registerTarget(_directTargetName, _directTarget);
+}
+
+/*************/
+void Texture_Image::releaseDirectTarget()
+{
+    if (!_directTarget)
+        return;
+
+    DirectUpload::get().unregisterTarget(_directTargetName, _directTarget);
+    _directTarget->close();
+    _directTarget.reset();
+
+    for (int i = 0; i < SPLASH_DIRECT_UPLOAD_SLOTS; ++i)
+    {
+        if (_directFences[i])
+        {
+            glClientWaitSync(_directFences[i], GL_SYNC_FLUSH_COMMANDS_BIT, 1e9);
+            glDeleteSync(_directFences[i]);
+            _directFences[i] = nullptr;
+        }
+
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _directPbos[i]);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glDeleteBuffers(SPLASH_DIRECT_UPLOAD_SLOTS, _directPbos);
+}
+
+/*************/
+bool Texture_Image::uploadDirectFrame()
+{
+    if (!_directTarget)
+        return false;
+
+    // Buffers whose upload is done can be written again
+    for (int i = 0; i < SPLASH_DIRECT_UPLOAD_SLOTS; ++i)
+    {
+        if (_directFences[i] && glClientWaitSync(_directFences[i], 0, 0) != GL_TIMEOUT_EXPIRED)
+        {
+            glDeleteSync(_directFences[i]);
+            _directFences[i] = nullptr;
+            _directTarget->releaseSlot(i);
+        }
+    }
+
+    auto index = _directTarget->acquireReadySlot();
+    if (index < 0)
+        return false;
+
+    const auto& params = _uploadParameters;
+    glBindTexture(GL_TEXTURE_2D, _glTex);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _directPbos[index]);
+    if (!params.isCompressed)
+    {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, params.width, params.height, params.channelOrder, params.dataFormat, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+    else
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, params.width, params.height, params.internalFormat, params.imageDataSize, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+#ifdef DEBUG
+    glBindTexture(GL_TEXTURE_2D, 0);
+#endif
+
+    // The buffer is given back to the writer once the GL is done reading it
+    _directFences[index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    _frameTimestamp = _directTarget->getSlotTimestamp(index);
+    _frameIndex = _directTarget->getSlotFrameIndex(index);
+
+    if (params.mipmaps)
+        generateMipmap();
+
+    return true;
 }
 
 /*************/
@@ -543,6 +806,14 @@ void Texture_Image::registerAttributes()
     }, {'n'});
     setAttributeDescription("clampToEdge", "If set to 1, clamp the texture to the edge");
 
+    addAttribute("pboCount", [&](const Values& args) {
+        _pboCount = max(2, args[0].asInt());
+        return true;
+    }, [&]() -> Values {
+        return {_pboCount};
+    }, {'n'});
+    setAttributeDescription("pboCount", "Number of PBOs used to upload the image, the ring is resized at the next upload");
+
     addAttribute("size", [&](const Values& args) {
         resize(args[0].asInt(), args[1].asInt());
         return true;
@@ -1,49 +1,14 @@
 #include "threadpool.h"
 
-#include <algorithm>
 #include <unistd.h>
 
 using namespace std;
 
-/*************/
-void Worker::operator() ()
+namespace
 {
-    shared_ptr<function<void()>> task;
-
-    while (true)
-    {
-        unsigned int id;
-        {
-            // Acquire locklock
-            unique_lock<mutex> lock(pool.queue_mutex);
-
-            // look for a work item
-            while (!pool.stop && pool.tasks.empty())
-                pool.condition.wait(lock);
-
-            // exit the pool if stopped
-            if (pool.stop)
-                return;
-
-            task.swap(pool.tasks.front());
-            pool.tasks.pop_front();
-
-            id = pool.tasksId.front();
-            pool.tasksId.pop_front();
-        }   
-
-        // Execute the task
-        pool.workingThreads++;
-        (*task)();
-        pool.workingThreads--;
-
-        {
-            pool.queue_mutex.lock();
-            if (id != 0)
-                pool.tasksFinished.push_back(id);
-            pool.queue_mutex.unlock();
-        }
-    }
+// Pool and queue of the current thread, if it is a worker
+thread_local ThreadPool* currentPool {nullptr};
+thread_local int currentQueue {-1};
 }
 
 /*************/
@@ -52,86 +17,154 @@ ThreadPool::ThreadPool(int threads)
     int nprocessors = threads;
     if (threads == -1)
         nprocessors = std::min(std::max(sysconf(_SC_NPROCESSORS_CONF), 2l), 16l);
-    for (size_t i = 0; i < nprocessors; ++i)
-        workers.emplace_back(thread(Worker(*this)));
+
+    for (int i = 0; i < nprocessors; ++i)
+        _queues.emplace_back(new Queue());
+    for (int i = 0; i < nprocessors; ++i)
+        _workers.emplace_back(thread([=]() {
+            workerLoop(i);
+        }));
 }
 
 /*************/
 ThreadPool::~ThreadPool()
 {
     // Stop all threads
-    stop = true;
-    condition.notify_all();
+    {
+        lock_guard<mutex> lock(_sleepMutex);
+        _stop = true;
+        _sleepCondition.notify_all();
+    }
+    {
+        lock_guard<mutex> lock(_finishedMutex);
+        _finishedCondition.notify_all();
+    }
 
     // join them
-    for (size_t i = 0; i < workers.size(); ++i)
-        workers[i].join();
+    for (auto& worker : _workers)
+        worker.join();
 }
 
 /*************/
-void ThreadPool::waitAllThreads()
+void ThreadPool::push(Splash::Task&& task)
 {
-    while (true)
+    // Workers add tasks to their own queue, other threads spread them over all queues
+    int index = currentPool == this ? currentQueue : _nextQueue++ % _queues.size();
     {
-        this_thread::sleep_for(chrono::nanoseconds((unsigned long)1e5));
-        if (workingThreads == 0 && tasks.size() == 0)
-        {
-            queue_mutex.lock();
-            tasksFinished.clear();
-            queue_mutex.unlock();
-            break;
-        }
+        lock_guard<mutex> lock(_queues[index]->mutex);
+        _queues[index]->tasks.push_back(std::move(task));
+    }
+    _queuedTasks++;
+
+    // A worker declares itself as sleeping before checking for tasks, so it can not miss this one
+    if (_sleepingThreads > 0)
+    {
+        lock_guard<mutex> lock(_sleepMutex);
+        _sleepCondition.notify_one();
     }
 }
 
 /*************/
-void ThreadPool::waitThreads(vector<unsigned int>& list)
+bool ThreadPool::pop(int index, Splash::Task& task)
 {
-    while (true)
-    {
-        this_thread::sleep_for(chrono::microseconds(100));
+    if (_queuedTasks <= 0)
+        return false;
 
-        queue_mutex.lock();
-        if (list.size() == 0 || stop == true)
+    // Newest task of our own queue first, as its data is most likely in cache
+    {
+        auto& queue = *_queues[index];
+        lock_guard<mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
         {
-            queue_mutex.unlock();
-            break;
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            _queuedTasks--;
+            return true;
         }
+    }
 
-        while (true)
+    // Then the oldest task of another queue
+    for (size_t i = 1; i < _queues.size(); ++i)
+    {
+        auto& queue = *_queues[(index + i) % _queues.size()];
+        lock_guard<mutex> lock(queue.mutex);
+        if (!queue.tasks.empty())
         {
-            auto task = find(tasksFinished.begin(), tasksFinished.end(), list[0]);
-            if (task != tasksFinished.end())
-            {
-                list.erase(list.begin());
-                tasksFinished.erase(task);
-            }
-            else
-            {
-                break;
-            }
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            _queuedTasks--;
+            return true;
         }
-        queue_mutex.unlock();
     }
+
+    return false;
 }
 
 /*************/
-unsigned int ThreadPool::getTasksNumber()
+void ThreadPool::markFinished(unsigned int id)
+{
+    lock_guard<mutex> lock(_finishedMutex);
+    _finishedIds.insert(id);
+    _finishedCondition.notify_all();
+}
+
+/*************/
+void ThreadPool::workerLoop(int index)
 {
-    int size;
+    currentPool = this;
+    currentQueue = index;
+
+    Splash::Task task;
+    while (!_stop)
     {
-        queue_mutex.lock();
-        size = tasks.size();
-        queue_mutex.unlock();
+        if (!pop(index, task))
+        {
+            unique_lock<mutex> lock(_sleepMutex);
+            _sleepingThreads++;
+            _sleepCondition.wait(lock, [&]() {return _stop || _queuedTasks > 0;});
+            _sleepingThreads--;
+            continue;
+        }
+
+        // Execute the task
+        _workingThreads++;
+        task();
+        task = Splash::Task();
+        _workingThreads--;
     }
-    return size;
 }
 
 /*************/
-void ThreadPool::addWorkers(unsigned int nbr)
+void ThreadPool::waitAllThreads()
+{
+    // Only used when quitting, so polling is fine here
+    while (_queuedTasks > 0 || _workingThreads > 0)
+        this_thread::sleep_for(chrono::microseconds(100));
+
+    lock_guard<mutex> lock(_finishedMutex);
+    _finishedIds.clear();
+}
+
+/*************/
+void ThreadPool::waitThreads(vector<unsigned int>& list)
+{
+    unique_lock<mutex> lock(_finishedMutex);
+    _finishedCondition.wait(lock, [&]() {
+        list.erase(remove_if(list.begin(), list.end(), [&](unsigned int id) {
+            auto idIt = _finishedIds.find(id);
+            if (idIt == _finishedIds.end())
+                return false;
+            _finishedIds.erase(idIt);
+            return true;
+        }), list.end());
+        return list.empty() || _stop;
+    });
+}
+
+/*************/
+unsigned int ThreadPool::getTasksNumber()
 {
-    for (unsigned int i = 0; i < nbr; ++i)
-        workers.emplace_back(thread(Worker(*this)));
+    return std::max(0, _queuedTasks.load());
 }
 
 /*************/
@@ -0,0 +1,168 @@
+#include "tracer.h"
+
+#include <fstream>
+#include <unistd.h>
+
+#include "log.h"
+#include "timer.h"
+
+using namespace std;
+
+namespace Splash
+{
+
+/*************/
+namespace
+{
+// Escape the characters which would break a JSON string
+string escape(const char* str)
+{
+    string escaped;
+    for (auto c = str; *c != '\0'; ++c)
+    {
+        if (*c == '"' || *c == '\\')
+            escaped += '\\';
+        if (static_cast<unsigned char>(*c) >= 0x20)
+            escaped += *c;
+    }
+    return escaped;
+}
+}
+
+/*************/
+void Tracer::begin(const char* name, const char* detail)
+{
+    record(name, detail, true);
+}
+
+/*************/
+void Tracer::end(const char* name)
+{
+    record(name, nullptr, false);
+}
+
+/*************/
+const char* Tracer::intern(const string& str)
+{
+    // Each thread keeps the strings it already interned, so that the lock is only taken once per string
+    thread_local unordered_map<string, const char*> threadStrings;
+    auto stringIt = threadStrings.find(str);
+    if (stringIt != threadStrings.end())
+        return stringIt->second;
+
+    lock_guard<mutex> lock(_stringsMutex);
+    auto interned = _strings.insert(str).first->c_str();
+    threadStrings[str] = interned;
+    return interned;
+}
+
+/*************/
+void Tracer::setThreadName(const string& name)
+{
+    auto& buffer = getThreadBuffer();
+    lock_guard<mutex> lock(_buffersMutex);
+    buffer.name = name;
+}
+
+/*************/
+Tracer::ThreadBuffer& Tracer::getThreadBuffer()
+{
+    // The buffer is kept by the tracer after the end of the thread, so that it can still be exported
+    thread_local ThreadBuffer* threadBuffer {nullptr};
+    if (threadBuffer)
+        return *threadBuffer;
+
+    auto buffer = make_shared<ThreadBuffer>();
+    buffer->events.resize(SPLASH_TRACER_EVENTS_PER_THREAD);
+
+    lock_guard<mutex> lock(_buffersMutex);
+    buffer->threadId = _buffers.size() + 1;
+    buffer->name = "Thread " + to_string(buffer->threadId);
+    _buffers.push_back(buffer);
+    threadBuffer = buffer.get();
+
+    return *threadBuffer;
+}
+
+/*************/
+void Tracer::record(const char* name, const char* detail, bool isBegin)
+{
+    auto& buffer = getThreadBuffer();
+    auto head = buffer.head.load(memory_order_relaxed);
+
+    auto& event = buffer.events[head % SPLASH_TRACER_EVENTS_PER_THREAD];
+    event.name = name;
+    event.detail = detail;
+    event.timestamp = Timer::getTime();
+    event.frame = _frame;
+    event.isBegin = isBegin;
+
+    buffer.head.store(head + 1, memory_order_release);
+}
+
+/*************/
+bool Tracer::exportChromeTrace(const string& filename, const string& processName)
+{
+    ofstream file(filename, ios::out | ios::trunc);
+    if (!file.is_open())
+    {
+        Log::get() << Log::WARNING << "Tracer::" << __FUNCTION__ << " - Unable to open file " << filename << Log::endl;
+        return false;
+    }
+
+    auto pid = getpid();
+    file << "{\"traceEvents\":[\n";
+    file << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" << pid << ",\"tid\":0,\"args\":{\"name\":\"" << escape(processName.c_str()) << "\"}}";
+
+    vector<shared_ptr<ThreadBuffer>> buffers;
+    {
+        lock_guard<mutex> lock(_buffersMutex);
+        buffers = _buffers;
+        for (auto& buffer : buffers)
+            file << ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << pid << ",\"tid\":" << buffer->threadId
+                 << ",\"args\":{\"name\":\"" << escape(buffer->name.c_str()) << "\"}}";
+    }
+
+    for (auto& buffer : buffers)
+    {
+        // Copy the events, then drop the ones which may have been overwritten during the copy
+        auto head = buffer->head.load(memory_order_acquire);
+        auto first = head > SPLASH_TRACER_EVENTS_PER_THREAD ? head - SPLASH_TRACER_EVENTS_PER_THREAD : 0;
+        vector<Event> events;
+        events.reserve(head - first);
+        for (auto index = first; index < head; ++index)
+            events.push_back(buffer->events[index % SPLASH_TRACER_EVENTS_PER_THREAD]);
+
+        auto newHead = buffer->head.load(memory_order_acquire);
+        auto overwritten = newHead > SPLASH_TRACER_EVENTS_PER_THREAD ? newHead - SPLASH_TRACER_EVENTS_PER_THREAD : 0;
+        auto skip = overwritten > first ? std::min<uint64_t>(overwritten - first, events.size()) : 0;
+
+        // The oldest events may end scopes whose beginning has been overwritten
+        int depth = 0;
+        for (auto eventIt = events.begin() + skip; eventIt != events.end(); ++eventIt)
+        {
+            if (!eventIt->isBegin && depth == 0)
+                continue;
+            depth += eventIt->isBegin ? 1 : -1;
+
+            file << ",\n{\"ph\":\"" << (eventIt->isBegin ? "B" : "E") << "\",\"name\":\"" << escape(eventIt->name)
+                 << "\",\"pid\":" << pid << ",\"tid\":" << buffer->threadId << ",\"ts\":" << eventIt->timestamp;
+            if (eventIt->isBegin)
+            {
+                file << ",\"args\":{\"frame\":" << eventIt->frame;
+                if (eventIt->detail)
+                    file << ",\"detail\":\"" << escape(eventIt->detail) << "\"";
+                file << "}";
+            }
+            file << "}";
+        }
+    }
+
+    file << "\n]}\n";
+    file.close();
+
+    Log::get() << Log::MESSAGE << "Tracer::" << __FUNCTION__ << " - Trace written to " << filename << Log::endl;
+    return true;
+}
+
+} // end of namespace
@@ -37,11 +37,9 @@ void Warp::init()
 
     // Intialize FBO, textures and everything OpenGL
     glGetError();
-    glGenFramebuffers(1, &_fbo);
-
     setOutput();
 
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo);
+    _fbo.bind(GL_DRAW_FRAMEBUFFER);
     GLenum _status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
     if (_status != GL_FRAMEBUFFER_COMPLETE)
 	{
@@ -77,8 +75,6 @@ Warp::~Warp()
 #ifdef DEBUG
     Log::get()<< Log::DEBUGGING << "Warp::~Warp - Destructor" << Log::endl;
 #endif
-
-    glDeleteFramebuffers(1, &_fbo);
 }
 
 /*************/
@@ -164,10 +160,15 @@ void Warp::update()
     auto input = camera->getTextures()[0];
 
     _outTextureSpec = input->getSpec();
-    _outTexture->resize(_outTextureSpec.width, _outTextureSpec.height);
+    auto outSpec = _outTexture->getSpec();
+    if (outSpec.width != _outTextureSpec.width || outSpec.height != _outTextureSpec.height)
+    {
+        _outTexture->resize(_outTextureSpec.width, _outTextureSpec.height);
+        _fbo.invalidate();
+    }
     glViewport(0, 0, _outTextureSpec.width, _outTextureSpec.height);
 
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo);
+    _fbo.bind(GL_DRAW_FRAMEBUFFER);
     GLenum fboBuffers[1] = {GL_COLOR_ATTACHMENT0};
     glDrawBuffers(1, fboBuffers);
     glDisable(GL_DEPTH_TEST);
@@ -296,13 +297,9 @@ void Warp::loadDefaultModels()
 /*************/
 void Warp::setOutput()
 {
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _fbo);
-
     _outTexture = make_shared<Texture_Image>(_root);
     _outTexture->reset(GL_TEXTURE_2D, 0, GL_RGBA, 512, 512, 0, GL_RGBA, GL_UNSIGNED_INT_8_8_8_8_REV, nullptr);
-    glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _outTexture->getTexId(), 0);
-
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    _fbo.setAttachment(GL_COLOR_ATTACHMENT0, _outTexture->getTexId());
 
     // Setup the virtual screen
     _screen = make_shared<Object>(_root);
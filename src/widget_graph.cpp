@@ -46,6 +46,12 @@ void GuiGraph::render()
             maxValue = ceil(maxValue * 0.1f) * 10.f;
 
             ImGui::PlotLines("", values.data(), values.size(), values.size(), (duration.first + " - " + to_string((int)maxValue) + "ms").c_str(), 0.f, maxValue, ImVec2(width - 30, 80));
+
+            // The plot only shows the last durations, the percentiles cover the whole sliding window
+            auto stats = Timer::get().getStatistics(duration.first);
+            if (stats.count != 0)
+                ImGui::Text("min %.2f / mean %.2f / p50 %.2f / p95 %.2f / p99 %.2f / max %.2f ms",
+                    stats.min * 0.001f, stats.mean * 0.001f, stats.p50 * 0.001f, stats.p95 * 0.001f, stats.p99 * 0.001f, stats.max * 0.001f);
         }
     }
 }
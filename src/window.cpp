@@ -1,6 +1,7 @@
 #include "window.h"
 
 #include "camera.h"
+#include "filter.h"
 #include "geometry.h"
 #include "gui.h"
 #include "image.h"
@@ -69,10 +70,9 @@ Window::Window(RootObjectWeakPtr root)
 
     // Create the render FBO
     glGetError();
-    glGenFramebuffers(1, &_renderFbo);
     setupRenderFBO();
 
-    glBindFramebuffer(GL_FRAMEBUFFER, _renderFbo);
+    _renderFbo.bind(GL_FRAMEBUFFER);
     GLenum _status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
     if (_status != GL_FRAMEBUFFER_COMPLETE)
         Log::get() << Log::WARNING << "Window::" << __FUNCTION__ << " - Error while initializing render framebuffer object: " << _status << Log::endl;
@@ -94,7 +94,6 @@ Window::~Window()
     Log::get() << Log::DEBUGGING << "Window::~Window - Destructor" << Log::endl;
 #endif
 
-    glDeleteFramebuffers(1, &_renderFbo);
     glDeleteFramebuffers(1, &_readFbo);
 }
 
@@ -211,13 +210,13 @@ bool Window::linkTo(shared_ptr<BaseObject> obj)
     }
     else if (dynamic_pointer_cast<Image>(obj).get() != nullptr)
     {
-        auto tex = make_shared<Texture_Image>(_root);
-        tex->setName(getName() + "_" + obj->getName() + "_tex");
-        tex->setResizable(0);
-        if (tex->linkTo(obj))
+        // The filter converts YUV frames, which the window shader does not handle
+        auto filter = make_shared<Filter>(_root);
+        filter->setName(getName() + "_" + obj->getName() + "_filter");
+        if (filter->linkTo(obj))
         {
-            _root.lock()->registerObject(tex);
-            return linkTo(tex);
+            _root.lock()->registerObject(filter);
+            return linkTo(filter);
         }
         else
             return false;
@@ -267,21 +266,13 @@ void Window::unlinkFrom(shared_ptr<BaseObject> obj)
     }
     else if (dynamic_pointer_cast<Image>(obj).get() != nullptr)
     {
-        // Look for the corresponding texture
-        string texName = getName() + "_" + obj->getName() + "_tex";
-        TexturePtr tex = nullptr;
-        for (auto& inTex : _inTextures)
+        auto filterName = getName() + "_" + obj->getName() + "_filter";
+        auto filter = _root.lock()->unregisterObject(filterName);
+
+        if (filter)
         {
-            if (inTex.expired())
-                continue;
-            auto lockedTex = inTex.lock();
-            if (lockedTex->getName() == texName)
-                tex = lockedTex;
-        }
-        if (tex != nullptr)
-        {
-            tex->unlinkFrom(obj);
-            unsetTexture(tex);
+            filter->unlinkFrom(obj);
+            unlinkFrom(filter);
         }
     }
     else if (dynamic_pointer_cast<Camera>(obj).get() != nullptr)
@@ -326,7 +317,7 @@ bool Window::render()
     glGetError();
 #endif
 
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _renderFbo);
+    _renderFbo.bind(GL_DRAW_FRAMEBUFFER);
     GLenum fboBuffers[1] = {GL_COLOR_ATTACHMENT0};
     glDrawBuffers(1, fboBuffers);
     glDisable(GL_DEPTH_TEST);
@@ -349,10 +340,12 @@ bool Window::render()
         glClearColor(0.0, 0.0, 0.0, 0.0);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        auto layout = _layout;
-        layout.push_front("layout");
-        _screen->getShader()->setAttribute("uniform", layout);
-        _screen->getShader()->setAttribute("uniform", {"_gamma", (float)_srgb, _gammaCorrection}); 
+        static auto layoutHandle = Shader::getUniformHandle("_layout");
+        static auto gammaHandle = Shader::getUniformHandle("_gamma");
+
+        auto shader = _screen->getShader();
+        shader->setUniform(layoutHandle, glm::ivec4(_layout[0].asInt(), _layout[1].asInt(), _layout[2].asInt(), _layout[3].asInt()));
+        shader->setUniform(gammaHandle, glm::vec2((float)_srgb, _gammaCorrection));
         _screen->activate();
         _screen->draw();
         _screen->deactivate();
@@ -415,12 +408,10 @@ void Window::setupRenderFBO()
 {
     glfwGetFramebufferSize(_window->get(), &_windowRect[2], &_windowRect[3]);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, _renderFbo);
-
     if (!_depthTexture)
     {
         _depthTexture = make_shared<Texture_Image>(_root, GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, 512, 512, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
-        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, _depthTexture->getTexId(), 0);
+        _renderFbo.setAttachment(GL_DEPTH_ATTACHMENT, _depthTexture->getTexId());
     }
     else
     {
@@ -434,15 +425,19 @@ void Window::setupRenderFBO()
         _colorTexture = make_shared<Texture_Image>(_root);
         _colorTexture->setAttribute("filtering", {0});
         _colorTexture->reset(GL_TEXTURE_2D, 0, GL_SRGB8_ALPHA8, _windowRect[2], _windowRect[3], 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _colorTexture->getTexId(), 0);
+        _renderFbo.setAttachment(GL_COLOR_ATTACHMENT0, _colorTexture->getTexId());
     }
     else
     {
+        auto spec = _colorTexture->getSpec();
         _colorTexture->setResizable(1);
         _colorTexture->setAttribute("size", {_windowRect[2], _windowRect[3]});
         _colorTexture->setResizable(0);
+        if ((int)spec.width != _windowRect[2] || (int)spec.height != _windowRect[3])
+            _renderFbo.invalidate();
     }
 
+    _renderFbo.bind(GL_FRAMEBUFFER);
     glClearColor(0.0, 0.0, 0.0, 0.0);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
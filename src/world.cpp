@@ -7,6 +7,7 @@
 #include <spawn.h>
 #include <sys/wait.h>
 
+#include "./directUpload.h"
 #include "./image.h"
 #if HAVE_GPHOTO
     #include "./image_gphoto.h"
@@ -28,6 +29,7 @@
 #include "./queue.h"
 #include "./scene.h"
 #include "./timer.h"
+#include "./tracer.h"
 #include "./threadpool.h"
 
 // Included only for creating the documentation through the --info flag
@@ -70,9 +72,13 @@ void World::run()
     // We must not send the timings too often, this is what this variable is for
     int frameIndice {0};
 
+    Tracer::get().setThreadName("World loop");
+
     while (true)
     {
         Timer::get() << "worldLoop";
+        // Frames are counted here, an inner Scene sharing the tracer does not count them
+        Tracer::get().nextFrame();
         lock_guard<mutex> lockConfiguration(_configurationMutex);
 
         {
@@ -88,36 +94,44 @@ void World::run()
 
             // Read and serialize new buffers
             Timer::get() << "serialize";
-            vector<unsigned int> threadIds;
             map<string, shared_ptr<SerializedObject>> serializedObjects;
-            for (auto& o : _objects)
             {
-                BufferObjectPtr bufferObj = dynamic_pointer_cast<BufferObject>(o.second);
-                // This prevents the map structure to be modified in the threads
-                serializedObjects.emplace(std::make_pair(bufferObj->getDistantName(), make_shared<SerializedObject>()));
+                Tracer::Scope trace("serialize");
+                TaskGroup serializeTasks;
+                for (auto& o : _objects)
+                {
+                    BufferObjectPtr bufferObj = dynamic_pointer_cast<BufferObject>(o.second);
+                    // This prevents the map structure to be modified in the threads
+                    serializedObjects.emplace(std::make_pair(bufferObj->getDistantName(), make_shared<SerializedObject>()));
 
-                threadIds.push_back(SThread::pool.enqueue([=, &serializedObjects, &o]() {
-                    // Update the local objects
-                    o.second->update();
+                    serializeTasks.run([=, &serializedObjects, &o]() {
+                        Tracer::Scope trace("update and serialize", o.second->getTraceName());
 
-                    // Send them the their destinations
-                    if (bufferObj.get() != nullptr)
-                    {
-                        if (bufferObj->wasUpdated()) // if the buffer has been updated
+                        // Update the local objects
+                        o.second->update();
+
+                        // Send them the their destinations
+                        if (bufferObj.get() != nullptr)
                         {
-                            auto obj = bufferObj->serialize();
-                            bufferObj->setNotUpdated();
-                            if (obj)
-                                serializedObjects[bufferObj->getDistantName()] = obj;
+                            if (bufferObj->wasUpdated()) // if the buffer has been updated
+                            {
+                                auto obj = bufferObj->serialize();
+                                bufferObj->setNotUpdated();
+                                if (obj)
+                                    serializedObjects[bufferObj->getDistantName()] = obj;
+                            }
                         }
-                    }
-                }));
+                    });
+                }
+                serializeTasks.wait();
             }
-            SThread::pool.waitThreads(threadIds);
             Timer::get() >> "serialize";
 
             // Wait for previous buffers to be uploaded
-            _link->waitForBufferSending(chrono::milliseconds((unsigned long long)(1e3 / 30))); // Maximum time to wait for frames to arrive
+            {
+                Tracer::Scope trace("wait for buffer sending");
+                _link->waitForBufferSending(chrono::milliseconds((unsigned long long)(1e3 / 30))); // Maximum time to wait for frames to arrive
+            }
             sendMessage(SPLASH_ALL_PEERS, "bufferUploaded", {});
             Timer::get() >> "upload";
 
@@ -127,15 +141,25 @@ void World::run()
                 _link->sendBuffer(o.first, std::move(o.second));
         }
 
-        // Update the distant attributes
+        // Once in a while, everything is sent again in case a Scene missed some updates
+        if (frameIndice == 0)
+        {
+            for (auto& o : _objects)
+                o.second->resetDistantAttributes();
+            _sentDurations.clear();
+        }
+        frameIndice = (frameIndice + 1) % (int)_worldFramerate;
+
+        // Update the distant attributes which changed since the last loop, all at once
+        Values distantAttributes;
         for (auto& o : _objects)
         {
-            auto attribs = o.second->getDistantAttributes();
+            auto attribs = o.second->getDirtyDistantAttributes();
             for (auto& attrib : attribs)
-            {
-                sendMessage(o.second->getName(), attrib.first, attrib.second);
-            }
+                distantAttributes.push_back(Values({o.second->getName(), attrib.first, attrib.second}));
         }
+        if (distantAttributes.size() != 0)
+            sendMessage(SPLASH_ALL_PEERS, "batch", distantAttributes);
 
         // If swap synchronization test is enabled
         if (_swapSynchronizationTesting)
@@ -170,19 +194,32 @@ void World::run()
         // If the master scene is not an inner scene, we have to send it some information
         if (_scenes[_masterSceneName] != -1)
         {
+            Values masterSceneMessages;
+
             // Send current timings to all Scenes, for display purpose
+            // Only the timings which changed since the last loop are sent
             auto& durationMap = Timer::get().getDurationMap();
             for (auto& d : durationMap)
-                sendMessage(_masterSceneName, "duration", {d.first, (int)d.second});
+            {
+                int duration = (int)d.second;
+                auto sentDurationIt = _sentDurations.find(d.first);
+                if (sentDurationIt != _sentDurations.end() && sentDurationIt->second == duration)
+                    continue;
+                _sentDurations[d.first] = duration;
+                masterSceneMessages.push_back(Values({_masterSceneName, "duration", Values({d.first, duration})}));
+            }
             // Also send the master clock if needed
             Values clock;
             if (Timer::get().getMasterClock(clock))
-                sendMessage(_masterSceneName, "masterClock", clock);
+                masterSceneMessages.push_back(Values({_masterSceneName, "masterClock", clock}));
 
             // Send newer logs to all master Scene
             auto logs = Log::get().getNewLogs();
             for (auto& log : logs)
-                sendMessage(_masterSceneName, "log", {log.first, (int)log.second});
+                masterSceneMessages.push_back(Values({_masterSceneName, "log", Values({log.first, (int)log.second})}));
+
+            if (masterSceneMessages.size() != 0)
+                sendMessage(_masterSceneName, "batch", masterSceneMessages);
         }
 
         if (_quit)
@@ -203,10 +240,21 @@ void World::run()
                     Timer::get() << "pingScene " + scene.first;
                     sendMessage(scene.first, "ping", {});
                 }
+
+                auto poolStats = BufferPool::get().getStats();
+                Log::get() << Log::DEBUGGING << "World::" << __FUNCTION__ << " - Buffer pool: " << poolStats.hits << " hits, " << poolStats.misses << " misses, "
+                           << poolStats.usedBytes / (1024 * 1024) << "MB used, " << poolStats.cachedBytes / (1024 * 1024) << "MB cached" << Log::endl;
             }
             frameIndex = (frameIndex + 1) % 60;
         }
 
+        // Log the tail latencies once in a while, as a single slow frame is lost in the last durations
+        if (_timingLogPeriod > 0 && Timer::getTime() - _lastTimingLog > (int64_t)_timingLogPeriod * 1000000)
+        {
+            _lastTimingLog = Timer::getTime();
+            Log::get() << Log::MESSAGE << "World::" << __FUNCTION__ << " - Timings (ms): " << Timer::get().getStatisticsSummary() << Log::endl;
+        }
+
         // Get the current FPS
         Timer::get() >> 1e6 / (float)_worldFramerate >> "worldLoop";
     }
@@ -259,6 +307,7 @@ void World::applyConfig()
     _scenes.clear();
     _objects.clear();
     _objectDest.clear();
+    _sentDurations.clear();
     _masterSceneName = "";
 
     // Get the list of all scenes, and create them
@@ -306,6 +355,8 @@ void World::applyConfig()
                 {
                     Log::get() << Log::MESSAGE << "World::" << __FUNCTION__ << " - Starting an inner Scene" << Log::endl;
                     _innerScene = make_shared<Scene>(name, false);
+                    // The inner Scene shares the timers of the World, which logs them already
+                    _innerScene->setAttribute("timingLogPeriod", {0});
                     _innerSceneThread = thread([&]() {
                         _innerScene->run();
                     });
@@ -381,6 +432,9 @@ void World::applyConfig()
         }
     }
 
+    // If the inner Scene is the only one, images can write their frames directly to its textures
+    DirectUpload::get().setActive(_innerScene && _scenes.size() == 1 && _scenes.begin()->first == _innerScene->getName());
+
     // Configure each scenes
     // The first scene is the master one, and also receives some ghost objects
     // First, we create the objects
@@ -1141,6 +1195,7 @@ void World::registerAttributes()
                     }
                     else
                     {
+                        DirectUpload::get().setActive(false);
                         if (_innerSceneThread.joinable())
                             _innerSceneThread.join();
                         _innerScene.reset();
@@ -1310,6 +1365,23 @@ void World::registerAttributes()
     }, {'s'});
     setAttributeDescription("sendToMasterScene", "Send the given message to the master Scene");
 
+    addAttribute("hugePages", [&](const Values& args) {
+        BufferPool::get().setUseHugePages(args[0].asInt() != 0);
+        return true;
+    }, {'n'});
+    setAttributeDescription("hugePages", "If set to 1, big frame buffers are backed by huge pages when the system allows it");
+
+    addAttribute("sharedMemoryTransport", [&](const Values& args) {
+        auto active = args[0].asInt() != 0;
+        auto slotSize = args.size() > 1 ? std::max(1, args[1].asInt()) * 1024ull * 1024ull : SPLASH_SHM_DEFAULT_SLOT_SIZE;
+        addTask([=]() {
+            _link->setSharedMemoryTransport(active, slotSize);
+        });
+
+        return true;
+    }, {'n'});
+    setAttributeDescription("sharedMemoryTransport", "If set to 1, buffers are sent to Scenes through shared memory. A second parameter sets the maximum buffer size, in MB");
+
     addAttribute("swapTest", [&](const Values& args) {
         addTask([=]() {
             _swapSynchronizationTesting = args[0].asInt();
@@ -1319,6 +1391,62 @@ void World::registerAttributes()
     }, {'n'});
     setAttributeDescription("swapTest", "Activate video swap test if set to 1");
 
+    addAttribute("tracing", [&](const Values& args) {
+        Tracer::get().setEnabled(args[0].asInt() != 0);
+        addTask([=]() {
+            sendMessage(SPLASH_ALL_PEERS, "tracing", {args[0].asInt()});
+        });
+
+        return true;
+    }, {'n'});
+    setAttributeDescription("tracing", "Record the timings of each step of the World and Scenes loops if set to 1, to be exported with exportTrace");
+
+    addAttribute("measureLatency", [&](const Values& args) {
+        addTask([=]() {
+            sendMessage(SPLASH_ALL_PEERS, "measureLatency", {args[0].asInt()});
+        });
+
+        return true;
+    }, {'n'});
+    setAttributeDescription("measureLatency", "If set to 1, each Scene measures the latency of each source, from the capture or decoding of its frames to the swap of the windows");
+
+    addAttribute("parallelWindows", [&](const Values& args) {
+        addTask([=]() {
+            sendMessage(SPLASH_ALL_PEERS, "parallelWindows", {args[0].asInt()});
+        });
+
+        return true;
+    }, {'n'});
+    setAttributeDescription("parallelWindows", "If set to 1, each Scene renders its windows in parallel, each from its own context");
+
+    addAttribute("timingLogPeriod", [&](const Values& args) {
+        _timingLogPeriod = std::max(0, args[0].asInt());
+        addTask([=]() {
+            for (auto& s : _scenes)
+                if (!_innerScene || s.first != _innerScene->getName())
+                    sendMessage(s.first, "timingLogPeriod", {_timingLogPeriod});
+        });
+
+        return true;
+    }, [&]() -> Values {
+        return {_timingLogPeriod};
+    }, {'n'});
+    setAttributeDescription("timingLogPeriod", "Period, in seconds, at which the percentiles of all timings are logged by each process. 0 to disable");
+
+    addAttribute("exportTrace", [&](const Values& args) {
+        string path = args.size() > 0 ? args[0].asString() : "/tmp/splash_trace";
+        addTask([=]() {
+            // The inner Scene shares the tracer of the World, its events are exported along with the World ones
+            Tracer::get().exportChromeTrace(path + "_world.json", "World");
+            for (auto& s : _scenes)
+                if (!_innerScene || s.first != _innerScene->getName())
+                    sendMessage(s.first, "exportTrace", {path});
+        });
+
+        return true;
+    });
+    setAttributeDescription("exportTrace", "Export the recorded timings of all processes to [path]_world.json and [path]_[scene name].json, in the Chrome trace format. Path defaults to /tmp/splash_trace");
+
     addAttribute("wireframe", [&](const Values& args) {
         addTask([=]() {
             sendMessage(SPLASH_ALL_PEERS, "wireframe", {args[0].asInt()});
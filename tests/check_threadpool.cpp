@@ -0,0 +1,105 @@
+#include <bandit/bandit.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "threadpool.h"
+
+using namespace std;
+using namespace bandit;
+using namespace Splash;
+
+go_bandit([]() {
+    /*********/
+    describe("ThreadPool class", []() {
+        ThreadPool pool(4);
+
+        it("should run every enqueued task", [&]() {
+            atomic_int counter {0};
+            vector<unsigned int> ids;
+            for (int i = 0; i < 1000; ++i)
+                ids.push_back(pool.enqueue([&]() {
+                    counter++;
+                }));
+            pool.waitThreads(ids);
+
+            AssertThat(counter.load(), Equals(1000));
+        });
+
+        it("should let idle workers steal the tasks of a busy one", [&]() {
+            // Tasks added by a worker go to its own queue, and this worker
+            // does not go back to it before they are all done
+            atomic_int counter {0};
+            atomic_bool isDone {false};
+            vector<unsigned int> ids;
+            ids.push_back(pool.enqueue([&]() {
+                for (int i = 0; i < 100; ++i)
+                    pool.enqueueWithoutId([&]() {
+                        counter++;
+                    });
+
+                auto deadline = chrono::steady_clock::now() + chrono::seconds(10);
+                while (counter < 100 && chrono::steady_clock::now() < deadline)
+                    this_thread::yield();
+                isDone = true;
+            }));
+            pool.waitThreads(ids);
+
+            AssertThat(isDone.load(), Equals(true));
+            AssertThat(counter.load(), Equals(100));
+        });
+
+        it("should run the tasks of nested groups", [&]() {
+            // Groups waited for from the workers must not deadlock, even with more groups than workers
+            atomic_int counter {0};
+            TaskGroup outerGroup(pool);
+            for (int i = 0; i < 16; ++i)
+                outerGroup.run([&]() {
+                    TaskGroup innerGroup(pool);
+                    for (int j = 0; j < 16; ++j)
+                        innerGroup.run([&]() {
+                            counter++;
+                        });
+                    innerGroup.wait();
+                });
+            outerGroup.wait();
+
+            AssertThat(counter.load(), Equals(256));
+        });
+
+        it("should process every index exactly once with parallelFor", [&]() {
+            vector<atomic_int> hits(10007);
+            for (auto& h : hits)
+                h = 0;
+            pool.parallelFor(hits.size(), 7, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i)
+                    hits[i]++;
+            });
+
+            bool isOnce = true;
+            for (auto& h : hits)
+                isOnce &= (h == 1);
+            AssertThat(isOnce, Equals(true));
+        });
+
+        it("should handle more stripes than indices with parallelFor", [&]() {
+            atomic_int counter {0};
+            pool.parallelFor(3, 8, [&](size_t begin, size_t end) {
+                counter += end - begin;
+            });
+            pool.parallelFor(0, 8, [&](size_t, size_t) {
+                counter += 100;
+            });
+
+            AssertThat(counter.load(), Equals(3));
+        });
+    });
+});
+
+/*************/
+int main(int argc, char* argv[])
+{
+    return bandit::run(argc, argv);
+}
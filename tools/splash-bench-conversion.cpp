@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2016 Emmanuel Durand
+ *
+ * This file is part of Splash.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Splash is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splash.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * @splash-bench-conversion.cpp
+ * A benchmark comparing the pixel conversions of PixelConversion, for each
+ * instruction set, with the per pixel loops previously used by Image_Shmdata
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "pixelConversion.h"
+
+#ifdef HAVE_SSE2
+    #define GLM_FORCE_SSE2
+    #define GLM_FORCE_INLINE
+    #include <glm/glm.hpp>
+    #include <glm/gtx/simd_vec4.hpp>
+#endif
+
+using namespace std;
+using namespace Splash;
+
+/*************/
+inline int clampInt(int v, int a, int b) {return v < a ? a : v > b ? b : v;}
+
+/*************/
+// Previous implementation, one pixel pair at a time
+void i420ToRGBLoop(const unsigned char* Y, const unsigned char* U, const unsigned char* V, int width, int height, unsigned char* pixels)
+{
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x+=2)
+        {
+            int uValue = (int)(U[(y / 2) * (width / 2) + x / 2]) - 128;
+            int vValue = (int)(V[(y / 2) * (width / 2) + x / 2]) - 128;
+
+            int rPart = 52298 * vValue;
+            int gPart = -12846 * uValue - 36641 * vValue;
+            int bPart = 66094 * uValue;
+
+            for (int col = x; col < x + 2; ++col)
+            {
+                int yValue = (int)(Y[y * width + col] - 16) * 38142;
+                pixels[(y * width + col) * 3] = (unsigned char)clampInt((yValue + rPart) / 32768, 0, 255);
+                pixels[(y * width + col) * 3 + 1] = (unsigned char)clampInt((yValue + gPart) / 32768, 0, 255);
+                pixels[(y * width + col) * 3 + 2] = (unsigned char)clampInt((yValue + bPart) / 32768, 0, 255);
+            }
+        }
+}
+
+/*************/
+void uyvyToRGBLoop(const unsigned char* YUV, int width, int height, unsigned char* pixels)
+{
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x+=2)
+        {
+            const unsigned char* block = &YUV[y * width * 2 + x * 2];
+
+            int uValue = (int)(block[0]) - 128;
+            int vValue = (int)(block[2]) - 128;
+
+            int rPart = 52298 * vValue;
+            int gPart = -12846 * uValue - 36641 * vValue;
+            int bPart = 66094 * uValue;
+
+            for (int i = 0; i < 2; ++i)
+            {
+                int yValue = (int)(block[1 + i * 2] - 16) * 38142;
+                pixels[(y * width + x + i) * 3] = (unsigned char)clampInt((yValue + rPart) / 32768, 0, 255);
+                pixels[(y * width + x + i) * 3 + 1] = (unsigned char)clampInt((yValue + gPart) / 32768, 0, 255);
+                pixels[(y * width + x + i) * 3 + 2] = (unsigned char)clampInt((yValue + bPart) / 32768, 0, 255);
+            }
+        }
+}
+
+#ifdef HAVE_SSE2
+/*************/
+// Previous implementation, with glm SIMD vectors
+void i420ToRGBGlm(const unsigned char* Y, const unsigned char* U, const unsigned char* V, int width, int height, unsigned char* pixels)
+{
+    auto uLine = vector<unsigned char>(width / 2);
+    auto vLine = vector<unsigned char>(width / 2);
+    auto yLine = vector<unsigned char>(width);
+    auto localPixels = vector<unsigned char>(width * 3);
+    for (int y = 0; y < height; ++y)
+    {
+        memcpy(uLine.data(), &U[(y / 2) * (width / 2)], width / 2 * sizeof(unsigned char));
+        memcpy(vLine.data(), &V[(y / 2) * (width / 2)], width / 2 * sizeof(unsigned char));
+        memcpy(yLine.data(), &Y[y * width], width * sizeof(unsigned char));
+
+        for (int x = 0; x < width; x += 4)
+        {
+            const unsigned char* uPtr = &uLine[x / 2];
+            const unsigned char* vPtr = &vLine[x / 2];
+            const unsigned char* yPtr = &yLine[x];
+
+            auto uValue = glm::detail::fvec4SIMD((float)uPtr[0], (float)uPtr[0], (float)uPtr[1], (float)uPtr[1]);
+            auto vValue = glm::detail::fvec4SIMD((float)vPtr[0], (float)vPtr[0], (float)vPtr[1], (float)vPtr[1]);
+            auto yValue = glm::detail::fvec4SIMD((float)yPtr[0], (float)yPtr[1], (float)yPtr[2], (float)yPtr[3]);
+
+            uValue = uValue - 128.0;
+            vValue = vValue - 128.0;
+
+            yValue = (yValue - 16.0) * 38142.0;
+            auto rPixel = glm::vec4_cast(glm::clamp((yValue + vValue * 52289) / 32768.0, 0.0, 255.0));
+            auto gPixel = glm::vec4_cast(glm::clamp((yValue + uValue * -12846 - vValue * 36641) / 32768.0, 0.0, 255.0));
+            auto bPixel = glm::vec4_cast(glm::clamp((yValue + uValue * 66094) / 32768.0, 0.0, 255.0));
+
+            for (int i = 0; i < 4; ++i)
+            {
+                localPixels[(x + i) * 3] = (unsigned char)rPixel[i];
+                localPixels[(x + i) * 3 + 1] = (unsigned char)gPixel[i];
+                localPixels[(x + i) * 3 + 2] = (unsigned char)bPixel[i];
+            }
+        }
+
+        memcpy(&pixels[y * width * 3], localPixels.data(), width * 3 * sizeof(unsigned char));
+    }
+}
+#endif
+
+/*************/
+// Returns the throughput, in megapixels per second
+double benchmark(int pixels, int iterations, function<void()> func)
+{
+    func(); // Warm up
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+        func();
+    auto duration = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+    return (double)pixels * (double)iterations / (double)max<int64_t>(duration, 1);
+}
+
+/*************/
+int main(int argc, char** argv)
+{
+    int width = 1920;
+    int height = 1080;
+    int iterations = 100;
+    if (argc > 2)
+    {
+        width = max(2, stoi(argv[1]) / 2 * 2);
+        height = max(2, stoi(argv[2]) / 2 * 2);
+    }
+    if (argc > 3)
+        iterations = max(1, stoi(argv[3]));
+
+    int pixels = width * height;
+
+    mt19937 generator(42);
+    uniform_int_distribution<int> distribution(0, 255);
+    vector<uint8_t> i420(pixels * 3 / 2);
+    vector<uint8_t> uyvy(pixels * 2);
+    vector<uint8_t> rgb(pixels * 3);
+    for (auto& v : i420)
+        v = distribution(generator);
+    for (auto& v : uyvy)
+        v = distribution(generator);
+    for (auto& v : rgb)
+        v = distribution(generator);
+
+    const uint8_t* y = i420.data();
+    const uint8_t* u = y + pixels;
+    const uint8_t* v = u + pixels / 4;
+
+    vector<uint8_t> reference(pixels * 4);
+    vector<uint8_t> output(pixels * 4);
+
+    cout << "Megapixels per second for a " << width << "x" << height << " image, over " << iterations << " iterations" << endl;
+
+    cout << "  previous loops:" << endl;
+    cout << "    I420 -> RGB: " << benchmark(pixels, iterations, [&]() { i420ToRGBLoop(y, u, v, width, height, output.data()); }) << endl;
+#ifdef HAVE_SSE2
+    cout << "    I420 -> RGB (glm SIMD): " << benchmark(pixels, iterations, [&]() { i420ToRGBGlm(y, u, v, width, height, output.data()); }) << endl;
+#endif
+    cout << "    UYVY -> RGB: " << benchmark(pixels, iterations, [&]() { uyvyToRGBLoop(uyvy.data(), width, height, output.data()); }) << endl;
+
+    // Every implementation must give the same result as the scalar one
+    auto check = [&](function<void(uint8_t*)> func, size_t size) -> string {
+        auto isa = PixelConversion::getIsa();
+        PixelConversion::setIsa(PixelConversion::Isa::Scalar);
+        func(reference.data());
+        PixelConversion::setIsa(isa);
+        func(output.data());
+        return equal(reference.begin(), reference.begin() + size, output.begin()) ? "" : " (differs from scalar!)";
+    };
+
+    for (auto isa : {PixelConversion::Isa::Scalar, PixelConversion::Isa::SSE41, PixelConversion::Isa::AVX2})
+    {
+        if (!PixelConversion::setIsa(isa))
+        {
+            cout << "  " << PixelConversion::getIsaName(isa) << ": not supported" << endl;
+            continue;
+        }
+
+        cout << "  " << PixelConversion::getIsaName(isa) << ":" << endl;
+        for (int channels = 3; channels <= 4; ++channels)
+        {
+            auto i420Func = [&](uint8_t* dst) { PixelConversion::i420ToRGB(y, u, v, width, dst, channels, 0, height); };
+            auto uyvyFunc = [&](uint8_t* dst) { PixelConversion::uyvyToRGB(uyvy.data(), width, dst, channels, 0, height); };
+            string suffix = channels == 3 ? "RGB" : "RGBA";
+
+            cout << "    I420 -> " << suffix << ": " << benchmark(pixels, iterations, [&]() { i420Func(output.data()); }) << check(i420Func, pixels * channels) << endl;
+            cout << "    UYVY -> " << suffix << ": " << benchmark(pixels, iterations, [&]() { uyvyFunc(output.data()); }) << check(uyvyFunc, pixels * channels) << endl;
+        }
+
+        auto rgbaFunc = [&](uint8_t* dst) { PixelConversion::rgbToRGBA(rgb.data(), pixels, dst); };
+        cout << "    RGB -> RGBA: " << benchmark(pixels, iterations, [&]() { rgbaFunc(output.data()); }) << check(rgbaFunc, pixels * 4) << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2016 Emmanuel Durand
+ *
+ * This file is part of Splash.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Splash is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Splash.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * @splash-bench-messages.cpp
+ * A benchmark comparing the packed message format of Link with
+ * the previous one, which sent each value in its own ZMQ frame
+ */
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <zmq.hpp>
+
+#include "coretypes.h"
+#include "serializer.h"
+
+using namespace std;
+using namespace Splash;
+
+/*************/
+// Previous format: one frame per value, and one for each value type
+void sendFramePerValue(zmq::socket_t& socket, const string& name, const string& attribute, const Values& message)
+{
+    zmq::message_t msg(name.size() + 1);
+    memcpy(msg.data(), (void*)name.c_str(), name.size() + 1);
+    socket.send(msg, ZMQ_SNDMORE);
+
+    msg.rebuild(attribute.size() + 1);
+    memcpy(msg.data(), (void*)attribute.c_str(), attribute.size() + 1);
+    socket.send(msg, ZMQ_SNDMORE);
+
+    function<void(const Values&, bool)> sendValues;
+    sendValues = [&](const Values& values, bool last) {
+        int size = values.size();
+        msg.rebuild(sizeof(size));
+        memcpy(msg.data(), (void*)&size, sizeof(size));
+        socket.send(msg, (size == 0 && last) ? 0 : ZMQ_SNDMORE);
+
+        for (int i = 0; i < values.size(); ++i)
+        {
+            auto v = values[i];
+            Value::Type valueType = v.getType();
+            bool isLast = last && i == values.size() - 1;
+
+            msg.rebuild(sizeof(valueType));
+            memcpy(msg.data(), (void*)&valueType, sizeof(valueType));
+            socket.send(msg, ZMQ_SNDMORE);
+
+            if (valueType == Value::Type::v)
+                sendValues(v.asValues(), isLast);
+            else
+            {
+                int valueSize = (valueType == Value::Type::s) ? v.size() + 1 : v.size();
+                msg.rebuild(valueSize);
+                memcpy(msg.data(), v.data(), valueSize);
+                socket.send(msg, isLast ? 0 : ZMQ_SNDMORE);
+            }
+        }
+    };
+
+    sendValues(message, true);
+}
+
+/*************/
+void recvFramePerValue(zmq::socket_t& socket, string& name, string& attribute, Values& message)
+{
+    zmq::message_t msg;
+    socket.recv(&msg);
+    name = string((char*)msg.data());
+    socket.recv(&msg);
+    attribute = string((char*)msg.data());
+
+    function<Values(void)> recvValues;
+    recvValues = [&]() -> Values {
+        socket.recv(&msg);
+        int size = *(int*)msg.data();
+
+        Values values;
+        for (int i = 0; i < size; ++i)
+        {
+            socket.recv(&msg);
+            Value::Type valueType = *(Value::Type*)msg.data();
+            if (valueType == Value::Type::v)
+                values.push_back(recvValues());
+            else
+            {
+                socket.recv(&msg);
+                if (valueType == Value::Type::i)
+                    values.push_back(*(int*)msg.data());
+                else if (valueType == Value::Type::l)
+                    values.push_back(*(int64_t*)msg.data());
+                else if (valueType == Value::Type::f)
+                    values.push_back(*(float*)msg.data());
+                else if (valueType == Value::Type::s)
+                    values.push_back(string((char*)msg.data()));
+            }
+        }
+        return values;
+    };
+
+    message = recvValues();
+}
+
+/*************/
+void sendPacked(zmq::socket_t& socket, const string& name, const string& attribute, const Values& message)
+{
+    zmq::message_t msg(Serializer::getMessageSize(name, attribute, message));
+    Serializer::serializeMessage(name, attribute, message, static_cast<char*>(msg.data()));
+    socket.send(msg);
+}
+
+/*************/
+void recvPacked(zmq::socket_t& socket, string& name, string& attribute, Values& message)
+{
+    zmq::message_t msg;
+    socket.recv(&msg);
+    Serializer::deserializeMessage(static_cast<const char*>(msg.data()), msg.size(), name, attribute, message);
+}
+
+/*************/
+typedef function<void(zmq::socket_t&, const string&, const string&, const Values&)> SendFunc;
+typedef function<void(zmq::socket_t&, string&, string&, Values&)> RecvFunc;
+
+double benchmark(zmq::socket_t& out, zmq::socket_t& in, const Values& message, int iterations, SendFunc sendFunc, RecvFunc recvFunc)
+{
+    string name, attribute;
+    Values received;
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+    {
+        sendFunc(out, "object", "attribute", message);
+        recvFunc(in, name, attribute, received);
+    }
+    auto duration = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - start).count();
+
+    if (!(received == message))
+        cout << "Warning: received message differs from the sent one" << endl;
+
+    return (double)iterations / ((double)duration / 1e6);
+}
+
+/*************/
+int main(int argc, char** argv)
+{
+    int iterations = 10000;
+    if (argc > 1)
+        iterations = max(1, stoi(argv[1]));
+
+    zmq::context_t context(1);
+    zmq::socket_t in(context, ZMQ_PAIR);
+    zmq::socket_t out(context, ZMQ_PAIR);
+    in.bind("inproc://splash_bench");
+    out.connect("inproc://splash_bench");
+
+    // A few typical messages
+    Values small {1, 2.f, "value"};
+
+    Values lut;
+    for (int i = 0; i < 768; ++i)
+        lut.push_back((float)i / 767.f);
+
+    Values batch;
+    for (int i = 0; i < 100; ++i)
+        batch.push_back(Values({"object_" + to_string(i), "seek", Values({(float)i})}));
+
+    struct Case
+    {
+        string name;
+        Values message;
+    };
+    vector<Case> cases {{"3 values", small}, {"768 floats (color LUT)", lut}, {"100 nested attributes", batch}};
+
+    cout << "Messages per second, over " << iterations << " iterations" << endl;
+    for (auto& c : cases)
+    {
+        auto framePerValue = benchmark(out, in, c.message, iterations, sendFramePerValue, recvFramePerValue);
+        auto packed = benchmark(out, in, c.message, iterations, sendPacked, recvPacked);
+        cout << "  " << c.name << ": frame per value " << (int)framePerValue << " / packed " << (int)packed
+             << " (x" << packed / framePerValue << ")" << endl;
+    }
+
+    return 0;
+}